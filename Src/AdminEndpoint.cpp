@@ -0,0 +1,45 @@
+#include "../include/AdminEndpoint.hpp"
+#include "../include/Logger.hpp"
+
+AdminEndpoint::AdminEndpoint(net::io_context& io, unsigned short port, Render render)
+    : acceptor_(io, tcp::endpoint(net::ip::address_v4::loopback(), port))
+    , render_(std::move(render))
+{
+    do_accept();
+}
+
+void AdminEndpoint::do_accept()
+{
+    acceptor_.async_accept([this](auto ec, tcp::socket socket) {
+        if (ec) {
+            if (ec != net::error::operation_aborted)
+                LOG_WARN("admin", "accept failed: ", ec.message());
+            return;
+        }
+        serve(std::make_shared<tcp::socket>(std::move(socket)));
+        do_accept();
+    });
+}
+
+// Read up to the end of the request headers, ignore what was asked for,
+// answer with the metrics and close.
+void AdminEndpoint::serve(std::shared_ptr<tcp::socket> sock)
+{
+    auto request = std::make_shared<std::string>();
+    net::async_read_until(*sock, net::dynamic_buffer(*request, 8 * 1024), "\r\n\r\n",
+        [this, sock, request](auto ec, std::size_t) {
+            if (ec)
+                return;
+            std::string body = render_();
+            auto response = std::make_shared<std::string>(
+                "HTTP/1.0 200 OK\r\n"
+                "Content-Type: text/plain; version=0.0.4\r\n"
+                "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                "Connection: close\r\n\r\n" + body);
+            net::async_write(*sock, net::buffer(*response),
+                [sock, response](auto, std::size_t) {
+                    boost::system::error_code ignored;
+                    sock->shutdown(tcp::socket::shutdown_both, ignored);
+                });
+        });
+}
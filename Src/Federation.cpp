@@ -0,0 +1,429 @@
+#include "../include/Federation.hpp"
+#include "../include/Framing.hpp"
+#include "../include/Logger.hpp"
+
+namespace {
+
+constexpr std::size_t kMaxFrame        = 1u << 20;
+constexpr std::size_t kReadChunk       = 64 * 1024;
+constexpr auto        kPresenceTick    = std::chrono::seconds(1);
+constexpr unsigned    kPresenceRefresh = 5;     ///< ticks between full refreshes
+constexpr auto        kPresenceExpiry  = std::chrono::seconds(3 * kPresenceRefresh);
+
+/// Cursor over a frame body; every read is bounds checked.
+struct Reader {
+    std::string_view in;
+    bool             ok = true;
+
+    std::string_view take(std::size_t n)
+    {
+        if (!ok || in.size() < n) { ok = false; return {}; }
+        std::string_view v = in.substr(0, n);
+        in.remove_prefix(n);
+        return v;
+    }
+    std::uint8_t  u8()    { auto v = take(1); return ok ? static_cast<std::uint8_t>(v[0]) : 0; }
+    std::uint32_t u32()   { auto v = take(4); return ok ? wire::get_u32(v.data()) : 0; }
+    std::uint64_t u64()   { auto v = take(8); return ok ? wire::get_u64(v.data()) : 0; }
+    std::string_view str8() { return take(u8()); }
+};
+
+} // namespace
+
+//──────────────── Link ─────────────────────────
+/**
+ * One peer connection. Outbound bytes are appended to pending_ and written
+ * with one async_write at a time; whatever arrives meanwhile goes out with
+ * the next one.
+ */
+class Federation::Link : public std::enable_shared_from_this<Link>
+{
+public:
+    Link(Federation& fed, tcp::socket socket, std::string was_dialled)
+        : dialled(std::move(was_dialled)), fed_(fed), socket_(std::move(socket)) {}
+
+    void start()
+    {
+        std::string hello;
+        wire::append_message(wire::Protocol::framed, hello, "H" + fed_.node_id_);
+        send(hello);
+        read();
+    }
+
+    void send(std::string_view bytes)
+    {
+        if (closed_)
+            return;
+        if (pending_.size() + bytes.size() > fed_.cfg_.max_link_bytes) {
+            LOG_WARN("fed", "link ", name(), " fell behind, dropping it");
+            close();
+            return;
+        }
+        pending_.append(bytes);
+        if (writing_.empty())
+            write();
+    }
+
+    void close()
+    {
+        if (closed_)
+            return;
+        closed_ = true;
+        boost::system::error_code ignored;
+        socket_.shutdown(tcp::socket::shutdown_both, ignored);
+        socket_.close(ignored);
+        fed_.on_link_closed(*this);
+    }
+
+    std::string name() const { return peer.empty() ? dialled : peer; }
+
+    std::string peer;      ///< node id from its hello
+    std::string dialled;   ///< "host:port" if we dialled it (redialled on close)
+
+private:
+    void read()
+    {
+        auto self = shared_from_this();
+        socket_.async_read_some(net::buffer(buf_.prepare(kReadChunk), kReadChunk),
+            [self](boost::system::error_code ec, std::size_t n) {
+                if (ec) {
+                    if (ec != net::error::operation_aborted && !self->closed_) {
+                        self->fed_.stats_.link_drops.add();
+                        self->close();
+                    }
+                    return;
+                }
+                self->buf_.commit(n);
+                std::string_view body;
+                std::size_t      used = 0;
+                wire::Parse      r;
+                while ((r = wire::next_frame(self->buf_.data(), kMaxFrame, body, used))
+                       == wire::Parse::message) {
+                    self->fed_.on_frame(*self, body);
+                    self->buf_.consume(used);
+                    if (self->closed_)
+                        return;
+                }
+                if (r == wire::Parse::too_large) {
+                    LOG_WARN("fed", "oversized frame from ", self->name());
+                    self->fed_.stats_.link_drops.add();
+                    self->close();
+                    return;
+                }
+                self->read();
+            });
+    }
+
+    void write()
+    {
+        writing_.swap(pending_);
+        auto self = shared_from_this();
+        net::async_write(socket_, net::buffer(writing_),
+            [self](boost::system::error_code ec, std::size_t) {
+                self->writing_.clear();
+                if (ec) {
+                    if (!self->closed_) {
+                        self->fed_.stats_.link_drops.add();
+                        self->close();
+                    }
+                    return;
+                }
+                if (!self->pending_.empty() && !self->closed_)
+                    self->write();
+            });
+    }
+
+    Federation&      fed_;
+    tcp::socket      socket_;
+    wire::RecvBuffer buf_;
+    std::string      pending_;
+    std::string      writing_;   ///< in flight; both keep their capacity
+    bool             closed_ = false;
+};
+
+//──────────────── Federation ───────────────────
+Federation::Federation(net::io_context& io, const FederationConfig& cfg, std::string node_id,
+                       Deliver deliver, Presence presence)
+    : io_(io)
+    , cfg_(cfg)
+    , node_id_(std::move(node_id))
+    , epoch_(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::system_clock::now().time_since_epoch()).count()))
+    , deliver_(std::move(deliver))
+    , presence_(std::move(presence))
+    , presence_timer_(io)
+{
+    if (node_id_.size() > 255)
+        throw std::invalid_argument("node id longer than 255 bytes");
+    if (cfg_.port) {
+        acceptor_ = std::make_unique<tcp::acceptor>(io_, tcp::endpoint(tcp::v4(), cfg_.port));
+        do_accept();
+    }
+    for (auto& peer : cfg_.peers)
+        dial(peer);
+    schedule_presence();
+}
+
+Federation::~Federation()
+{
+    stopping_ = true;
+    auto links = links_;             // close() removes from links_
+    for (auto& l : links)
+        l->close();
+}
+
+void Federation::do_accept()
+{
+    acceptor_->async_accept([this](boost::system::error_code ec, tcp::socket socket) {
+        if (ec) {
+            if (ec != net::error::operation_aborted)
+                LOG_WARN("fed", "accept failed: ", ec.message());
+            return;
+        }
+        add_link(std::move(socket), {});
+        do_accept();
+    });
+}
+
+void Federation::dial(const std::string& peer)
+{
+    auto colon = peer.rfind(':');
+    if (colon == std::string::npos) {
+        LOG_ERROR("fed", "bad peer address ", peer, " (want host:port)");
+        return;
+    }
+    auto resolver = std::make_shared<tcp::resolver>(io_);
+    resolver->async_resolve(peer.substr(0, colon), peer.substr(colon + 1),
+        [this, resolver, peer](boost::system::error_code ec, tcp::resolver::results_type eps) {
+            if (ec)
+                return redial(peer);
+            auto socket = std::make_shared<tcp::socket>(io_);
+            net::async_connect(*socket, eps,
+                [this, socket, peer](boost::system::error_code ec2, const tcp::endpoint&) {
+                    if (ec2)
+                        return redial(peer);
+                    add_link(std::move(*socket), peer);
+                });
+        });
+}
+
+void Federation::redial(const std::string& peer)
+{
+    if (stopping_)
+        return;
+    auto timer = std::make_shared<net::steady_timer>(io_, std::chrono::seconds(1));
+    timer->async_wait([this, timer, peer](boost::system::error_code ec) {
+        if (!ec && !stopping_)
+            dial(peer);
+    });
+}
+
+void Federation::add_link(tcp::socket socket, std::string dialled)
+{
+    boost::system::error_code ignored;
+    socket.set_option(tcp::no_delay(true), ignored);
+    auto link = std::make_shared<Link>(*this, std::move(socket), std::move(dialled));
+    links_.push_back(link);
+    live_links_.store(links_.size(), std::memory_order_relaxed);
+    stats_.links.add(1);
+    presence_sent_.clear();          // the new peer gets our full presence next tick
+    link->start();
+}
+
+void Federation::on_link_closed(Link& link)
+{
+    for (std::size_t i = 0; i < links_.size(); ++i) {
+        if (links_[i].get() != &link)
+            continue;
+        auto keep = links_[i];       // the caller is a member of it
+        links_[i] = links_.back();
+        links_.pop_back();
+        live_links_.store(links_.size(), std::memory_order_relaxed);
+        stats_.links.sub(1);
+        if (!link.peer.empty())
+            LOG_INFO("fed", "link to ", link.peer, " down");
+        if (!link.dialled.empty())
+            redial(link.dialled);
+        return;
+    }
+}
+
+void Federation::on_frame(Link& from, std::string_view body)
+{
+    if (body.empty())
+        return;
+    char  type = body.front();
+    Reader r{body.substr(1)};
+
+    if (type == 'H') {
+        from.peer = std::string(r.in);
+        if (from.peer == node_id_) {           // dialled ourselves
+            LOG_WARN("fed", from.dialled, " is this node, not dialling it again");
+            from.dialled.clear();
+            from.close();
+            return;
+        }
+        LOG_INFO("fed", "link to ", from.peer, " up");
+        return;
+    }
+    if (type != 'M' && type != 'P')
+        return;                                // newer peer; ignore what we don't know
+
+    std::string_view origin = r.str8();
+    std::uint64_t    epoch  = r.u64();
+    std::uint64_t    seq    = r.u64();
+    std::string_view room   = r.str8();
+    if (!r.ok) {
+        LOG_WARN("fed", "malformed frame from ", from.name());
+        stats_.link_drops.add();
+        from.close();
+        return;
+    }
+    if (origin == node_id_)
+        return;                                // our own, back round a cycle
+
+    Seen& seen = seen_[std::string(origin)];
+    if (epoch < seen.epoch || (epoch == seen.epoch && seq <= seen.seq)) {
+        stats_.duplicates.add();
+        return;
+    }
+    seen = {epoch, seq};
+
+    // pass it on first: delivering may take a while on a busy node
+    if (links_.size() > 1) {
+        char hdr[wire::kHeaderSize];
+        wire::put_u32(hdr, static_cast<std::uint32_t>(body.size()));
+        auto links = links_;
+        for (auto& l : links) {
+            if (l.get() == &from)
+                continue;
+            l->send({hdr, sizeof hdr});
+            l->send(body);
+            stats_.forwarded.add();
+        }
+    }
+
+    if (type == 'M') {
+        stats_.received.add();
+        deliver_(room, r.in);
+    } else {
+        std::uint32_t members = r.u32();
+        if (!r.ok)
+            return;
+        std::scoped_lock lk(remote_mtx_);
+        NodePresence& node = remote_[std::string(origin)];
+        node.heard = Clock::now();
+        if (members)
+            node.rooms[std::string(room)] = members;
+        else
+            node.rooms.erase(std::string(room));
+    }
+}
+
+//──────────────── outbound ─────────────────────
+void Federation::publish(std::string_view room, std::string_view text)
+{
+    numbered('M', room, text);
+}
+
+/**
+ * Number a frame and queue it for every link. Called from any shard; the
+ * first frame into an empty outbox posts one flush to the io thread, like
+ * the shards' inboxes.
+ */
+void Federation::numbered(char type, std::string_view room, std::string_view tail)
+{
+    if (!live_links_.load(std::memory_order_relaxed))
+        return;
+    room = room.substr(0, 255);
+    std::size_t body = 1 + 1 + node_id_.size() + 16 + 1 + room.size() + tail.size();
+
+    bool post = false;
+    {
+        std::scoped_lock lk(out_mtx_);
+        char hdr[wire::kHeaderSize + 2 + 16];
+        wire::put_u32(hdr, static_cast<std::uint32_t>(body));
+        hdr[4] = type;
+        hdr[5] = static_cast<char>(node_id_.size());
+        outbox_.append(hdr, 6);
+        outbox_.append(node_id_);
+        wire::put_u64(hdr, epoch_);
+        wire::put_u64(hdr + 8, ++seq_);
+        outbox_.append(hdr, 16);
+        outbox_ += static_cast<char>(room.size());
+        outbox_.append(room);
+        outbox_.append(tail);
+        if (type == 'M')
+            stats_.published.add();
+        if (!flush_posted_)
+            post = flush_posted_ = true;
+    }
+    if (post)
+        net::post(io_, [this] { flush(); });
+}
+
+void Federation::flush()
+{
+    {
+        std::scoped_lock lk(out_mtx_);
+        batch_.swap(outbox_);
+        flush_posted_ = false;
+    }
+    auto links = links_;
+    for (auto& l : links)
+        l->send(batch_);
+    batch_.clear();
+}
+
+//──────────────── presence ─────────────────────
+std::unordered_map<std::string, std::uint32_t> Federation::remote_members() const
+{
+    std::unordered_map<std::string, std::uint32_t> out;
+    std::scoped_lock lk(remote_mtx_);
+    for (auto& [node, p] : remote_)
+        for (auto& [room, n] : p.rooms)
+            out[room] += n;
+    return out;
+}
+
+void Federation::schedule_presence()
+{
+    presence_timer_.expires_after(kPresenceTick);
+    presence_timer_.async_wait([this](boost::system::error_code ec) {
+        if (ec)
+            return;
+        send_presence();
+        schedule_presence();
+    });
+}
+
+/// Send counts that changed (all of them every kPresenceRefresh ticks) and
+/// forget nodes that have gone quiet.
+void Federation::send_presence()
+{
+    bool refresh = ++presence_ticks_ % kPresenceRefresh == 0;
+    std::unordered_map<std::string, std::uint32_t> now;
+    for (auto& [room, n] : presence_())
+        if (n)
+            now.emplace(room, n);
+
+    auto send = [&](const std::string& room, std::uint32_t n) {
+        char v[4];
+        wire::put_u32(v, n);
+        numbered('P', room, {v, sizeof v});
+    };
+    for (auto& [room, n] : now) {
+        auto it = presence_sent_.find(room);
+        if (refresh || it == presence_sent_.end() || it->second != n)
+            send(room, n);
+    }
+    for (auto& [room, n] : presence_sent_)
+        if (!now.count(room))
+            send(room, 0);
+    presence_sent_ = std::move(now);
+
+    auto cutoff = Clock::now() - kPresenceExpiry;
+    std::scoped_lock lk(remote_mtx_);
+    for (auto it = remote_.begin(); it != remote_.end();)
+        it = it->second.heard < cutoff ? remote_.erase(it) : std::next(it);
+}
@@ -0,0 +1,337 @@
+#include "../include/Handoff.hpp"
+#include "../include/Payload.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace handoff {
+namespace {
+
+constexpr std::uint32_t kMagic         = 0x31484843;   // "CHH1"
+constexpr std::size_t   kFdsPerMessage = 250;          // under SCM_MAX_FD
+constexpr std::size_t   kPrefix        = 12;           // u64 blob bytes, u32 fds
+
+[[noreturn]] void throw_errno(const std::string& what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+[[noreturn]] void corrupt(const char* what)
+{
+    throw std::runtime_error(std::string("handoff: bad state (") + what + ")");
+}
+
+//──────────────── serialization ────────────────
+class Writer
+{
+public:
+    void u8 (std::uint8_t v)  { out_ += static_cast<char>(v); }
+    void u32(std::uint32_t v) { char b[4]; wire::put_u32(b, v); out_.append(b, 4); }
+    void u64(std::uint64_t v) { char b[8]; wire::put_u64(b, v); out_.append(b, 8); }
+    void str(const std::string& s) { u64(s.size()); out_ += s; }
+    void strs(const std::vector<std::string>& v)
+    {
+        u32(static_cast<std::uint32_t>(v.size()));
+        for (auto& s : v) str(s);
+    }
+    std::string& bytes() { return out_; }
+
+private:
+    std::string out_;
+};
+
+class Reader
+{
+public:
+    explicit Reader(std::string_view in) : in_(in) {}
+
+    std::uint8_t  u8()  { return static_cast<std::uint8_t>(*take(1)); }
+    std::uint32_t u32() { return wire::get_u32(take(4)); }
+    std::uint64_t u64() { return wire::get_u64(take(8)); }
+    std::string   str()
+    {
+        std::uint64_t n = u64();
+        if (n > in_.size())
+            corrupt("string length");
+        return std::string(take(n), n);
+    }
+    std::vector<std::string> strs()
+    {
+        std::uint32_t n = u32();
+        std::vector<std::string> v;
+        for (std::uint32_t i = 0; i < n; ++i)
+            v.push_back(str());
+        return v;
+    }
+    bool done() const { return in_.empty(); }
+
+private:
+    const char* take(std::size_t n)
+    {
+        if (n > in_.size())
+            corrupt("truncated");
+        const char* p = in_.data();
+        in_.remove_prefix(n);
+        return p;
+    }
+
+    std::string_view in_;
+};
+
+/// A queue entry must be whole records, and its offset inside its wire form.
+void check_queue(const std::vector<std::string>& q, std::size_t offset, wire::Protocol proto)
+{
+    for (auto& entry : q)
+        for (std::size_t at = 0; at < entry.size();) {
+            if (entry.size() - at < kRecordOverhead || record_size(entry.data() + at) > entry.size() - at)
+                corrupt("record");
+            at += record_size(entry.data() + at);
+        }
+    if (offset && (q.empty() || offset >= wire_size(proto, q.front())))
+        corrupt("queue offset");
+}
+
+std::string encode(const State& s, std::vector<int>& fds)
+{
+    Writer w;
+    w.u32(kMagic);
+    for (int fd : {s.tcp_listener, s.unix_listener, s.shm_listener}) {
+        w.u8(fd >= 0);
+        if (fd >= 0)
+            fds.push_back(fd);
+    }
+    w.u32(static_cast<std::uint32_t>(s.rooms.size()));
+    for (auto& r : s.rooms) {
+        w.str(r.name);
+        w.u64(r.last_seq);
+    }
+    w.u32(static_cast<std::uint32_t>(s.sessions.size()));
+    for (auto& c : s.sessions) {
+        fds.push_back(c.fd);
+        w.u8(static_cast<std::uint8_t>(c.proto));
+        w.u8(c.named);
+        w.str(c.name);
+        w.str(c.room);
+        w.str(c.token);
+        w.str(c.unread);
+        w.strs(c.outbox);
+        w.u64(c.front_offset);
+        w.strs(c.bulk);
+        w.u64(c.bulk_offset);
+    }
+    w.u32(static_cast<std::uint32_t>(s.tickets.size()));
+    for (auto& t : s.tickets) {
+        w.str(t.token);
+        w.str(t.name);
+        w.str(t.room);
+        w.u64(static_cast<std::uint64_t>(std::max<std::int64_t>(0, t.remaining.count())));
+    }
+    return std::move(w.bytes());
+}
+
+/// @p fds arrive in encode() order; each is moved into @p s as it is placed.
+void decode(std::string_view blob, std::vector<int>& fds, State& s)
+{
+    Reader r(blob);
+    std::size_t next_fd = 0;
+    auto take_fd = [&] {
+        if (next_fd == fds.size())
+            corrupt("descriptor count");
+        return std::exchange(fds[next_fd++], -1);
+    };
+    if (r.u32() != kMagic)
+        corrupt("magic");
+    for (int* fd : {&s.tcp_listener, &s.unix_listener, &s.shm_listener})
+        if (r.u8())
+            *fd = take_fd();
+    for (std::uint32_t n = r.u32(); n; --n) {
+        RoomState& room = s.rooms.emplace_back();
+        room.name     = r.str();
+        room.last_seq = r.u64();
+    }
+    for (std::uint32_t n = r.u32(); n; --n) {
+        SessionState& c = s.sessions.emplace_back();
+        c.fd = take_fd();
+        std::uint8_t proto = r.u8();
+        if (proto > static_cast<std::uint8_t>(wire::Protocol::sequenced))
+            corrupt("protocol");
+        c.proto        = static_cast<wire::Protocol>(proto);
+        c.named        = r.u8() != 0;
+        c.name         = r.str();
+        c.room         = r.str();
+        c.token        = r.str();
+        c.unread       = r.str();
+        c.outbox       = r.strs();
+        c.front_offset = r.u64();
+        c.bulk         = r.strs();
+        c.bulk_offset  = r.u64();
+        check_queue(c.outbox, c.front_offset, c.proto);
+        check_queue(c.bulk, c.bulk_offset, c.proto);
+    }
+    for (std::uint32_t n = r.u32(); n; --n) {
+        TicketState& t = s.tickets.emplace_back();
+        t.token     = r.str();
+        t.name      = r.str();
+        t.room      = r.str();
+        t.remaining = std::chrono::milliseconds(r.u64());
+    }
+    if (!r.done() || next_fd != fds.size())
+        corrupt("trailing data");
+}
+
+//──────────────── socket I/O ───────────────────
+void write_all(int sock, const char* p, std::size_t n)
+{
+    while (n) {
+        ssize_t put = ::send(sock, p, n, MSG_NOSIGNAL);
+        if (put < 0 && errno == EINTR)
+            continue;
+        if (put < 0)
+            throw_errno("handoff send");
+        p += put;
+        n -= static_cast<std::size_t>(put);
+    }
+}
+
+/// Exactly @p n bytes – never more, so no byte carrying descriptors is
+/// swallowed by a plain read.
+void read_all(int sock, char* p, std::size_t n)
+{
+    while (n) {
+        ssize_t got = ::recv(sock, p, n, 0);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got < 0)
+            throw_errno("handoff receive");
+        if (got == 0)
+            throw std::runtime_error("handoff: the old server hung up mid-transfer");
+        p += got;
+        n -= static_cast<std::size_t>(got);
+    }
+}
+
+} // namespace
+
+void State::close_all()
+{
+    for (int* fd : {&tcp_listener, &unix_listener, &shm_listener})
+        if (*fd >= 0)
+            ::close(std::exchange(*fd, -1));
+    for (auto& c : sessions)
+        if (c.fd >= 0)
+            ::close(std::exchange(c.fd, -1));
+}
+
+/// [u64 blob bytes][u32 descriptors][blob], then the descriptors, up to
+/// kFdsPerMessage riding on each of a run of one‑byte messages.
+void send(int sock, const State& state)
+{
+    std::vector<int> fds;
+    std::string blob = encode(state, fds);
+    char prefix[kPrefix];
+    wire::put_u64(prefix, blob.size());
+    wire::put_u32(prefix + 8, static_cast<std::uint32_t>(fds.size()));
+    write_all(sock, prefix, sizeof prefix);
+    write_all(sock, blob.data(), blob.size());
+
+    for (std::size_t at = 0; at < fds.size(); at += kFdsPerMessage) {
+        std::size_t n = std::min(kFdsPerMessage, fds.size() - at);
+        char byte = 0;
+        iovec iov{&byte, 1};
+        alignas(cmsghdr) char control[CMSG_SPACE(kFdsPerMessage * sizeof(int))] = {};
+        msghdr msg{};
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = control;
+        msg.msg_controllen = CMSG_SPACE(n * sizeof(int));
+        cmsghdr* c = CMSG_FIRSTHDR(&msg);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type  = SCM_RIGHTS;
+        c->cmsg_len   = CMSG_LEN(n * sizeof(int));
+        std::memcpy(CMSG_DATA(c), fds.data() + at, n * sizeof(int));
+        ssize_t put;
+        while ((put = ::sendmsg(sock, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR)
+            ;
+        if (put != 1)
+            throw_errno("handoff sendmsg");
+    }
+}
+
+State take_over(const std::string& path)
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof addr.sun_path)
+        throw std::runtime_error("handoff: socket path too long: " + path);
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    int sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0)
+        throw_errno("socket");
+    std::vector<int> fds;
+    State state;
+    try {
+        if (::connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+            throw_errno("connect " + path);
+
+        char prefix[kPrefix];
+        read_all(sock, prefix, sizeof prefix);
+        std::uint64_t blob_bytes = wire::get_u64(prefix);
+        std::uint32_t fd_count   = wire::get_u32(prefix + 8);
+        std::string blob(blob_bytes, '\0');
+        read_all(sock, blob.data(), blob.size());
+
+        while (fds.size() < fd_count) {
+            char byte;
+            iovec iov{&byte, 1};
+            alignas(cmsghdr) char control[CMSG_SPACE(kFdsPerMessage * sizeof(int))];
+            msghdr msg{};
+            msg.msg_iov        = &iov;
+            msg.msg_iovlen     = 1;
+            msg.msg_control    = control;
+            msg.msg_controllen = sizeof control;
+            ssize_t got = ::recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got < 0)
+                throw_errno("handoff recvmsg");
+            if (got == 0)
+                throw std::runtime_error("handoff: the old server hung up mid-transfer");
+            for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c))
+                if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+                    std::size_t n = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                    std::size_t at = fds.size();
+                    fds.resize(at + n);
+                    std::memcpy(fds.data() + at, CMSG_DATA(c), n * sizeof(int));
+                }
+            if (msg.msg_flags & MSG_CTRUNC)
+                throw std::runtime_error("handoff: descriptors truncated (out of fds?)");
+        }
+        decode(blob, fds, state);
+
+        // the old process holds this socket until it exits
+        char byte;
+        ssize_t got;
+        while ((got = ::read(sock, &byte, 1)) != 0)
+            if (got < 0 && errno != EINTR)
+                break;
+    }
+    catch (...) {
+        for (int fd : fds)
+            if (fd >= 0)
+                ::close(fd);
+        state.close_all();
+        ::close(sock);
+        throw;
+    }
+    ::close(sock);
+    return state;
+}
+
+} // namespace handoff
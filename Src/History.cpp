@@ -0,0 +1,81 @@
+#include "../include/History.hpp"
+
+MessageHistory::MessageHistory(std::size_t max_messages, std::size_t max_bytes)
+    : max_messages_(max_messages), max_bytes_(max_bytes)
+{
+    // no up-front reserve: there is one history per room and most stay small
+}
+
+void MessageHistory::append(const Payload& msg)
+{
+    append(std::string_view(*msg));
+}
+
+void MessageHistory::append(std::string_view msg)
+{
+    if (!max_messages_ || msg.size() > max_bytes_)
+        return;
+
+    std::scoped_lock lk(mtx_);
+    while (lengths_.size() >= max_messages_ ||
+           buf_.size() - head_ + msg.size() > max_bytes_)
+        evict_front();
+
+    // Slide the window back to the start once the dead prefix is at least as
+    // large as the live part; each byte is moved O(1) times on average.
+    if (head_ && head_ >= buf_.size() - head_) {
+        buf_.erase(0, head_);
+        head_ = 0;
+    }
+
+    buf_ += msg;
+    lengths_.push_back(msg.size());
+    snapshot_.reset();
+}
+
+Payload MessageHistory::snapshot()
+{
+    std::scoped_lock lk(mtx_);
+    if (!snapshot_ && !lengths_.empty())
+        snapshot_ = make_payload(buf_.substr(head_));
+    return snapshot_;
+}
+
+/// Records are appended in sequence order, so the suffix after @p seq is
+/// one contiguous slice of the window.
+MessageHistory::Delta MessageHistory::since(std::uint64_t seq)
+{
+    std::scoped_lock lk(mtx_);
+    Delta d;
+    std::size_t at = head_;
+    for (std::size_t len : lengths_) {
+        if (record_seq(buf_.data() + at) > seq)
+            break;
+        at += len;
+    }
+    if (at == buf_.size())
+        return d;
+    std::uint64_t first = record_seq(buf_.data() + at);
+    if (first > seq + 1)
+        d.lost = first - seq - 1;
+    d.records = at == head_ && snapshot_ ? snapshot_ : make_payload(buf_.substr(at));
+    return d;
+}
+
+std::size_t MessageHistory::size() const
+{
+    std::scoped_lock lk(mtx_);
+    return lengths_.size();
+}
+
+std::size_t MessageHistory::bytes() const
+{
+    std::scoped_lock lk(mtx_);
+    return buf_.size() - head_;
+}
+
+void MessageHistory::evict_front()
+{
+    head_ += lengths_.front();
+    lengths_.pop_front();
+}
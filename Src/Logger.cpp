@@ -0,0 +1,198 @@
+#include "../include/Logger.hpp"
+
+#include <cerrno>
+#include <ctime>
+#include <stdexcept>
+#include <system_error>
+
+namespace logging {
+
+namespace {
+
+std::int64_t now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::size_t round_pow2(std::size_t n)
+{
+    std::size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+} // namespace
+
+const char* to_string(Level l)
+{
+    static constexpr const char* names[] = {"debug", "info", "warn", "error"};
+    return names[static_cast<int>(l)];
+}
+
+bool parse_level(std::string_view s, Level& out)
+{
+    for (int i = 0; i <= static_cast<int>(Level::error); ++i)
+        if (s == to_string(Level(i))) {
+            out = Level(i);
+            return true;
+        }
+    return false;
+}
+
+Logger& Logger::instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+{
+    configure(Config{});
+}
+
+Logger::~Logger()
+{
+    stop_ = true;
+    if (writer_.joinable())
+        writer_.join();
+    if (sink_ != stdout)
+        std::fclose(sink_);
+}
+
+void Logger::configure(const Config& cfg)
+{
+    stop_ = true;                               // drain and stop the old writer
+    if (writer_.joinable())
+        writer_.join();
+
+    std::FILE* sink = stdout;
+    if (!cfg.path.empty()) {
+        sink = std::fopen(cfg.path.c_str(), "a");
+        if (!sink)
+            throw std::system_error(errno, std::generic_category(), "open " + cfg.path);
+    }
+    if (sink_ != stdout)
+        std::fclose(sink_);
+    sink_ = sink;
+
+    std::size_t slots = round_pow2(std::max<std::size_t>(cfg.ring_slots, 2));
+    if (slots != mask_ + 1 || !ring_) {
+        ring_ = std::make_unique<Record[]>(slots);
+        mask_ = slots - 1;
+        tail_ = head_ = 0;
+        for (std::size_t i = 0; i < slots; ++i)
+            ring_[i].seq.store(i, std::memory_order_relaxed);
+    }
+    level_ = static_cast<std::uint8_t>(cfg.level);
+    stop_  = false;
+    writer_ = std::thread([this] { writer_loop(); });
+}
+
+/**
+ * Bounded MPMC ring (Vyukov): a slot is free for the producer whose
+ * position equals its seq, and readable once seq = position + 1. A
+ * producer that finds its slot still unread gives up instead of waiting.
+ */
+bool Logger::push(Level l, std::string_view component, const Line& line)
+{
+    std::size_t pos = tail_.load(std::memory_order_relaxed);
+    Record* r;
+    for (;;) {
+        r = &ring_[pos & mask_];
+        std::size_t seq = r->seq.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+        if (diff == 0) {
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+    r->when_ms = now_ms();
+    r->level   = l;
+    std::size_t c = std::min(component.size(), sizeof r->component);
+    std::memcpy(r->component, component.data(), c);
+    if (c < sizeof r->component)
+        r->component[c] = '\0';
+    r->len = static_cast<std::uint16_t>(line.len);
+    std::memcpy(r->text, line.text, line.len);
+    r->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool Logger::admit(Site& site, Line& line)
+{
+    std::int64_t second = now_ms() / 1000;
+    if (site.second.load(std::memory_order_relaxed) != second) {
+        site.second.store(second, std::memory_order_relaxed);
+        site.count.store(0, std::memory_order_relaxed);
+        if (std::uint32_t n = site.suppressed.exchange(0, std::memory_order_relaxed)) {
+            line.put(" (");
+            line.put(n);
+            line.put(" similar suppressed)");
+        }
+    }
+    if (site.count.fetch_add(1, std::memory_order_relaxed) < kBurst)
+        return true;
+    site.suppressed.fetch_add(1, std::memory_order_relaxed);
+    suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void Logger::emit(std::string& out, std::int64_t when_ms, Level l,
+                  std::string_view component, std::string_view text)
+{
+    std::time_t secs = static_cast<std::time_t>(when_ms / 1000);
+    std::tm tm{};
+    gmtime_r(&secs, &tm);
+    char stamp[64];
+    int n = std::snprintf(stamp, sizeof stamp, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ %-5s %-7.*s ",
+                          tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min,
+                          tm.tm_sec, static_cast<int>(when_ms % 1000), to_string(l),
+                          static_cast<int>(component.size()), component.data());
+    out.append(stamp, static_cast<std::size_t>(n));
+    out.append(text);
+    out += '\n';
+}
+
+/// Drain whatever is readable into one buffer, write and flush it, sleep
+/// briefly when idle. Exits once stopped and empty.
+void Logger::writer_loop()
+{
+    std::string   batch;
+    std::uint64_t reported_drops = dropped_.load(std::memory_order_relaxed);
+    for (;;) {
+        bool stopping = stop_.load(std::memory_order_acquire);
+        for (;;) {
+            Record& r = ring_[head_ & mask_];
+            if (r.seq.load(std::memory_order_acquire) != head_ + 1)
+                break;
+            std::string_view comp(r.component, strnlen(r.component, sizeof r.component));
+            emit(batch, r.when_ms, r.level, comp, std::string_view(r.text, r.len));
+            r.seq.store(head_ + mask_ + 1, std::memory_order_release);
+            ++head_;
+            if (batch.size() >= 64 * 1024)
+                break;
+        }
+        if (std::uint64_t d = dropped_.load(std::memory_order_relaxed); d != reported_drops) {
+            std::string note = "log ring full, " + std::to_string(d - reported_drops) + " lines dropped";
+            emit(batch, now_ms(), Level::warn, "log", note);
+            reported_drops = d;
+        }
+        if (!batch.empty()) {
+            std::fwrite(batch.data(), 1, batch.size(), sink_);
+            std::fflush(sink_);
+            batch.clear();
+            continue;
+        }
+        if (stopping)
+            return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+} // namespace logging
@@ -0,0 +1,188 @@
+#include "../include/MemoryTransport.hpp"
+#include <algorithm>
+#include <mutex>
+
+/**
+ * Both directions of one in‑memory connection, and the transport end's
+ * pending operations. Every member is guarded by mtx; the try_* helpers
+ * run with it held and post whatever they complete.
+ */
+struct MemoryPipe {
+    MemoryPipe(net::any_io_executor e, std::size_t cap) : ex(std::move(e)), capacity(cap) {}
+
+    const net::any_io_executor ex;
+    const std::size_t          capacity;
+
+    std::mutex  mtx;
+    std::string inbound;            ///< peer → transport, not yet read
+    std::string outbound;           ///< transport → peer, not yet taken
+    bool        transport_closed = false;
+    bool        peer_closed      = false;
+    std::size_t lowat            = 0;
+
+    net::mutable_buffer      read_buf;
+    Transport::OwnerPtr      reader;
+    const net::const_buffer* write_bufs = nullptr;
+    std::size_t              write_n    = 0;
+    Transport::OwnerPtr      writer;
+    Transport::OwnerPtr      waiter;
+    HandlerMemory            read_mem, write_mem, wait_mem;
+
+    void try_read()
+    {
+        if (!reader)
+            return;
+        boost::system::error_code ec;
+        std::size_t n = 0;
+        if (transport_closed)
+            ec = net::error::operation_aborted;
+        else if (!inbound.empty()) {
+            n = net::buffer_copy(read_buf, net::buffer(inbound));
+            inbound.erase(0, n);
+        }
+        else if (peer_closed)
+            ec = net::error::eof;
+        else
+            return;
+        net::post(ex, bind_memory(read_mem, [o = std::move(reader), ec, n] { o->on_read(ec, n); }));
+    }
+
+    void try_write()
+    {
+        if (!writer)
+            return;
+        boost::system::error_code ec;
+        std::size_t n = 0;
+        if (transport_closed)
+            ec = net::error::operation_aborted;
+        else if (peer_closed)
+            ec = net::error::broken_pipe;
+        else {
+            std::size_t room = capacity - std::min(capacity, outbound.size());
+            if (!room)
+                return;   // stays pending until the peer takes some
+            for (std::size_t i = 0; i < write_n && room; ++i) {
+                std::size_t k = std::min(room, write_bufs[i].size());
+                outbound.append(static_cast<const char*>(write_bufs[i].data()), k);
+                n    += k;
+                room -= k;
+            }
+        }
+        write_bufs = nullptr;
+        net::post(ex, bind_memory(write_mem, [o = std::move(writer), ec, n] { o->on_write(ec, n); }));
+    }
+
+    void try_wake()
+    {
+        if (!waiter)
+            return;
+        boost::system::error_code ec;
+        if (transport_closed)
+            ec = net::error::operation_aborted;
+        else if (!peer_closed && outbound.size() >= lowat)
+            return;
+        net::post(ex, bind_memory(wait_mem, [o = std::move(waiter), ec] { o->on_writable(ec); }));
+    }
+};
+
+//──────────────── transport end ────────────────
+void MemoryTransport::async_read(net::mutable_buffer buf, OwnerPtr owner)
+{
+    std::scoped_lock lk(pipe_->mtx);
+    pipe_->read_buf = buf;
+    pipe_->reader   = std::move(owner);
+    pipe_->try_read();
+}
+
+void MemoryTransport::async_write(const net::const_buffer* bufs, std::size_t n, OwnerPtr owner)
+{
+    std::scoped_lock lk(pipe_->mtx);
+    pipe_->write_bufs = bufs;
+    pipe_->write_n    = n;
+    pipe_->writer     = std::move(owner);
+    pipe_->try_write();
+}
+
+void MemoryTransport::async_wait_writable(OwnerPtr owner)
+{
+    std::scoped_lock lk(pipe_->mtx);
+    pipe_->waiter = std::move(owner);
+    pipe_->try_wake();
+}
+
+bool MemoryTransport::below_lowat(std::size_t lowat)
+{
+    std::scoped_lock lk(pipe_->mtx);
+    pipe_->lowat = lowat;
+    return pipe_->outbound.size() < lowat;
+}
+
+bool MemoryTransport::is_open() const
+{
+    std::scoped_lock lk(pipe_->mtx);
+    return !pipe_->transport_closed;
+}
+
+void MemoryTransport::close()
+{
+    std::scoped_lock lk(pipe_->mtx);
+    if (pipe_->transport_closed)
+        return;
+    pipe_->transport_closed = true;
+    pipe_->try_read();
+    pipe_->try_write();
+    pipe_->try_wake();
+}
+
+//──────────────── peer end ─────────────────────
+bool MemoryPeer::write(std::string_view bytes)
+{
+    std::scoped_lock lk(pipe_->mtx);
+    if (pipe_->transport_closed || pipe_->peer_closed)
+        return false;
+    pipe_->inbound.append(bytes);
+    pipe_->try_read();
+    return true;
+}
+
+std::string MemoryPeer::take()
+{
+    std::string out;
+    std::scoped_lock lk(pipe_->mtx);
+    out.swap(pipe_->outbound);
+    pipe_->try_write();
+    pipe_->try_wake();
+    return out;
+}
+
+std::size_t MemoryPeer::pending() const
+{
+    std::scoped_lock lk(pipe_->mtx);
+    return pipe_->outbound.size();
+}
+
+bool MemoryPeer::closed() const
+{
+    std::scoped_lock lk(pipe_->mtx);
+    return pipe_->transport_closed;
+}
+
+void MemoryPeer::close()
+{
+    if (!pipe_)
+        return;
+    std::scoped_lock lk(pipe_->mtx);
+    if (pipe_->peer_closed)
+        return;
+    pipe_->peer_closed = true;
+    pipe_->try_read();
+    pipe_->try_write();
+    pipe_->try_wake();
+}
+
+std::pair<std::unique_ptr<MemoryTransport>, MemoryPeer>
+make_memory_pair(net::any_io_executor ex, std::size_t capacity)
+{
+    auto pipe = std::make_shared<MemoryPipe>(std::move(ex), capacity);
+    return {std::make_unique<MemoryTransport>(pipe), MemoryPeer(pipe)};
+}
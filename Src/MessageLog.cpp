@@ -0,0 +1,347 @@
+#include "../include/MessageLog.hpp"
+#include "../include/Framing.hpp"
+#include "../include/Logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+[[noreturn]] void throw_errno(const std::string& what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+/// CRC‑32 (IEEE), slicing‑by‑8: eight table lookups per 8 input bytes.
+std::uint32_t crc32(const char* p, std::size_t n)
+{
+    static const auto table = [] {
+        std::array<std::array<std::uint32_t, 256>, 8> t{};
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[0][i] = c;
+        }
+        for (std::uint32_t i = 0; i < 256; ++i)
+            for (int k = 1; k < 8; ++k)
+                t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+        return t;
+    }();
+    auto b = reinterpret_cast<const unsigned char*>(p);
+    std::uint32_t c = 0xFFFFFFFFu;
+    for (; n >= 8; n -= 8, b += 8) {
+        std::uint32_t lo = c ^ (std::uint32_t(b[0]) | std::uint32_t(b[1]) << 8 |
+                                std::uint32_t(b[2]) << 16 | std::uint32_t(b[3]) << 24);
+        c = table[7][lo & 0xFF] ^ table[6][(lo >> 8) & 0xFF] ^
+            table[5][(lo >> 16) & 0xFF] ^ table[4][lo >> 24] ^
+            table[3][b[4]] ^ table[2][b[5]] ^ table[1][b[6]] ^ table[0][b[7]];
+    }
+    for (; n; --n, ++b)
+        c = table[0][(c ^ *b) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+/// Read‑only mapping of a whole file; empty files map to an empty view.
+class Mapping
+{
+public:
+    explicit Mapping(const std::string& path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw_errno("open " + path);
+        struct stat st{};
+        if (::fstat(fd, &st) < 0) {
+            ::close(fd);
+            throw_errno("stat " + path);
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_) {
+            void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw_errno("mmap " + path);
+            }
+            ::madvise(p, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(p);
+        }
+        ::close(fd);
+    }
+    ~Mapping()
+    {
+        if (data_)
+            ::munmap(const_cast<char*>(data_), size_);
+    }
+    Mapping(const Mapping&)            = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    std::string_view view() const { return {data_, size_}; }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+/**
+ * Walk the entries of one segment. Stops at the first entry that is cut
+ * short or fails its checksum and returns the length of the intact prefix.
+ */
+template <class F>
+std::size_t scan(std::string_view seg, F&& visit)
+{
+    std::size_t pos = 0;
+    while (seg.size() - pos >= MessageLog::kEntryOverhead) {
+        const char* e = seg.data() + pos;
+        std::size_t len = wire::get_u32(e);
+        if (len < MessageLog::kEntryOverhead - 4 || len > seg.size() - pos - 4)
+            break;
+        if (crc32(e + 8, len - 4) != wire::get_u32(e + 4))
+            break;
+        std::uint64_t seq      = wire::get_u64(e + 8);
+        std::size_t   room_len = static_cast<unsigned char>(e[16]);
+        if (MessageLog::kEntryOverhead - 4 + room_len > len)
+            break;
+        visit(seq, std::string_view(e + 17, room_len),
+              std::string_view(e + 17 + room_len, len - (MessageLog::kEntryOverhead - 4) - room_len));
+        pos += 4 + len;
+    }
+    return pos;
+}
+
+std::string segment_name(std::uint64_t first_seq)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof buf, "%020llu.log", static_cast<unsigned long long>(first_seq));
+    return buf;
+}
+
+} // namespace
+
+MessageLog::MessageLog(const LogConfig& cfg)
+    : cfg_(cfg)
+{
+    if (::mkdir(cfg_.dir.c_str(), 0755) < 0 && errno != EEXIST)
+        throw_errno("mkdir " + cfg_.dir);
+
+    DIR* dir = ::opendir(cfg_.dir.c_str());
+    if (!dir)
+        throw_errno("opendir " + cfg_.dir);
+    while (dirent* d = ::readdir(dir)) {
+        std::string_view name = d->d_name;
+        if (name.size() != 24 || name.substr(20) != ".log")
+            continue;
+        segments_.push_back({std::stoull(std::string(name.substr(0, 20))),
+                             cfg_.dir + "/" + std::string(name)});
+    }
+    ::closedir(dir);
+    std::sort(segments_.begin(), segments_.end(),
+              [](const Segment& a, const Segment& b) { return a.first_seq < b.first_seq; });
+
+    recover_tail();
+    writer_ = std::thread([this] { writer_loop(); });
+}
+
+MessageLog::~MessageLog()
+{
+    {
+        std::scoped_lock lk(mtx_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    if (writer_.joinable())
+        writer_.join();
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+/// Find last_seq_ in the newest segment, cut off a torn tail, reopen it for append.
+void MessageLog::recover_tail()
+{
+    // a crash right after rolling can leave empty segments at the end
+    while (!segments_.empty()) {
+        std::size_t valid;
+        {
+            Mapping m(segments_.back().path);
+            valid = scan(m.view(), [&](std::uint64_t seq, auto, auto) { last_seq_ = seq; });
+            if (valid < m.view().size()) {
+                LOG_WARN("log", segments_.back().path, ": dropping ",
+                         m.view().size() - valid, " bytes of torn tail");
+                if (::truncate(segments_.back().path.c_str(), static_cast<off_t>(valid)) < 0)
+                    throw_errno("truncate " + segments_.back().path);
+            }
+        }
+        if (valid || segments_.size() == 1) {
+            fd_ = ::open(segments_.back().path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+            if (fd_ < 0)
+                throw_errno("open " + segments_.back().path);
+            seg_size_ = valid;
+            if (!last_seq_)
+                last_seq_ = segments_.back().first_seq - 1;
+            return;
+        }
+        ::unlink(segments_.back().path.c_str());
+        segments_.pop_back();
+    }
+    open_segment(1);
+}
+
+void MessageLog::open_segment(std::uint64_t first_seq)
+{
+    std::string path = cfg_.dir + "/" + segment_name(first_seq);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw_errno("open " + path);
+    if (fd_ >= 0)
+        ::close(fd_);
+    fd_       = fd;
+    seg_size_ = 0;
+    segments_.push_back({first_seq, std::move(path)});
+}
+
+std::uint64_t MessageLog::replay(const Visitor& visit) const
+{
+    std::uint64_t n = 0;
+    for (auto& seg : segments_) {
+        Mapping m(seg.path);
+        scan(m.view(), [&](std::uint64_t seq, std::string_view room, std::string_view rec) {
+            visit(seq, room, rec);
+            ++n;
+        });
+    }
+    return n;
+}
+
+std::uint64_t MessageLog::append(std::string_view room, std::string_view record)
+{
+    room = room.substr(0, 255);
+    std::size_t len = kEntryOverhead - 4 + room.size() + record.size();
+
+    std::unique_lock lk(mtx_);
+    if (failed_ || pending_.size() + 4 + len > cfg_.max_pending_bytes) {
+        stats_.dropped.add();
+        return 0;
+    }
+    std::uint64_t seq = ++last_seq_;
+    bool wake = pending_.empty();
+    if (wake)
+        pending_first_ = seq;
+
+    std::size_t at = pending_.size();
+    pending_.resize(at + kEntryOverhead);
+    char* e = pending_.data() + at;
+    wire::put_u32(e,      static_cast<std::uint32_t>(len));
+    wire::put_u64(e + 8,  seq);
+    e[16] = static_cast<char>(room.size());
+    pending_.append(room);
+    pending_.append(record);                 // crc is filled in by the writer
+    stats_.appended.add();
+    lk.unlock();
+
+    if (wake)
+        cv_.notify_one();
+    return seq;
+}
+
+std::uint64_t MessageLog::last_seq() const
+{
+    std::scoped_lock lk(mtx_);
+    return last_seq_;
+}
+
+/**
+ * Swap the pending buffer out, checksum it, write it in one go, and
+ * fdatasync when the group‑commit interval has passed (or on shutdown).
+ * Both buffers keep their capacity, so a steady stream of appends
+ * doesn't allocate.
+ */
+void MessageLog::writer_loop()
+{
+    using clock = std::chrono::steady_clock;
+    const auto interval = std::chrono::milliseconds(cfg_.fsync_ms);
+    auto last_sync = clock::now();
+    bool dirty = false;
+    std::string batch;
+
+    std::unique_lock lk(mtx_);
+    for (;;) {
+        auto ready = [&] { return stop_ || !pending_.empty(); };
+        if (!dirty)
+            cv_.wait(lk, ready);
+        else
+            cv_.wait_until(lk, last_sync + interval, ready);
+
+        bool          stopping = stop_;
+        std::uint64_t first    = pending_first_;
+        batch.swap(pending_);
+        lk.unlock();
+
+        if (!batch.empty() && fd_ >= 0) {
+            for (std::size_t pos = 0; pos < batch.size();) {
+                char* e = batch.data() + pos;
+                std::size_t len = wire::get_u32(e);
+                wire::put_u32(e + 4, crc32(e + 8, len - 4));
+                pos += 4 + len;
+            }
+            if (seg_size_ && seg_size_ >= cfg_.segment_bytes) {
+                if (dirty)
+                    sync();
+                dirty = false;
+                try {
+                    open_segment(first);
+                } catch (const std::exception& e) {
+                    LOG_ERROR("log", e.what(), ", persistence disabled");
+                    ::close(fd_);
+                    fd_ = -1;
+                }
+            }
+            std::size_t off = 0;
+            while (fd_ >= 0 && off < batch.size()) {
+                ssize_t n = ::write(fd_, batch.data() + off, batch.size() - off);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n < 0) {
+                    LOG_ERROR("log", "write failed: ", std::strerror(errno),
+                              ", persistence disabled");
+                    ::close(fd_);
+                    fd_ = -1;
+                    break;
+                }
+                off += static_cast<std::size_t>(n);
+            }
+            seg_size_ += off;
+            stats_.bytes.add(off);
+            stats_.batches.add();
+            dirty = off > 0;
+        }
+        if (dirty && (stopping || !cfg_.fsync_ms || clock::now() - last_sync >= interval)) {
+            sync();
+            dirty     = false;
+            last_sync = clock::now();
+        }
+        batch.clear();
+
+        lk.lock();
+        if (fd_ < 0)
+            failed_ = true;
+        if (stopping && pending_.empty())
+            return;
+    }
+}
+
+void MessageLog::sync()
+{
+    if (fd_ >= 0 && ::fdatasync(fd_) == 0)
+        stats_.fsyncs.add();
+}
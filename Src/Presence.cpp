@@ -0,0 +1,77 @@
+#include "../include/Presence.hpp"
+#include <algorithm>
+
+bool Roster::change(std::string_view name, int by)
+{
+    std::scoped_lock lk(mtx_);
+    auto it = present_.find(name);
+    if (by > 0) {
+        if (it == present_.end())
+            it = present_.emplace(std::string(name), 0).first;
+        ++it->second;
+    }
+    else if (it == present_.end())
+        return false;                       // never announced; nothing to undo
+    else if (--it->second == 0)
+        present_.erase(it);
+
+    if (!coalesce_)
+        return false;
+    auto p = pending_.emplace(std::string(name), 0).first;
+    if ((p->second += by) == 0)
+        pending_.erase(p);                  // joined and left within one tick
+    bool first = !dirty_;
+    dirty_ = true;
+    return first;
+}
+
+void Roster::restore(std::string_view name)
+{
+    std::scoped_lock lk(mtx_);
+    auto it = present_.find(name);
+    if (it == present_.end())
+        it = present_.emplace(std::string(name), 0).first;
+    ++it->second;
+}
+
+std::vector<std::string> Roster::names() const
+{
+    std::scoped_lock lk(mtx_);
+    std::vector<std::string> out;
+    out.reserve(present_.size());
+    for (auto& [name, n] : present_)
+        out.push_back(name);
+    return out;
+}
+
+std::size_t Roster::size() const
+{
+    std::scoped_lock lk(mtx_);
+    return present_.size();
+}
+
+std::string Roster::take_update(std::string_view room, std::size_t max_names)
+{
+    std::vector<std::string> joined, left;
+    {
+        std::scoped_lock lk(mtx_);
+        dirty_ = false;
+        if (pending_.empty())
+            return {};
+        for (auto& [name, net] : pending_)
+            (net > 0 ? joined : left).push_back(name);
+        pending_.clear();
+    }
+
+    std::string line = "[server] #" + std::string(room) + ":";
+    if (joined.size() + left.size() > max_names) {
+        line += ' ' + std::to_string(joined.size()) + " joined, "
+              + std::to_string(left.size()) + " left (/who lists everyone)";
+        return line;
+    }
+    std::sort(joined.begin(), joined.end());
+    std::sort(left.begin(), left.end());
+    for (auto& n : joined) line += " +" + n;
+    for (auto& n : left)   line += " -" + n;
+    return line;
+}
@@ -1,97 +1,615 @@
 #include "../include/session.hpp"
+#include "../include/Logger.hpp"
+#include <algorithm>
 #include <iostream>
 
-Session::Session(tcp::socket socket, int id, NameCallback name_cb,
-                 MsgCallback msg_cb, DiconnectCallBack dis_cb)
-    : socket_(std::move(socket)), client_id_(id),
+namespace {
+// used by sessions created without a shard (benchmarks): default limits,
+// no global cap
+SessionContext default_context;
+} // namespace
+
+Session::Session(std::unique_ptr<Transport> transport, SessionId id,
+                 NameCallback name_cb, MsgCallback msg_cb,
+                 DiconnectCallBack dis_cb, SessionContext *ctx)
+    : transport_(std::move(transport)), client_id_(id),
       name_callback_(std::move(name_cb)), msg_callback_(std::move(msg_cb)),
-      dis_callback_(std::move(dis_cb)) {}
-
-void Session::start() { read_name(); }
-
-// ──────────────── phase 1 – name ───────────────
-void Session::read_name() {
-  auto self = shared_from_this();
-  net::async_read_until(
-      socket_, streambuf_, '\n', [this, self](auto ec, std::size_t length) {
-        if (ec) {
-          std::cerr << "Read name error: " << ec.message() << '\n';
-          dis_callback_(client_id_);
-          return;
-        }
-        std::istream is(&streambuf_);
-        std::getline(is, client_name_);
-        streambuf_.consume(length); // discard bytes
-        name_callback_(client_id_, client_name_);
-        do_read(); // switch to chat mode
-      });
+      dis_callback_(std::move(dis_cb)), timer_([this] { on_timer(); }),
+      resume_timer_([this] { resume_reading(); }),
+      ctx_(ctx ? ctx : &default_context) {
+  const RateLimitConfig &rl = ctx_->rate_limits;
+  in_messages_ = message_bucket(rl.session_messages, rl.burst_seconds);
+  in_bytes_ = byte_bucket(rl.session_bytes, rl.burst_seconds, ctx_->max_message);
+  rate_limited_ = rl.per_session();
+}
+
+Session::Session(tcp::socket socket, SessionId id, NameCallback name_cb,
+                 MsgCallback msg_cb, DiconnectCallBack dis_cb,
+                 SessionContext *ctx)
+    : Session(std::make_unique<TcpTransport>(std::move(socket)), id,
+              std::move(name_cb), std::move(msg_cb), std::move(dis_cb), ctx) {}
+
+void Session::set_address_limit(std::shared_ptr<AddressLimit> limit) {
+  address_limit_ = std::move(limit);
+  rate_limited_ = rate_limited_ || address_limit_;
+}
+
+Session::~Session() {
+  if (ctx_->global_queued)
+    ctx_->global_queued->fetch_sub(queued_bytes_, std::memory_order_relaxed);
 }
 
-// ──────────────── phase 2 – chat loop ───────────
+void Session::start() {
+  if (TimerWheel *wheel = ctx_->timeouts.wheel) {
+    opened_ = last_in_ = wheel->now();
+    arm_timer();
+  }
+  if (!outbox_.empty() || !bulk_.empty()) // restored from a predecessor
+    do_write();
+  if (parse_input())
+    do_read();
+}
+
+// ──────────────── read loop ─────────────────────
+// One flat buffer for both protocols: read whatever the kernel has, then
+// parse every complete message in place. Messages reach the Server as
+// string_views into rbuf_, so nothing is copied or allocated per line.
 void Session::do_read() {
-  auto self = shared_from_this();
-    net::async_read_until(socket_, streambuf_, '\n',
-        [this, self](const boost::system::error_code& ec, std::size_t /*len*/)
-        {
-            if (ec) {
-                std::cerr << "[Session for client " <<  client_name_ << "] read failed: " << ec.message() << '\n';
-                if (dis_callback_) dis_callback_(client_id_);
-                return;
-            }
-
-            std::istream is(&streambuf_);
-            std::string line;
-            std::getline(is, line);
-
-            if (line == "/quit") {  // client wants out
-                if (dis_callback_) dis_callback_(client_id_);
-                stop();
-                return;
-            }
-            msg_callback_(client_id_, line);
-           
-            
-
-            do_read();   
-        });
+  reading_ = true;
+  transport_->async_read(net::buffer(rbuf_.prepare(kReadChunk), kReadChunk),
+                         shared_from_this());
+}
+
+void Session::on_read(const boost::system::error_code &ec, std::size_t n) {
+  reading_ = false;
+  if (frozen_) { // cancelled for a handoff; keep whatever did arrive
+    if (!ec) {
+      ctx_->stats.bytes_in.add(n);
+      rbuf_.commit(n);
+    }
+    return;
+  }
+  if (ec) {
+    if (closing_) { // we closed it (slow consumer); already explained
+      notify_disconnect(*closing_);
+      return;
+    }
+    if (named_)
+      LOG_INFO("session", "[Session for client ", client_name_,
+               "] read failed: ", ec.message());
+    else
+      LOG_INFO("session", "Read name error: ", ec.message());
+    notify_disconnect(ec == net::error::eof ? DisconnectReason::eof
+                                            : DisconnectReason::error);
+    return;
+  }
+  ctx_->stats.bytes_in.add(n);
+  if (ctx_->timeouts.wheel)
+    last_in_ = ctx_->timeouts.wheel->now(); // any byte counts as alive
+  rbuf_.commit(n);
+  if (parse_input())
+    do_read();
+}
+
+bool Session::parse_input() {
+  std::string_view msg;
+  std::size_t used = 0;
+  TokenBucket::Clock::time_point now{}; // read once, only if limits apply
+  for (;;) {
+    switch (wire::next_message(proto_, rbuf_.data(), ctx_->max_message, msg,
+                               used)) {
+    case wire::Parse::need_more:
+      return true;
+    case wire::Parse::too_large:
+      LOG_WARN("session", "[Session for client ", client_name_,
+               "] message exceeds ", ctx_->max_message, " bytes, disconnecting");
+      notify_disconnect(DisconnectReason::protocol);
+      stop();
+      return false;
+    case wire::Parse::message:
+      break;
+    }
+    if (named_ && rate_limited_) { // the name itself is never limited
+      if (now == TokenBucket::Clock::time_point{})
+        now = TokenBucket::Clock::now();
+      bool by_address = false;
+      auto wait = charge(msg.size(), now, by_address);
+      if (wait != TokenBucket::Clock::duration::zero()) {
+        auto &st = ctx_->stats;
+        (by_address ? st.rate_limited_address : st.rate_limited_session).add();
+        RateLimitAction action = ctx_->rate_limits.action;
+        if (action == RateLimitAction::throttle && !ctx_->timeouts.wheel)
+          action = RateLimitAction::drop;
+        switch (action) {
+        case RateLimitAction::drop:
+          st.rate_dropped.add();
+          rbuf_.consume(used);
+          continue;
+        case RateLimitAction::disconnect:
+          LOG_WARN("session", "[Session for client ", client_name_,
+                   "] over its rate limit, disconnecting");
+          notify_disconnect(DisconnectReason::rate_limited);
+          stop();
+          return false;
+        case RateLimitAction::throttle:
+          pause_reading(wait); // the message stays buffered
+          return false;
+        }
+      }
+    }
+    bool keep_going = on_message(msg);
+    rbuf_.consume(used);
+    if (!keep_going)
+      return false;
+  }
 }
+
+bool Session::on_message(std::string_view msg) {
+  // ── phase 1 – name (optionally preceded by the framing hello) ──
+  if (!named_) {
+    if (proto_ == wire::Protocol::text && msg == wire::kFrameHello) {
+      proto_ = wire::Protocol::framed;
+      return true;
+    }
+    if (proto_ == wire::Protocol::text && msg == wire::kSeqHello) {
+      proto_ = wire::Protocol::sequenced;
+      return true;
+    }
+    client_name_.assign(msg);
+    named_ = true;
+    if (ctx_->timeouts.wheel)
+      arm_timer(); // handshake deadline → heartbeat / idle
+    if (name_callback_)
+      name_callback_(client_id_, client_name_);
+    return true;
+  }
+
+  if (msg == wire::kPong) // liveness only; the read already counted
+    return true;
+  if (msg == wire::kPing) {
+    deliver(wire::kPong);
+    return true;
+  }
+
+  // ── phase 2 – chat ──
+  if (msg == "/quit") { // client wants out
+    notify_disconnect(DisconnectReason::quit);
+    stop();
+    return false;
+  }
+  ctx_->stats.messages_in.add();
+  if (msg_callback_)
+    msg_callback_(client_id_, msg);
+  return true;
+}
+
+void Session::notify_disconnect(DisconnectReason why) {
+  ctx_->stats.disconnects[static_cast<int>(why)].add();
+  if (dis_callback_)
+    dis_callback_(client_id_, why);
+}
+
+// ──────────────── deadlines ─────────────────────
+// The wheel entry always sits at the earliest deadline that could apply.
+// Reads only move last_in_, so when the entry fires the deadline may have
+// moved on; on_timer() then just re‑arms it. An active session therefore
+// costs one wheel step per heartbeat interval, not one per read.
+void Session::arm_timer() {
+  const SessionTimeouts &t = ctx_->timeouts;
+  TimerWheel::Tick due = 0;
+  auto earliest = [&due](TimerWheel::Tick at) {
+    if (!due || at < due)
+      due = at;
+  };
+  if (!named_) {
+    if (t.handshake)
+      earliest(opened_ + t.handshake);
+  } else if (proto_ != wire::Protocol::text) {
+    // only clients that sent a protocol hello know to answer pings; a
+    // text client may be an old one that would show "/ping" as a chat
+    // line and never reply, so it is left alone once named, as it always was
+    if (t.idle)
+      earliest(last_in_ + t.idle);
+    if (t.heartbeat)
+      earliest(std::max(last_in_, last_ping_) + t.heartbeat);
+  }
+  if (due)
+    t.wheel->schedule(timer_, due);
+  else
+    timer_.cancel();
+}
+
+void Session::on_timer() {
+  if (closing_ || !transport_->is_open())
+    return;
+  const SessionTimeouts &t = ctx_->timeouts;
+  const TimerWheel::Tick now = t.wheel->now();
+  if (!named_) {
+    if (t.handshake && now >= opened_ + t.handshake) {
+      reap(DisconnectReason::handshake_timeout);
+      return;
+    }
+  } else if (proto_ != wire::Protocol::text) {
+    if (t.idle && now >= last_in_ + t.idle) {
+      reap(DisconnectReason::idle_timeout);
+      return;
+    }
+    if (t.heartbeat && now >= std::max(last_in_, last_ping_) + t.heartbeat) {
+      deliver(wire::kPing);
+      last_ping_ = now;
+      ctx_->stats.heartbeats.add();
+    }
+  }
+  arm_timer();
+}
+
+void Session::reap(DisconnectReason why) {
+  LOG_INFO("session", "[Session for client ",
+           named_ ? std::string_view(client_name_) : std::string_view("(unnamed)"),
+           "] ", to_string(why), ", disconnecting");
+  closing_ = why;
+  stop(); // pending read fails → notify_disconnect()
+}
+
+// ──────────────── inbound rate limits ───────────
+TokenBucket::Clock::duration Session::charge(std::size_t bytes,
+                                             TokenBucket::Clock::time_point now,
+                                             bool &by_address) {
+  const double n = static_cast<double>(bytes);
+  auto wait = std::max(in_messages_.wait(1, now), in_bytes_.wait(n, now));
+  if (address_limit_) {
+    AddressLimit &a = *address_limit_;
+    std::scoped_lock lk(a.mtx);
+    auto shared = std::max(a.messages.wait(1, now), a.bytes.wait(n, now));
+    if (shared > wait) {
+      wait = shared;
+      by_address = true;
+    }
+    if (wait == TokenBucket::Clock::duration::zero()) {
+      a.messages.take(1);
+      a.bytes.take(n);
+    }
+  }
+  if (wait == TokenBucket::Clock::duration::zero()) {
+    in_messages_.take(1);
+    in_bytes_.take(n);
+  }
+  return wait;
+}
+
+// No read is outstanding while paused, so the client's socket buffer
+// fills and TCP pushes back on it (a MemoryPeer just keeps buffering); its unparsed bytes wait in rbuf_.
+void Session::pause_reading(TokenBucket::Clock::duration wait) {
+  ctx_->stats.throttles.add();
+  const auto tick = ctx_->timeouts.tick;
+  auto ticks = static_cast<TimerWheel::Tick>((wait + tick - TokenBucket::Clock::duration(1)) / tick);
+  ctx_->timeouts.wheel->schedule_in(resume_timer_, ticks);
+}
+
+void Session::resume_reading() {
+  if (closing_ || !transport_->is_open()) {
+    // closed while paused: there is no read to fail and report it
+    if (closing_)
+      notify_disconnect(*closing_);
+    return;
+  }
+  auto self = shared_from_this(); // parse_input() may end the session
+  if (parse_input())
+    do_read();
+}
+
 void Session::print_incoming(const std::string &msg) {
   std::cout << "\r\x1B[2K" << msg << std::flush;
 }
 
 // ──────────────── write queue ───────────────────
-void Session::deliver(const std::string &msg) {
+void Session::deliver(std::string_view body) { deliver(make_message(body)); }
 
-  bool in_progress = !outbox_.empty();
-  outbox_.push_back(msg);
-  //if there are still message that need to be printed before this one 
-  if (!in_progress)
+void Session::deliver(Payload msg, Priority prio) {
+  if (!transport_->is_open())
+    return;
+  if (prio == Priority::bulk) {
+    // bulk never triggers the slow-consumer policy; past its cap it is lost
+    if (bulk_queued_ + msg->size() > ctx_->limits.bulk_bytes) {
+      ctx_->stats.bulk_dropped.add();
+      return;
+    }
+    bulk_queued_ += msg->size();
+    bulk_.push_back(std::move(msg));
+    if (!writing_ && !frozen_)
+      do_write();
+    return;
+  }
+  if (!admit(msg->size()))
+    return;
+  push_queued(std::move(msg), outbox_.size());
+  ctx_->stats.outbox_depth.observe(outbox_.size());
+  // a write in flight picks this up when it completes
+  if (!writing_ && !frozen_)
     do_write();
 }
 
-void Session::stop() {
-  if (socket_.is_open()) {
-    boost::system::error_code ec;
-    if (auto rc = socket_.shutdown(tcp::socket::shutdown_both, ec);
-        rc && rc != boost::asio::error::not_connected) {
-      std::cerr << "shutdown failed: " << rc.message() << '\n';
+void Session::stop() { transport_->close(); }
+
+void Session::detach() {
+  name_callback_ = nullptr;
+  msg_callback_ = nullptr;
+  dis_callback_ = nullptr;
+}
+
+// ──────────────── hot upgrade ───────────────────
+// A cancelled write has written nothing, a cancelled read has read nothing;
+// one that finished first reports what it did. Either way, once every
+// completion has run (quiescent()), rbuf_ and the queues say exactly what
+// the client has sent and been sent.
+bool Session::freeze() {
+  if (!transport_->transferable())
+    return false;
+  frozen_ = true;
+  timer_.cancel();
+  resume_timer_.cancel();
+  transport_->cancel();
+  return true;
+}
+
+void Session::hand_off(handoff::SessionState &out) {
+  out.fd = transport_->release();
+  out.proto = proto_;
+  out.named = named_;
+  out.unread.assign(rbuf_.data());
+  for (std::size_t i = 0; i < outbox_.size(); ++i)
+    out.outbox.emplace_back(*outbox_[i]);
+  out.front_offset = front_offset_;
+  for (std::size_t i = 0; i < bulk_.size(); ++i)
+    out.bulk.emplace_back(*bulk_[i]);
+  out.bulk_offset = bulk_offset_;
+  while (!outbox_.empty()) // off the global count; the successor has them
+    pop_queued(0);
+  gap_marker_.reset();
+}
+
+void Session::restore(handoff::SessionState &in) {
+  proto_ = in.proto;
+  named_ = in.named;
+  client_name_ = in.name;
+  std::string_view unread = in.unread;
+  std::copy(unread.begin(), unread.end(), rbuf_.prepare(unread.size()));
+  rbuf_.commit(unread.size());
+  for (auto &rec : in.outbox)
+    push_queued(make_payload(std::move(rec)), outbox_.size());
+  front_offset_ = in.front_offset;
+  for (auto &rec : in.bulk) {
+    bulk_queued_ += rec.size();
+    bulk_.push_back(make_payload(std::move(rec)));
+  }
+  bulk_offset_ = in.bulk_offset;
+}
+
+// Gather as many queued messages as fit under kMaxWriteBuffers /
+// kMaxWriteBytes into one async_write, so a backlog of N messages costs
+// ~N/64 syscalls and completion handlers instead of N. Each record maps to
+// one contiguous span in either protocol (see Payload.hpp); front_offset_
+// counts wire bytes of the front entry that are already sent.
+//
+// Records can't interleave on the wire, so a write carries, in order:
+//   1. the rest of a bulk record the previous write cut short,
+//   2. the interactive outbox,
+//   3. up to kBulkQuantum of bulk, and only while the transport holds
+//      fewer than kBulkLowat unsent bytes – a transfer may not fill the
+//      socket buffer, or live messages would queue behind it there instead.
+// With only bulk queued and no room for it, wait for the transport to drain;
+// an interactive message arriving meanwhile is written at once.
+void Session::do_write() {
+  gather_n_ = 0;
+  std::size_t bytes = 0;
+  std::size_t bulk_next = 0;
+  if (bulk_offset_)
+    bulk_next = gather(bulk_, 0, 1, bulk_offset_, bytes, SIZE_MAX);
+  plan_lead_ = bytes;
+  in_flight_ = gather(outbox_, 0, outbox_.size(), front_offset_, bytes, kMaxWriteBytes);
+  plan_live_ = bytes - plan_lead_;
+  if (bulk_next < bulk_.size() && bytes < kMaxWriteBytes &&
+      transport_->below_lowat(kBulkLowat))
+    gather(bulk_, bulk_next, bulk_.size(), 0, bytes,
+           std::min(kMaxWriteBytes, bytes + kBulkQuantum));
+  if (!gather_n_) {
+    wait_writable();
+    return;
+  }
+
+  writing_ = true;
+  for (std::size_t i = 0; gap_marker_ && i < in_flight_; ++i)
+    if (outbox_[i] == gap_marker_) { // marker is on the wire; start afresh
+      gap_marker_.reset();
+      gap_count_ = 0;
     }
+  ctx_->stats.write_calls.add();
 
-    if (auto rc = socket_.close(ec);
-        rc && rc != boost::asio::error::not_connected) {
-      std::cerr << "close failed: " << rc.message() << '\n';
+  transport_->async_write(gather_.data(), gather_n_, shared_from_this());
+}
+
+void Session::on_write(const boost::system::error_code &ec, std::size_t n) {
+  if (ec) {
+    if (frozen_) { // cancelled for a handoff: nothing was written
+      writing_ = false;
+      in_flight_ = 0;
     }
+    return; // else leave writing_ set: the transport is dead, do_read reports it
   }
+  writing_ = false;
+  in_flight_ = 0;
+  on_written(n);
+  if (!frozen_ && (!outbox_.empty() || !bulk_.empty()))
+    do_write();
 }
 
-void Session::do_write() {
-  auto self = shared_from_this();
-  net::async_write(socket_, net::buffer(outbox_.front()),
-                   [this, self](auto ec, std::size_t) {
-                     if (!ec) {
-                       outbox_.pop_front();
-                       if (!outbox_.empty())
-                         do_write();
-                     }
-                   });
+std::size_t Session::gather(const RingQueue<Payload> &q, std::size_t first,
+                            std::size_t last, std::size_t skip,
+                            std::size_t &bytes, std::size_t cap) {
+  std::size_t entries = 0;
+  for (std::size_t i = first; i < last; ++i) {
+    const Payload &msg = q[i];
+    if (gather_n_ == kMaxWriteBuffers || bytes >= cap)
+      break;
+    ++entries;
+    for (std::size_t at = 0; at < msg->size();) {
+      if (gather_n_ == kMaxWriteBuffers || bytes >= cap)
+        break;
+      WireSpan span = wire_span(proto_, msg->data() + at);
+      at += record_size(msg->data() + at);
+      if (skip >= span.size) {
+        skip -= span.size;
+        continue;
+      }
+      gather_[gather_n_++] = net::buffer(span.data + skip, span.size - skip);
+      bytes += span.size - skip;
+      skip = 0;
+    }
+  }
+  return entries;
+}
+
+void Session::on_written(std::size_t n) {
+  ctx_->stats.bytes.add(n);
+
+  // the write was [bulk remainder][interactive][bulk]; a short write ends
+  // in exactly one of them, and that queue keeps the partial offset
+  std::size_t lead = std::min(n, plan_lead_);
+  std::size_t live = std::min(n - lead, plan_live_);
+  std::size_t done = advance(true, lead) + advance(false, live) +
+                     advance(true, n - lead - live);
+  if (done)
+    ctx_->stats.messages.add(done);
+}
+
+std::size_t Session::advance(bool bulk, std::size_t n) {
+  RingQueue<Payload> &q = bulk ? bulk_ : outbox_;
+  std::size_t &offset = bulk ? bulk_offset_ : front_offset_;
+  std::size_t done = 0;
+  std::size_t strip = wire_strip(proto_);
+  n += offset;
+  while (!q.empty()) {
+    std::size_t records = record_count(*q.front());
+    std::size_t size = q.front()->size() - records * strip;
+    if (n < size)
+      break;
+    n -= size;
+    if (bulk) {
+      bulk_queued_ -= q.front()->size();
+      q.pop_front();
+    } else {
+      pop_queued(0);
+    }
+    done += records;
+  }
+  offset = n; // partial write: resume mid‑message next time
+  return done;
+}
+
+/// Not a write: deliver() may still start one for an interactive message,
+/// and whichever finishes second finds the other done.
+void Session::wait_writable() {
+  if (bulk_waiting_)
+    return;
+  bulk_waiting_ = true;
+  ctx_->stats.bulk_waits.add();
+  transport_->async_wait_writable(shared_from_this());
+}
+
+void Session::on_writable(const boost::system::error_code &ec) {
+  bulk_waiting_ = false;
+  if (!ec && !writing_ && !frozen_ && !bulk_.empty())
+    do_write();
+}
+
+// ──────────────── outbox bounds ─────────────────
+bool Session::over_limit(std::size_t incoming) const {
+  const auto &lim = ctx_->limits;
+  if (queued_bytes_ + incoming > lim.session_bytes)
+    return true;
+  // the global budget only pushes back on sessions that already lag
+  return ctx_->global_queued && outbox_.size() > in_flight_ &&
+         ctx_->global_queued->load(std::memory_order_relaxed) + incoming >
+             lim.global_bytes;
+}
+
+/**
+ * Decide whether @p incoming bytes may be queued, making room first
+ * according to the shard's SlowConsumerPolicy. Entries owned by the write
+ * in flight are never touched. A gap marker may push the queue a few dozen
+ * bytes over the cap; that is the only slack.
+ */
+bool Session::admit(std::size_t incoming) {
+  if (!over_limit(incoming))
+    return true;
+
+  auto &st = ctx_->stats;
+  switch (ctx_->limits.policy) {
+  case SlowConsumerPolicy::disconnect:
+    st.slow_disconnects.add();
+    LOG_WARN("session", "[Session for client ", client_name_, "] outbox full (",
+             queued_bytes_, " bytes), disconnecting");
+    while (outbox_.size() > in_flight_)
+      pop_queued(outbox_.size() - 1);
+    closing_ = DisconnectReason::slow_consumer;
+    stop(); // pending read fails → notify_disconnect()
+    return false;
+
+  case SlowConsumerPolicy::drop_oldest:
+    drop_backlog(incoming, false);
+    break;
+
+  case SlowConsumerPolicy::collapse:
+    st.collapses.add();
+    drop_backlog(incoming, true);
+    break;
+  }
+
+  bool fits = !over_limit(incoming);
+  if (!fits) { // larger than the cap on its own
+    ++gap_count_;
+    st.dropped.add();
+  }
+
+  std::string note = "[server] " + std::to_string(gap_count_) +
+                     (ctx_->limits.policy == SlowConsumerPolicy::collapse
+                          ? " messages collapsed"
+                          : " messages dropped") +
+                     " (connection too slow)";
+  gap_marker_ = make_message(note);
+  push_queued(gap_marker_, in_flight_);
+  st.gap_markers.add();
+  return fits;
+}
+
+/// Drop unsent entries oldest‑first (or all of them), folding any existing
+/// gap marker into the new count.
+void Session::drop_backlog(std::size_t incoming, bool all) {
+  for (std::size_t i = in_flight_; gap_marker_ && i < outbox_.size(); ++i)
+    if (outbox_[i] == gap_marker_) {
+      pop_queued(i);
+      gap_marker_.reset();
+    }
+  std::size_t dropped = 0;
+  while (outbox_.size() > in_flight_ && (all || over_limit(incoming))) {
+    pop_queued(in_flight_);
+    ++dropped;
+  }
+  gap_count_ += dropped;
+  ctx_->stats.dropped.add(dropped);
+}
+
+void Session::push_queued(Payload msg, std::size_t at) {
+  queued_bytes_ += msg->size();
+  if (ctx_->global_queued)
+    ctx_->global_queued->fetch_add(msg->size(), std::memory_order_relaxed);
+  outbox_.insert(at, std::move(msg));
+}
+
+void Session::pop_queued(std::size_t at) {
+  std::size_t n = outbox_[at]->size();
+  queued_bytes_ -= n;
+  if (ctx_->global_queued)
+    ctx_->global_queued->fetch_sub(n, std::memory_order_relaxed);
+  outbox_.erase(at);
 }
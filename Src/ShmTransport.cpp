@@ -0,0 +1,379 @@
+#include "../include/ShmTransport.hpp"
+#include "../include/Logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+[[noreturn]] void throw_errno(const std::string& what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void ring(int eventfd)
+{
+    std::uint64_t one = 1;
+    [[maybe_unused]] auto n = ::write(eventfd, &one, sizeof one);
+}
+
+void drain(int eventfd)
+{
+    std::uint64_t count;
+    [[maybe_unused]] auto n = ::read(eventfd, &count, sizeof count);
+}
+
+bool valid_capacity(std::uint64_t cap)
+{
+    return cap >= shm::kMinRing && cap <= shm::kMaxRing && !(cap & (cap - 1));
+}
+
+/// A memfd the publisher can't resize: shrinking one we have mapped would
+/// turn our next read of it into SIGBUS.
+constexpr int kRingSeals = F_SEAL_SHRINK | F_SEAL_GROW;
+
+bool is_eventfd(int fd)
+{
+    char link[64];
+    std::string path = "/proc/self/fd/" + std::to_string(fd);
+    ssize_t n = ::readlink(path.c_str(), link, sizeof link);
+    return n > 0 && std::string_view(link, static_cast<std::size_t>(n)) == "anon_inode:[eventfd]";
+}
+
+} // namespace
+
+//──────────────── server end ───────────────────
+/**
+ * The publisher sends one byte carrying SCM_RIGHTS [memfd, data eventfd,
+ * room eventfd]. Anything else – no fds, the wrong number, a memfd not
+ * sealed against resizing, doorbells that aren't eventfds, a ring too
+ * small for the capacity it claims – and the connection is dropped.
+ */
+void ShmTransport::handshake(local_stream::socket socket,
+                             std::function<void(std::unique_ptr<Transport>)> done)
+{
+    auto s = std::make_shared<local_stream::socket>(std::move(socket));
+    s->async_wait(net::socket_base::wait_read, [s, done = std::move(done)](auto ec) {
+        if (ec) {
+            done(nullptr);
+            return;
+        }
+        char byte = 0;
+        iovec iov{&byte, 1};
+        alignas(cmsghdr) char control[CMSG_SPACE(3 * sizeof(int))];
+        msghdr msg{};
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof control;
+        ssize_t got = ::recvmsg(s->native_handle(), &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+
+        int fds[3] = {-1, -1, -1};
+        std::size_t nfds = 0;
+        if (got >= 0)
+            for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c))
+                if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS) {
+                    nfds = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                    std::memcpy(fds, CMSG_DATA(c), std::min<std::size_t>(nfds, 3) * sizeof(int));
+                }
+        auto reject = [&](const char* why) {
+            LOG_WARN("shm", "publisher rejected: ", why);
+            for (int fd : fds)
+                if (fd >= 0) ::close(fd);
+            done(nullptr);
+        };
+        if (got != 1 || nfds != 3 || (msg.msg_flags & MSG_CTRUNC))
+            return reject("expected a memfd and two eventfds");
+
+        int seals = ::fcntl(fds[0], F_GET_SEALS);
+        if (seals < 0 || (seals & kRingSeals) != kRingSeals)
+            return reject("ring not sealed against resizing");
+        if (!is_eventfd(fds[1]) || !is_eventfd(fds[2]))
+            return reject("doorbells must be eventfds");
+
+        struct stat st{};
+        if (::fstat(fds[0], &st) || st.st_size < off_t(shm::kHeaderBytes + shm::kMinRing))
+            return reject("ring too small");
+        auto bytes = static_cast<std::size_t>(st.st_size);
+        void* map = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+        if (map == MAP_FAILED)
+            return reject("mmap failed");
+        const auto* hdr = static_cast<const shm::Header*>(map);
+        const std::uint64_t capacity = hdr->capacity;   // read once: the publisher may change it
+        if (hdr->magic != shm::kMagic || !valid_capacity(capacity)
+            || bytes < shm::kHeaderBytes + capacity) {
+            ::munmap(map, bytes);
+            return reject("bad ring header");
+        }
+        ::close(fds[0]);                     // the mapping keeps it
+        ::fcntl(fds[2], F_SETFL, ::fcntl(fds[2], F_GETFL) | O_NONBLOCK);
+        done(std::unique_ptr<Transport>(
+            new ShmTransport(std::move(*s), map, bytes, capacity, fds[1], fds[2])));
+    });
+}
+
+ShmTransport::ShmTransport(local_stream::socket socket, void* map, std::size_t map_bytes,
+                           std::uint64_t capacity, int data_fd, int room_fd)
+    : socket_(std::move(socket))
+    , data_(socket_.get_executor(), data_fd)
+    , room_fd_(room_fd)
+    , hdr_(static_cast<shm::Header*>(map))
+    , ring_(static_cast<const char*>(map) + shm::kHeaderBytes)
+    , capacity_(capacity)
+    , map_bytes_(map_bytes)
+    , tail_(hdr_->tail.load(std::memory_order_acquire))
+{
+    data_.non_blocking(true);
+}
+
+ShmTransport::~ShmTransport()
+{
+    close();
+    ::munmap(hdr_, map_bytes_);
+    ::close(room_fd_);
+}
+
+void ShmTransport::async_read(net::mutable_buffer buf, OwnerPtr owner)
+{
+    read_buf_ = buf;
+    reader_   = std::move(owner);
+    fill_read();
+}
+
+/**
+ * Copy out what the ring holds; with nothing there, say so in the header
+ * (the producer rings on its next write) and wait for the doorbell – and,
+ * at the same time, for the socket to report a hang‑up. Both waits hold
+ * the session, like any pending operation.
+ */
+void ShmTransport::fill_read()
+{
+    if (!reader_)
+        return;
+    if (closed_)
+        return complete_read(net::error::operation_aborted, 0);
+
+    std::uint64_t head = hdr_->head.load(std::memory_order_acquire);
+    if (head == tail_ && !peer_closed_) {
+        hdr_->consumer_waiting.store(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        head = hdr_->head.load(std::memory_order_acquire);
+    }
+    if (head - tail_ > capacity_) {
+        LOG_WARN("shm", "publisher ring corrupt (head ", head, ", tail ", tail_, ")");
+        return complete_read(boost::system::errc::make_error_code(boost::system::errc::protocol_error), 0);
+    }
+    if (head != tail_) {
+        hdr_->consumer_waiting.store(0, std::memory_order_relaxed);
+        std::size_t n     = static_cast<std::size_t>(std::min<std::uint64_t>(head - tail_, read_buf_.size()));
+        std::size_t at    = static_cast<std::size_t>(tail_ & (capacity_ - 1));
+        std::size_t first = std::min<std::size_t>(n, capacity_ - at);
+        auto* dst = static_cast<char*>(read_buf_.data());
+        std::memcpy(dst, ring_ + at, first);
+        std::memcpy(dst + first, ring_, n - first);
+        tail_ += n;
+        hdr_->tail.store(tail_, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (hdr_->producer_waiting.load())
+            ring(room_fd_);
+        return complete_read({}, n);
+    }
+    if (peer_closed_)
+        return complete_read(net::error::eof, 0);
+
+    if (!data_armed_) {
+        data_armed_ = true;
+        data_.async_wait(net::posix::descriptor_base::wait_read,
+            bind_memory(data_mem_, [this, owner = reader_](auto ec) {
+                data_armed_ = false;
+                if (ec)
+                    return;
+                drain(data_.native_handle());
+                fill_read();
+            }));
+    }
+    if (!hup_armed_) {
+        hup_armed_ = true;
+        socket_.async_wait(net::socket_base::wait_read,
+            bind_memory(hup_mem_, [this, owner = reader_](auto ec) {
+                hup_armed_ = false;
+                if (ec)
+                    return;
+                // the publisher never writes here: readable means gone
+                char c;
+                ssize_t n = ::recv(socket_.native_handle(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+                if (n >= 0 || (errno != EAGAIN && errno != EINTR)) {
+                    peer_closed_ = true;
+                    boost::system::error_code ignored;
+                    data_.cancel(ignored);
+                }
+                fill_read();
+            }));
+    }
+}
+
+void ShmTransport::complete_read(boost::system::error_code ec, std::size_t n)
+{
+    net::post(socket_.get_executor(),
+              bind_memory(read_mem_, [o = std::move(reader_), ec, n] { o->on_read(ec, n); }));
+}
+
+void ShmTransport::async_write(const net::const_buffer* bufs, std::size_t n, OwnerPtr owner)
+{
+    socket_.async_write_some(GatherView{bufs, bufs + n},
+        bind_memory(write_mem_, [owner = std::move(owner)](auto ec, std::size_t written) {
+            owner->on_write(ec, written);
+        }));
+}
+
+void ShmTransport::async_wait_writable(OwnerPtr owner)
+{
+    socket_.async_wait(net::socket_base::wait_write,
+        bind_memory(wait_mem_, [owner = std::move(owner)](auto ec) { owner->on_writable(ec); }));
+}
+
+void ShmTransport::close()
+{
+    if (closed_)
+        return;
+    closed_ = true;
+    boost::system::error_code ignored;
+    socket_.shutdown(net::socket_base::shutdown_both, ignored);
+    socket_.close(ignored);
+    data_.close(ignored);
+    fill_read();
+}
+
+//──────────────── publisher end ────────────────
+ShmPublisher::ShmPublisher(const std::string& path, std::size_t ring_bytes)
+{
+    if (!valid_capacity(ring_bytes))
+        throw std::invalid_argument("ring size must be a power of two from 4 KiB to 64 MiB");
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof addr.sun_path)
+        throw std::invalid_argument("socket path too long: " + path);
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    try {
+        if ((sock_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+            throw_errno("socket");
+        if (::connect(sock_, reinterpret_cast<const sockaddr*>(&addr), sizeof addr) < 0)
+            throw_errno("connect " + path);
+        if ((mem_ = ::memfd_create("chat-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING)) < 0)
+            throw_errno("memfd_create");
+        const std::size_t bytes = shm::kHeaderBytes + ring_bytes;
+        if (::ftruncate(mem_, static_cast<off_t>(bytes)) < 0)
+            throw_errno("ftruncate");
+        // the server maps it too: a size fixed for good is what makes that safe
+        if (::fcntl(mem_, F_ADD_SEALS, kRingSeals | F_SEAL_SEAL) < 0)
+            throw_errno("seal ring");
+        void* map = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, mem_, 0);
+        if (map == MAP_FAILED)
+            throw_errno("mmap");
+        hdr_ = new (map) shm::Header;
+        hdr_->magic    = shm::kMagic;
+        hdr_->capacity = capacity_ = ring_bytes;
+        hdr_->head.store(0);
+        hdr_->tail.store(0);
+        hdr_->consumer_waiting.store(0);
+        hdr_->producer_waiting.store(0);
+        ring_ = static_cast<char*>(map) + shm::kHeaderBytes;
+
+        if ((data_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0 ||
+            (room_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0)
+            throw_errno("eventfd");
+
+        char byte = 0;
+        iovec iov{&byte, 1};
+        alignas(cmsghdr) char control[CMSG_SPACE(3 * sizeof(int))] = {};
+        msghdr msg{};
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof control;
+        cmsghdr* c = CMSG_FIRSTHDR(&msg);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type  = SCM_RIGHTS;
+        c->cmsg_len   = CMSG_LEN(3 * sizeof(int));
+        const int fds[3] = {mem_, data_fd_, room_fd_};
+        std::memcpy(CMSG_DATA(c), fds, sizeof fds);
+        if (::sendmsg(sock_, &msg, MSG_NOSIGNAL) != 1)
+            throw_errno("sendmsg " + path);
+    }
+    catch (...) {
+        close();
+        throw;
+    }
+}
+
+ShmPublisher::~ShmPublisher()
+{
+    close();
+}
+
+/// The server hanging up is only noticed while waiting for room; until
+/// then bytes land in the ring and are lost with it.
+bool ShmPublisher::write(std::string_view bytes)
+{
+    while (!bytes.empty()) {
+        if (sock_ < 0)
+            return false;
+        std::uint64_t room = capacity_ - (head_ - hdr_->tail.load(std::memory_order_acquire));
+        if (!room) {
+            hdr_->producer_waiting.store(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (head_ - hdr_->tail.load(std::memory_order_acquire) == capacity_) {
+                pollfd fds[2] = {{room_fd_, POLLIN, 0}, {sock_, POLLRDHUP, 0}};
+                if (::poll(fds, 2, -1) < 0 && errno != EINTR)
+                    return false;
+                drain(room_fd_);
+                if (fds[1].revents & (POLLRDHUP | POLLHUP | POLLERR)) {
+                    hdr_->producer_waiting.store(0, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+            hdr_->producer_waiting.store(0, std::memory_order_relaxed);
+            continue;
+        }
+        std::size_t n     = static_cast<std::size_t>(std::min<std::uint64_t>(room, bytes.size()));
+        std::size_t at    = static_cast<std::size_t>(head_ & (capacity_ - 1));
+        std::size_t first = std::min<std::size_t>(n, capacity_ - at);
+        std::memcpy(ring_ + at, bytes.data(), first);
+        std::memcpy(ring_, bytes.data() + first, n - first);
+        head_ += n;
+        hdr_->head.store(head_, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (hdr_->consumer_waiting.load())
+            ring(data_fd_);
+        bytes.remove_prefix(n);
+    }
+    return true;
+}
+
+void ShmPublisher::close()
+{
+    if (sock_ >= 0) {
+        ::shutdown(sock_, SHUT_RDWR);
+        ::close(sock_);
+    }
+    if (hdr_)
+        ::munmap(hdr_, shm::kHeaderBytes + capacity_);
+    for (int fd : {mem_, data_fd_, room_fd_})
+        if (fd >= 0) ::close(fd);
+    sock_ = mem_ = data_fd_ = room_fd_ = -1;
+    hdr_  = nullptr;
+}
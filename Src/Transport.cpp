@@ -0,0 +1,92 @@
+#include "../include/Transport.hpp"
+#include "../include/Logger.hpp"
+#include <type_traits>
+#if defined(__linux__)
+#include <linux/sockios.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#endif
+
+template <class Protocol>
+void SocketTransport<Protocol>::async_read(net::mutable_buffer buf, OwnerPtr owner)
+{
+    socket_.async_read_some(buf,
+        bind_memory(read_mem_, [owner = std::move(owner)](auto ec, std::size_t n) {
+            owner->on_read(ec, n);
+        }));
+}
+
+template <class Protocol>
+void SocketTransport<Protocol>::async_write(const net::const_buffer* bufs, std::size_t n,
+                                           OwnerPtr owner)
+{
+    socket_.async_write_some(GatherView{bufs, bufs + n},
+        bind_memory(write_mem_, [owner = std::move(owner)](auto ec, std::size_t written) {
+            owner->on_write(ec, written);
+        }));
+}
+
+template <class Protocol>
+void SocketTransport<Protocol>::async_wait_writable(OwnerPtr owner)
+{
+    socket_.async_wait(net::socket_base::wait_write,
+        bind_memory(wait_mem_, [owner = std::move(owner)](auto ec) { owner->on_writable(ec); }));
+}
+
+/// TCP: the first call also sets TCP_NOTSENT_LOWAT to @p lowat, so a write
+/// wait wakes at that mark; where either is unavailable this is always
+/// true. AF_UNIX has no such mark – the peer's receive queue is the only
+/// one – so local clients aren't paced.
+template <class Protocol>
+bool SocketTransport<Protocol>::below_lowat(std::size_t lowat)
+{
+#if defined(__linux__) && defined(TCP_NOTSENT_LOWAT)
+    if constexpr (!std::is_same_v<Protocol, tcp>)
+        return true;
+    const int fd = socket_.native_handle();
+    if (!lowat_set_) {
+        int mark = static_cast<int>(lowat);
+        lowat_set_ = ::setsockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &mark, sizeof mark) ? -1 : 1;
+    }
+    int unsent = 0;
+    if (lowat_set_ < 0)
+        return true;
+    return ::ioctl(fd, SIOCOUTQNSD, &unsent) != 0 || static_cast<std::size_t>(unsent) < lowat;
+#else
+    (void)lowat;
+    return true;
+#endif
+}
+
+template <class Protocol>
+void SocketTransport<Protocol>::close()
+{
+    if (!socket_.is_open())
+        return;
+    boost::system::error_code ec;
+    if (auto rc = socket_.shutdown(net::socket_base::shutdown_both, ec);
+        rc && rc != net::error::not_connected)
+        LOG_WARN("session", "shutdown failed: ", rc.message());
+    if (auto rc = socket_.close(ec); rc && rc != net::error::not_connected)
+        LOG_WARN("session", "close failed: ", rc.message());
+}
+
+template <class Protocol>
+void SocketTransport<Protocol>::cancel()
+{
+    boost::system::error_code ignored;
+    socket_.cancel(ignored);
+}
+
+template <class Protocol>
+int SocketTransport<Protocol>::release()
+{
+    if (!socket_.is_open())
+        return -1;
+    boost::system::error_code ec;
+    int fd = socket_.release(ec);
+    return ec ? -1 : fd;
+}
+
+template class SocketTransport<tcp>;
+template class SocketTransport<local_stream>;
@@ -1,21 +1,36 @@
 #include "../include/client.hpp"
 #include "../include/ConsoleUtils.hpp"
+#include "../include/Transfer.hpp"
 #include <boost/asio.hpp>
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <utility>
 
 
 namespace net = boost::asio;
 using     tcp = net::ip::tcp;
 
+namespace {
+/// Lines a script may have submitted but not yet written before its reader
+/// waits; keeps a fast script from queueing the whole file in memory.
+constexpr std::size_t kMaxBacklog = 4096;
+}
+
 //──────────────── ctor / dtor ────────────────
 Client::Client(net::io_context& io,
                std::string      host,
-               unsigned short   port)
+               unsigned short   port,
+               ClientOptions    opts)
     : io_(io)
     , socket_(io)
     , resolver_(io)
+    , opts_(std::move(opts))
+    , proto_(opts_.proto)
+    , linger_timer_(io)
     , host_(std::move(host))
     , port_(port)
+    , retry_timer_(io)
 {}
 
 Client::~Client()
@@ -28,72 +43,276 @@ Client::~Client()
 //──────────────── public API ──────────────────
 void Client::start()
 {
+    auto connect = [self = shared_from_this()]
+    {
+        net::async_connect(
+            self->socket_, self->endpoints_,
+            [self](auto ec, const auto&)
+            {
+                if (ec) {
+                    std::cerr << "Connect failed: "
+                              << ec.message() << '\n';
+                    return;
+                }
+                self->send_name();
+            });
+    };
+    if (!opts_.unix_path.empty()) {
+        endpoints_.emplace_back(net::local::stream_protocol::endpoint(opts_.unix_path));
+        connect();
+        return;
+    }
     resolver_.async_resolve(
         host_, std::to_string(port_),
-        [self = shared_from_this()](auto ec, tcp::resolver::results_type eps)
+        [self = shared_from_this(), connect](auto ec, tcp::resolver::results_type eps)
         {
             if (ec) {
                 std::cerr << "Resolve failed: " << ec.message() << '\n';
                 return;
             }
-            net::async_connect(
-                self->socket_, eps,
-                [self](auto ec2, tcp::endpoint)
-                {
-                    if (ec2) {
-                        std::cerr << "Connect failed: "
-                                  << ec2.message() << '\n';
-                        return;
-                    }
-                    self->send_name();
-                });
+            for (const auto& e : eps)
+                self->endpoints_.emplace_back(e.endpoint());
+            connect();
         });
 }
 
 //──────────────── private helpers … ───────────
 void Client::send_name()
 {
-    std::cout << "Enter your name: ";
-    std::getline(std::cin, name_);
-    name_ += '\n';
+    name_ = opts_.name;
+    if (name_.empty()) {
+        std::cout << "Enter your name: ";
+        std::getline(std::cin, name_);
+    }
+    con::strip_trailing_newlines(name_);   // use helper from ConsoleUtils
+
+    auto hello = std::make_shared<std::string>();
+    if (proto_ == wire::Protocol::framed)
+        wire::append_message(wire::Protocol::text, *hello, wire::kFrameHello);
+    else if (proto_ == wire::Protocol::sequenced)
+        wire::append_message(wire::Protocol::text, *hello, wire::kSeqHello);
+    wire::append_message(proto_, *hello, name_);
 
     auto self = shared_from_this();
-    net::async_write(socket_, net::buffer(name_),
-        [self](auto ec, std::size_t)
+    net::async_write(socket_, net::buffer(*hello),
+        [self, hello](auto ec, std::size_t)
         {
             if (ec) {
                 std::cerr << "Send-name failed: " << ec.message() << '\n';
                 return;
             }
+            self->connected_ = true;
             self->read_loop();
-            self->launch_input_loop();
+            if (self->headless())
+                self->launch_script_loop();
+            else
+                self->launch_input_loop();
+            self->flush();
         });
+}
 
-    con::strip_trailing_newlines(name_);   // use helper from ConsoleUtils
+/// Runs on the io thread: the message joins whatever is pending and goes
+/// out with the next write.
+void Client::write(std::string_view text)
+{
+    if (first_send_ == std::chrono::steady_clock::time_point{})
+        first_send_ = std::chrono::steady_clock::now();
+    wire::append_message(proto_, pending_, text);
+    ++pending_msgs_;
+    ++stats_.sent_messages;
+    flush();
 }
 
-void Client::write(std::string text)
+/**
+ * One write at a time: the pending buffer becomes the in‑flight one (the
+ * two swap, so both keep their capacity) and the completion starts the
+ * next write with whatever queued up meanwhile. Nothing is sent while
+ * disconnected; it waits in pending_ for the resume.
+ */
+void Client::flush()
 {
-    auto self   = shared_from_this();
-    auto buffer = std::make_shared<std::string>(std::move(text));
+    if (writing_ || !connected_ || pending_.empty())
+        return;
+    in_flight_.swap(pending_);
+    pending_.clear();
+    in_flight_msgs_ = std::exchange(pending_msgs_, 0);
+    writing_ = true;
+    ++stats_.writes;
 
-    std::scoped_lock lk(write_mtx_);
-    net::async_write(socket_, net::buffer(*buffer),
-        [self, buffer](auto ec, std::size_t)
+    auto self = shared_from_this();
+    net::async_write(socket_, net::buffer(in_flight_),
+        bind_memory(write_mem_, [self](const boost::system::error_code& ec, std::size_t n)
         {
+            self->writing_ = false;
+            self->in_flight_.clear();
+            {
+                std::scoped_lock lk(self->queue_mtx_);
+                self->backlog_ -= std::min(self->backlog_, self->in_flight_msgs_);
+            }
+            self->queue_cv_.notify_one();
             if (ec) {
-                std::cerr << "Write failed: " << ec.message() << '\n';
-                self->running_ = false;
+                self->connected_ = false;
+                if (!self->resumable()) {       // else read_loop reconnects
+                    std::cerr << "Write failed: " << ec.message() << '\n';
+                    self->running_ = false;
+                }
+                return;
             }
-        });
+            self->stats_.sent_bytes += n;
+            self->last_write_ = std::chrono::steady_clock::now();
+            self->pump_transfer();
+            self->flush();
+            self->finish_script();
+        }));
+}
+
+/// Answer a server heartbeat; not counted as a sent message.
+void Client::pong()
+{
+    wire::append_message(proto_, pending_, wire::kPong);
+    flush();
+}
+
+void Client::submit(std::string line)
+{
+    {
+        std::scoped_lock lk(queue_mtx_);
+        ++backlog_;
+    }
+    net::post(io_, [self = shared_from_this(), msg = std::move(line)] {
+        if (msg.compare(0, 6, "/send ") == 0)
+            self->start_send(msg.substr(6));
+        else
+            self->write(msg);
+    });
+}
+
+//──────────────── file transfer ────────────────
+/// Announce the file with "/file ID SIZE NAME"; the chunks follow from
+/// pump_transfer(), after any transfer already under way.
+void Client::start_send(const std::string& path)
+{
+    Outgoing t;
+    t.file.open(path, std::ios::binary | std::ios::ate);
+    if (!t.file) {
+        print_line("[client] cannot open " + path);
+        {
+            std::scoped_lock lk(queue_mtx_);
+            backlog_ -= std::min<std::size_t>(backlog_, 1);   // nothing will be written
+        }
+        queue_cv_.notify_one();
+        return;
+    }
+    t.size = static_cast<std::uint64_t>(t.file.tellg());
+    t.file.seekg(0);
+    t.id   = next_transfer_++;
+    t.name = path.substr(path.find_last_of('/') + 1);
+    write(std::string(transfer::kFile) + std::to_string(t.id) + ' ' + std::to_string(t.size)
+          + ' ' + t.name);
+    sending_.push_back(std::move(t));
+}
+
+/**
+ * One chunk per idle write, and none while chat is pending: typed lines
+ * overtake the rest of the file. The last chunk is followed by "/sent ID".
+ */
+void Client::pump_transfer()
+{
+    if (sending_.empty() || !connected_ || writing_ || !pending_.empty())
+        return;
+    Outgoing& t = sending_.front();
+    char chunk[transfer::kChunkBytes];
+    t.file.read(chunk, sizeof chunk);
+    auto n = static_cast<std::size_t>(t.file.gcount());
+    if (n) {
+        std::string line = std::string(transfer::kChunk) + std::to_string(t.id) + ' '
+                         + std::to_string(t.offset) + ' ';
+        transfer::base64_append(line, std::string_view(chunk, n));
+        wire::append_message(proto_, pending_, line);
+        ++stats_.sent_messages;
+        t.offset += n;
+    }
+    if (!n || t.offset >= t.size) {
+        wire::append_message(proto_, pending_, std::string(transfer::kSent) + std::to_string(t.id));
+        ++stats_.sent_messages;
+        print_line("[client] sent " + t.name + " (" + std::to_string(t.offset) + " bytes)");
+        sending_.pop_front();
+    }
+}
+
+/// "[sender] /file …", "/chunk …" or "/sent …" from someone in the room.
+bool Client::on_transfer(std::string_view msg)
+{
+    std::size_t close = msg.find("] ");
+    if (msg.empty() || msg.front() != '[' || close == std::string_view::npos)
+        return false;
+    std::string_view sender = msg.substr(1, close - 1);
+    std::string_view line   = msg.substr(close + 2);
+    if (!transfer::is_transfer(line))
+        return false;
+
+    auto field = [&line]() {               // next space‑separated field
+        line.remove_prefix(std::min(line.size(), line.find(' ') + 1));
+        return line.substr(0, line.find(' '));
+    };
+    const bool file = line.substr(0, transfer::kFile.size()) == transfer::kFile;
+    const bool sent = line.substr(0, transfer::kSent.size()) == transfer::kSent;
+    std::string key = std::string(sender) + ' ' + std::string(field());
+
+    if (file) {
+        Incoming in;
+        in.size = std::strtoull(std::string(field()).c_str(), nullptr, 10);
+        line.remove_prefix(std::min(line.size(), line.find(' ') + 1));
+        std::string name(line.substr(line.find_last_of('/') + 1));   // never a path
+        in.name = name.empty() || name == "." || name == ".." ? "file" : name;
+        if (!opts_.downloads.empty())
+            in.out.open(opts_.downloads + '/' + in.name, std::ios::binary | std::ios::trunc);
+        print_line('[' + std::string(sender) + "] is sending " + in.name + " ("
+                   + std::to_string(in.size) + " bytes)");
+        receiving_[key] = std::move(in);
+        return true;
+    }
+    auto it = receiving_.find(key);
+    if (it == receiving_.end())
+        return true;                        // started before we joined
+    Incoming& in = it->second;
+    if (sent) {
+        bool whole = !in.broken && in.received == in.size;
+        std::string note = "[client] " + in.name + " from " + std::string(sender) + ": ";
+        if (!whole)
+            note += "incomplete (" + std::to_string(in.received) + " of "
+                  + std::to_string(in.size) + " bytes)";
+        else if (in.out.is_open())
+            note += "saved to " + opts_.downloads + '/' + in.name;
+        else
+            note += std::to_string(in.size) + " bytes, not saved (--downloads DIR)";
+        print_line(note);
+        receiving_.erase(it);
+        return true;
+    }
+    std::uint64_t offset = std::strtoull(std::string(field()).c_str(), nullptr, 10);
+    std::string   data;
+    if (offset != in.received || !transfer::base64_decode(data, field()))
+        in.broken = true;
+    if (in.broken)
+        return true;
+    if (in.out.is_open())
+        in.out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    in.received += data.size();
+    return true;
 }
 
 void Client::read_loop()
 {
+    constexpr std::size_t chunk = 16 * 1024;
     auto self = shared_from_this();
-    net::async_read_until(socket_, resp_buf_, '\n',
-        [self](const boost::system::error_code& ec, std::size_t)
+    socket_.async_read_some(net::buffer(resp_buf_.prepare(chunk), chunk),
+        bind_memory(self->read_mem_, [self](const boost::system::error_code& ec, std::size_t n)
         {
+            if (ec && self->resumable()) {
+                self->reconnect();
+                return;
+            }
             if (ec) {        
                              // Ignore normal shutdown errors
                 if (!(ec == net::error::eof ||
@@ -107,16 +326,120 @@ void Client::read_loop()
                 return;                                   
             }
 
-            std::istream is(&self->resp_buf_);
-            std::string line;
-            std::getline(is, line);
-            self->show_incoming(line);
+            self->resp_buf_.commit(n);
+
+            // show every complete message; the server never sends more
+            // than a history window at once, so no size cap is needed here
+            std::string_view msg;
+            std::size_t      used = 0;
+            if (self->proto_ != wire::Protocol::sequenced) {
+                while (wire::next_message(self->proto_, self->resp_buf_.data(),
+                                          SIZE_MAX, msg, used) == wire::Parse::message) {
+                    if (msg == wire::kPing)
+                        self->pong();
+                    else
+                        self->show_incoming(msg);
+                    self->resp_buf_.consume(used);
+                }
+                self->read_loop();
+                return;
+            }
+
+            std::uint64_t seq = 0;
+            while (wire::next_sequenced(self->resp_buf_.data(), SIZE_MAX, seq, msg, used)
+                   == wire::Parse::message) {
+                constexpr std::string_view kToken = "[server] resume token ";
+                if (!seq && msg.substr(0, kToken.size()) == kToken)
+                    self->token_ = msg.substr(kToken.size());
+                else if (!seq && msg.substr(0, 17) == "[server] now in #")
+                    self->last_seq_ = 0;             // a different room's numbering
+                if (seq && seq <= self->last_seq_) {  // already shown before a resume
+                    self->resp_buf_.consume(used);
+                    continue;
+                }
+                if (seq)
+                    self->last_seq_ = seq;
+                if (!seq && msg == wire::kPing)
+                    self->pong();
+                else
+                    self->show_incoming(msg);
+                self->resp_buf_.consume(used);
+            }
             self->read_loop();                             
-        });
+        }));
+}
+
+bool Client::resumable() const
+{
+    return proto_ == wire::Protocol::sequenced && !token_.empty() && running_;
+}
+
+/**
+ * Reconnect and send "/resume TOKEN SEQ" in place of the name; the server
+ * puts us back in our room and sends what we missed after SEQ. Retried
+ * once a second until it connects; a refused token ends the session.
+ */
+void Client::reconnect()
+{
+    boost::system::error_code ignored;
+    socket_.close(ignored);
+    connected_ = false;                            // queue, don't write, until resumed
+    resp_buf_.consume(resp_buf_.data().size());   // a partial frame is resent anyway
+
+    if (headless()) {
+        std::cerr << "[connection lost, resuming…]" << std::endl;
+    } else {
+        con::erase_current_line();
+        std::cout << "[connection lost, resuming…]" << std::endl;
+    }
+
+    auto self = shared_from_this();
+    retry_timer_.expires_after(std::chrono::seconds(1));
+    retry_timer_.async_wait([self](auto ec) {
+        if (ec || !self->running_)
+            return;
+        net::async_connect(self->socket_, self->endpoints_,
+            [self](auto ec2, const auto&) {
+                if (ec2) {
+                    self->reconnect();
+                    return;
+                }
+                auto hello = std::make_shared<std::string>();
+                wire::append_message(wire::Protocol::text, *hello, wire::kSeqHello);
+                wire::append_message(self->proto_, *hello,
+                    "/resume " + self->token_ + ' ' + std::to_string(self->last_seq_));
+                // a failed resume is answered and closed; don't loop on it
+                self->token_.clear();
+                net::async_write(self->socket_, net::buffer(*hello),
+                    [self, hello](auto ec3, std::size_t) {
+                        if (ec3) {
+                            std::cerr << "Resume failed: " << ec3.message() << '\n';
+                            self->running_ = false;
+                            return;
+                        }
+                        self->connected_ = true;
+                        self->read_loop();
+                        self->pump_transfer();
+                        self->flush();
+                    });
+            });
+    });
 }
 
 void Client::show_incoming(std::string_view msg)
 {
+    ++stats_.received;
+    if (!on_transfer(msg))
+        print_line(msg);
+}
+
+void Client::print_line(std::string_view msg)
+{
+    if (headless()) {
+        if (!opts_.quiet)
+            std::cout << msg << '\n';       // no prompt to redraw; flushed by the stream
+        return;
+    }
     con::erase_current_line();
     std::cout << msg << '\n'
               << '[' << name_ << "] " << std::flush;
@@ -136,19 +459,94 @@ void Client::launch_input_loop()
                 continue;
 
             con::erase_previous_line(); // erase local echo
-            line += '\n';
-            net::post(self->io_, [self, msg = std::move(line)]() mutable {
-                self->write(std::move(msg));
-            });
+            self->submit(std::move(line));
+        }
+    });
+}
+
+/**
+ * Headless input: one line of the script per message, empty lines
+ * skipped. Paced to opts_.rate if set; otherwise limited only by the
+ * backlog, i.e. by how fast the socket drains.
+ */
+void Client::launch_script_loop()
+{
+    input_thread_ = std::thread([self = shared_from_this()] {
+        std::ifstream file;
+        if (self->opts_.script != "-") {
+            file.open(self->opts_.script);
+            if (!file)
+                std::cerr << "Cannot open " << self->opts_.script << '\n';
         }
+        std::istream& in = self->opts_.script == "-" ? std::cin : file;
+
+        using clock = std::chrono::steady_clock;
+        const auto    start = clock::now();
+        std::uint64_t n     = 0;
+        std::string   line;
+        while (self->running_ && std::getline(in, line)) {
+            con::strip_trailing_newlines(line);
+            if (line.empty())
+                continue;
+            if (self->opts_.rate > 0)
+                std::this_thread::sleep_until(start + std::chrono::duration_cast<clock::duration>(
+                    std::chrono::duration<double>(double(n) / self->opts_.rate)));
+            {
+                std::unique_lock lk(self->queue_mtx_);
+                while (self->running_ && self->backlog_ >= kMaxBacklog)
+                    self->queue_cv_.wait_for(lk, std::chrono::milliseconds(100));
+            }
+            self->submit(std::move(line));
+            ++n;
+        }
+        net::post(self->io_, [self] {
+            self->script_eof_ = true;
+            self->finish_script();
+        });
     });
 }
 
+/// Once the script is read and written, keep reading for opts_.linger_ms
+/// and then half‑close: the server hangs up and io.run() returns.
+void Client::finish_script()
+{
+    if (!script_eof_ || writing_ || !pending_.empty() || !sending_.empty())
+        return;
+    script_eof_ = false;
+    if (first_send_ != std::chrono::steady_clock::time_point{})
+        stats_.send_seconds = std::chrono::duration<double>(last_write_ - first_send_).count();
+
+    linger_timer_.expires_after(std::chrono::milliseconds(opts_.linger_ms));
+    linger_timer_.async_wait([self = shared_from_this()](auto ec) {
+        if (ec)
+            return;
+        self->running_ = false;
+        boost::system::error_code ignored;
+        self->socket_.shutdown(tcp::socket::shutdown_send, ignored);
+    });
+}
+
+ClientStats Client::stats() const
+{
+    return stats_;
+}
+
+void Client::print_stats(std::ostream& out) const
+{
+    const double secs = stats_.send_seconds;
+    out << "sent " << stats_.sent_messages << " messages, " << stats_.sent_bytes
+        << " bytes in " << stats_.writes << " writes over " << secs << " s ("
+        << static_cast<std::uint64_t>(secs > 0 ? double(stats_.sent_messages) / secs : 0)
+        << " msg/s, " << (secs > 0 ? double(stats_.sent_bytes) / secs / 1e6 : 0)
+        << " MB/s); received "
+        << stats_.received << " messages\n";
+}
+
 void Client::send_quit() {
     if (!running_) return;
     running_ = false;
 
-    write("/quit\n");  // send command to server
+    write("/quit");  // send command to server
 
 
     boost::system::error_code ec;
@@ -1,6 +1,7 @@
 // src/main_client.cpp
 #include "../include/client.hpp"
 #include <boost/asio.hpp>
+#include <cstring>
 #include <iostream>
 #include <csignal>
 
@@ -10,30 +11,77 @@ namespace {
 
     void signal_handler(int) {
         if (cleanup_handler)
-            cleanup_handler(); 
+            cleanup_handler();
+    }
+
+    void usage()
+    {
+        std::cerr << "Usage: client (<host> <port> | --unix PATH) [--framed | --resume] [--name NAME]\n"
+                     "              [--script FILE|-] [--rate N] [--linger-ms N] [--quiet]\n"
+                     "              [--downloads DIR]\n"
+                     "  --unix     connect to the server's AF_UNIX socket PATH (server --unix)\n"
+                     "  --script   headless: send each line of FILE (- = stdin), then quit\n"
+                     "  --rate     headless: messages per second (default: as fast as possible)\n"
+                     "  --linger-ms keep reading this long after the last send (default 1000)\n"
+                     "  --quiet    headless: print only the send/receive summary\n"
+                     "  --downloads save files others /send to the room in DIR\n"
+                     "Type /send PATH to send a file to your room.\n";
     }
 }
 
 int main(int argc, char* argv[]) {
-      if (argc != 3) {
-        std::cerr << "Usage: client <host> <port>\n";
+    if (argc < 3) {
+        usage();
         return 1;
     }
+    ClientOptions opts;
+    const bool local = !std::strcmp(argv[1], "--unix");
+    if (local)
+        opts.unix_path = argv[2];
+    for (int i = 3; i < argc; ++i) {
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument(argv[i]);
+            return argv[++i];
+        };
+        try {
+            if      (!std::strcmp(argv[i], "--framed"))    opts.proto = wire::Protocol::framed;
+            else if (!std::strcmp(argv[i], "--resume"))    opts.proto = wire::Protocol::sequenced;
+            else if (!std::strcmp(argv[i], "--name"))      opts.name = value();
+            else if (!std::strcmp(argv[i], "--script"))    opts.script = value();
+            else if (!std::strcmp(argv[i], "--rate"))      opts.rate = std::stod(value());
+            else if (!std::strcmp(argv[i], "--linger-ms")) opts.linger_ms = static_cast<unsigned>(std::stoul(value()));
+            else if (!std::strcmp(argv[i], "--quiet"))     opts.quiet = true;
+            else if (!std::strcmp(argv[i], "--downloads")) opts.downloads = value();
+            else { usage(); return 1; }
+        }
+        catch (const std::exception&) {
+            usage();
+            return 1;
+        }
+    }
+    if (!opts.script.empty() && opts.name.empty())
+        opts.name = "bot";               // nobody to prompt
+    const bool headless = !opts.script.empty();
 
     net::io_context io;
 
     auto client = std::make_shared<Client>(
-        io, argv[1], static_cast<unsigned short>(std::stoi(argv[2])));
+        io, local ? std::string() : argv[1],
+        local ? 0 : static_cast<unsigned short>(std::stoi(argv[2])), std::move(opts));
+
 
-    
     cleanup_handler = [client] {
         std::cout << "\n[Client] Ctrl+C pressed. Sending /quit and exiting...\n";
-        client->send_quit();  
+        client->send_quit();
     };
 
     std::signal(SIGINT, signal_handler);  // Register Ctrl+C signal
 
     client->start();
     io.run();
-}
 
+    if (headless) {
+        std::cout << std::flush;
+        client->print_stats(std::cerr);
+    }
+}
@@ -1,14 +1,165 @@
+#include "../include/Handoff.hpp"
 #include "../include/Server.hpp"
+#include "../include/Logger.hpp"
 #include <boost/asio.hpp>
+#include <chrono>
+#include <csignal>
+#include <cstring>
 #include <iostream>
+#include <string>
 
-int main()
+namespace {
+    void usage()
+    {
+        std::cerr << "Usage: server [--port N] [--threads N] [--stats SECONDS] [--admin-port N]\n"
+                     "              [--unix PATH] [--shm PATH] [--upgrade-socket PATH] [--takeover PATH]\n"
+                     "              [--outbox-bytes N] [--outbox-global-bytes N] [--bulk-bytes N]\n"
+                     "              [--slow-policy disconnect|drop|collapse]\n"
+                     "              [--history N] [--history-bytes N] [--max-message N]\n"
+                     "              [--max-rooms N] [--resume-seconds N]\n"
+                     "              [--log-dir DIR] [--log-segment-bytes N] [--log-fsync-ms N]\n"
+                     "              [--node-id NAME] [--fed-port N] [--peer HOST:PORT]...\n"
+                     "              [--handshake-timeout S] [--heartbeat S] [--idle-timeout S]\n"
+                     "              [--rate-msgs N] [--rate-bytes N] [--ip-rate-msgs N] [--ip-rate-bytes N]\n"
+                     "              [--rate-burst S] [--rate-action throttle|drop|disconnect]\n"
+                     "              [--batch-us N] [--batch-bytes N]\n"
+                     "              [--presence immediate|batched|off] [--presence-ms N]\n"
+                     "              [--log-file PATH] [--log-level debug|info|warn|error]\n"
+                     "  --threads 0   one shard per CPU core\n"
+                     "  --stats N     print write/syscall counters every N seconds\n"
+                     "  --admin-port  serve Prometheus metrics on 127.0.0.1:N\n"
+                     "  --unix        also accept clients on the AF_UNIX socket PATH\n"
+                     "  --shm         accept shared-memory ring publishers on the AF_UNIX socket PATH\n"
+                     "  --upgrade-socket let a new server process take over through PATH\n"
+                     "  --takeover    take over the clients of the server listening on upgrade socket\n"
+                     "                PATH, then serve them (start with the same options)\n"
+                     "  --bulk-bytes  per-client queue for /send file chunks (default 8 MiB)\n"
+                     "  --history     messages kept per room and replayed on /join\n"
+                     "  --log-dir     persist history to DIR and rebuild it from there on start\n"
+                     "  --fed-port    accept links from other chat_server nodes on N\n"
+                     "  --peer        link to the node at HOST:PORT (repeatable)\n"
+                     "  --heartbeat   ping framed clients silent for S seconds (0 = never)\n"
+                     "  --idle-timeout disconnect framed clients silent for S seconds (0 = never)\n"
+                     "  --rate-msgs   per-client messages/s (--ip-*: per client address; 0 = no limit)\n"
+                     "  --rate-burst  seconds of rate a client may send at once (default 2)\n"
+                     "  --batch-us    send a room's chat in one write per client every N us (0 = off)\n"
+                     "  --batch-bytes … or as soon as a batch holds N bytes (default 16384)\n"
+                     "  --presence    batched: one coalesced join/leave line per room every\n"
+                     "                --presence-ms (default 250); off: none, clients use /who\n"
+                     "  --log-file    append diagnostics to PATH instead of stdout\n";
+    }
+
+    SlowConsumerPolicy parse_policy(const std::string& s)
+    {
+        if (s == "disconnect") return SlowConsumerPolicy::disconnect;
+        if (s == "drop")       return SlowConsumerPolicy::drop_oldest;
+        if (s == "collapse")   return SlowConsumerPolicy::collapse;
+        throw std::invalid_argument(s);
+    }
+
+    RateLimitAction parse_rate_action(const std::string& s)
+    {
+        if (s == "throttle")   return RateLimitAction::throttle;
+        if (s == "drop")       return RateLimitAction::drop;
+        if (s == "disconnect") return RateLimitAction::disconnect;
+        throw std::invalid_argument(s);
+    }
+
+    PresenceMode parse_presence(const std::string& s)
+    {
+        if (s == "immediate") return PresenceMode::immediate;
+        if (s == "batched")   return PresenceMode::batched;
+        if (s == "off")       return PresenceMode::off;
+        throw std::invalid_argument(s);
+    }
+
+    logging::Level parse_log_level(const std::string& s)
+    {
+        logging::Level l;
+        if (!logging::parse_level(s, l)) throw std::invalid_argument(s);
+        return l;
+    }
+}
+
+int main(int argc, char* argv[])
 {
+    ServerConfig    cfg;
+    logging::Config log_cfg;
+    std::string     takeover;
+    for (int i = 1; i < argc; ++i) {
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument(argv[i]);
+            return argv[++i];
+        };
+        try {
+            if      (!std::strcmp(argv[i], "--port"))    cfg.port    = static_cast<unsigned short>(std::stoi(value()));
+            else if (!std::strcmp(argv[i], "--threads")) cfg.threads = std::stoul(value());
+            else if (!std::strcmp(argv[i], "--stats"))   cfg.stats_interval = static_cast<unsigned>(std::stoul(value()));
+            else if (!std::strcmp(argv[i], "--admin-port"))          cfg.admin_port = static_cast<unsigned short>(std::stoi(value()));
+            else if (!std::strcmp(argv[i], "--unix"))                cfg.unix_path  = value();
+            else if (!std::strcmp(argv[i], "--shm"))                 cfg.shm_path   = value();
+            else if (!std::strcmp(argv[i], "--upgrade-socket"))      cfg.upgrade_path = value();
+            else if (!std::strcmp(argv[i], "--takeover"))            takeover = value();
+            else if (!std::strcmp(argv[i], "--outbox-bytes"))        cfg.outbox.session_bytes = std::stoull(value());
+            else if (!std::strcmp(argv[i], "--bulk-bytes"))          cfg.outbox.bulk_bytes    = std::stoull(value());
+            else if (!std::strcmp(argv[i], "--outbox-global-bytes")) cfg.outbox.global_bytes  = std::stoull(value());
+            else if (!std::strcmp(argv[i], "--slow-policy"))         cfg.outbox.policy = parse_policy(value());
+            else if (!std::strcmp(argv[i], "--history"))             cfg.history_messages = std::stoul(value());
+            else if (!std::strcmp(argv[i], "--history-bytes"))       cfg.history_bytes    = std::stoul(value());
+            else if (!std::strcmp(argv[i], "--max-message"))         cfg.max_message_bytes = std::stoul(value());
+            else if (!std::strcmp(argv[i], "--max-rooms"))           cfg.max_rooms = std::stoul(value());
+            else if (!std::strcmp(argv[i], "--resume-seconds"))      cfg.resume_seconds = static_cast<unsigned>(std::stoul(value()));
+            else if (!std::strcmp(argv[i], "--log-dir"))             cfg.log.dir = value();
+            else if (!std::strcmp(argv[i], "--log-segment-bytes"))   cfg.log.segment_bytes = std::stoull(value());
+            else if (!std::strcmp(argv[i], "--log-fsync-ms"))        cfg.log.fsync_ms = static_cast<unsigned>(std::stoul(value()));
+            else if (!std::strcmp(argv[i], "--node-id"))             cfg.federation.node_id = value();
+            else if (!std::strcmp(argv[i], "--fed-port"))            cfg.federation.port = static_cast<unsigned short>(std::stoi(value()));
+            else if (!std::strcmp(argv[i], "--peer"))                cfg.federation.peers.push_back(value());
+            else if (!std::strcmp(argv[i], "--handshake-timeout"))   cfg.timeouts.handshake_seconds = static_cast<unsigned>(std::stoul(value()));
+            else if (!std::strcmp(argv[i], "--heartbeat"))           cfg.timeouts.heartbeat_seconds = static_cast<unsigned>(std::stoul(value()));
+            else if (!std::strcmp(argv[i], "--idle-timeout"))        cfg.timeouts.idle_seconds      = static_cast<unsigned>(std::stoul(value()));
+            else if (!std::strcmp(argv[i], "--rate-msgs"))           cfg.rate_limits.session_messages = std::stod(value());
+            else if (!std::strcmp(argv[i], "--rate-bytes"))          cfg.rate_limits.session_bytes    = std::stod(value());
+            else if (!std::strcmp(argv[i], "--ip-rate-msgs"))        cfg.rate_limits.address_messages = std::stod(value());
+            else if (!std::strcmp(argv[i], "--ip-rate-bytes"))       cfg.rate_limits.address_bytes    = std::stod(value());
+            else if (!std::strcmp(argv[i], "--rate-burst"))          cfg.rate_limits.burst_seconds    = std::stod(value());
+            else if (!std::strcmp(argv[i], "--rate-action"))         cfg.rate_limits.action = parse_rate_action(value());
+            else if (!std::strcmp(argv[i], "--batch-us"))            cfg.batch.window_us = static_cast<unsigned>(std::stoul(value()));
+            else if (!std::strcmp(argv[i], "--batch-bytes"))         cfg.batch.max_bytes = std::stoul(value());
+            else if (!std::strcmp(argv[i], "--presence"))            cfg.presence.mode    = parse_presence(value());
+            else if (!std::strcmp(argv[i], "--presence-ms"))         cfg.presence.tick_ms = static_cast<unsigned>(std::stoul(value()));
+            else if (!std::strcmp(argv[i], "--log-file"))            log_cfg.path  = value();
+            else if (!std::strcmp(argv[i], "--log-level"))           log_cfg.level = parse_log_level(value());
+            else { usage(); return 1; }
+        }
+        catch (const std::exception&) {
+            usage();
+            return 1;
+        }
+    }
+
     try {
+        logging::Logger::instance().configure(log_cfg);   // before any io thread starts
+
+        // hot upgrade: everything the running server had, once it has exited
+        handoff::State inherited;
+        if (!takeover.empty()) {
+            auto t0 = std::chrono::steady_clock::now();
+            inherited = handoff::take_over(takeover);
+            LOG_INFO("server", "took over ", inherited.sessions.size(), " sessions in ",
+                     std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - t0).count(), " us");
+        }
+
         boost::asio::io_context io;
-        Server srv(io, 12345);
-        std::cout << "Server running on port 12345...\n";
-        io.run();
+        Server srv(io, cfg, std::move(inherited));
+
+        // orderly shutdown so the message log is flushed and synced
+        boost::asio::signal_set signals(io, SIGINT, SIGTERM);
+        signals.async_wait([&](auto ec, int) { if (!ec) srv.stop(); });
+
+        LOG_INFO("server", "Server running on port ", cfg.port, " (", Server::io_backend(), ")...");
+        srv.run();
     }
     catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << '\n';
@@ -1,93 +1,1332 @@
 #include "../include/Server.hpp"
 #include "../include/session.hpp"
+#include "../include/Logger.hpp"
+#include "../include/ShmTransport.hpp"
+#include "../include/Transfer.hpp"
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
-#include <iostream>
+#include <deque>
 #include <string>
+#include <tuple>
+#include <utility>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-Server::Server(net::io_context& io, short port)
-    : acceptor_(io, tcp::endpoint(tcp::v4(), port))
+Server::Server(net::io_context& io, const ServerConfig& cfg, handoff::State inherited)
+    : acceptor_(io)
+    , unix_acceptor_(io)
+    , shm_acceptor_(io)
+    , stats_timer_(io)
+    , stats_interval_(cfg.stats_interval)
+    , history_messages_(cfg.history_messages)
+    , history_bytes_(cfg.history_bytes)
+    , max_rooms_(std::max<std::size_t>(1, cfg.max_rooms))
+    , resume_window_(cfg.resume_seconds)
+    , sweep_timer_(io)
+    , upgrade_acceptor_(io)
+    , rate_limits_(cfg.rate_limits)
+    , max_message_(cfg.max_message_bytes)
+    , batch_window_(cfg.batch.window_us)
+    , batch_bytes_(std::max<std::size_t>(1, cfg.batch.max_bytes))
+    , presence_(cfg.presence)
+    , presence_timer_(io)
 {
-    do_accept();
+    std::size_t n = cfg.threads ? cfg.threads
+                                : std::max(1u, std::thread::hardware_concurrency());
+
+    shards_.push_back(std::make_unique<Shard>(0, n, io));
+    for (std::size_t i = 1; i < n; ++i) {
+        owned_io_.push_back(std::make_unique<net::io_context>(1));
+        shards_.push_back(std::make_unique<Shard>(i, n, *owned_io_.back()));
+    }
+    for (auto& s : shards_) {
+        s->session_ctx.limits        = cfg.outbox;
+        s->session_ctx.max_message   = cfg.max_message_bytes;
+        s->session_ctx.global_queued = &global_queued_;
+        s->session_ctx.rate_limits   = cfg.rate_limits;
+
+        const auto ticks = [](unsigned seconds) -> TimerWheel::Tick {
+            return std::chrono::seconds(seconds) / kTimerTick;
+        };
+        SessionTimeouts& t = s->session_ctx.timeouts;
+        t.handshake = ticks(cfg.timeouts.handshake_seconds);
+        t.heartbeat = ticks(cfg.timeouts.heartbeat_seconds);
+        t.idle      = ticks(cfg.timeouts.idle_seconds);
+        t.tick      = kTimerTick;
+        if (t.handshake || t.heartbeat || t.idle || cfg.rate_limits.per_session()
+            || cfg.rate_limits.per_address()) {
+            t.wheel = &s->timers;
+            s->tick_epoch = std::chrono::steady_clock::now();
+            schedule_timer_tick(*s);
+        }
+    }
+    lobby_ = find_room(kLobby, true);
+    if (!cfg.log.dir.empty()) {
+        log_ = std::make_unique<MessageLog>(cfg.log);
+        recover_history();
+    }
+    adopt(inherited);
+    if (cfg.federation.enabled()) {
+        std::string node = cfg.federation.node_id.empty()
+                         ? net::ip::host_name() + ":" + std::to_string(cfg.port)
+                         : cfg.federation.node_id;
+        federation_ = std::make_unique<Federation>(io, cfg.federation, std::move(node),
+            [this](std::string_view room, std::string_view text) { on_remote_message(room, text); },
+            [this] {
+                std::vector<std::pair<std::string, std::uint32_t>> counts;
+                std::scoped_lock lk(rooms_mtx_);
+                for (auto& [name, room] : rooms_)
+                    if (std::size_t n = room->member_count())
+                        counts.emplace_back(name, static_cast<std::uint32_t>(n));
+                return counts;
+            });
+        LOG_INFO("fed", "federating as ", federation_->node_id());
+    }
+    if (cfg.admin_port)
+        admin_ = std::make_unique<AdminEndpoint>(io, cfg.admin_port,
+                                                 [this] { return render_metrics(); });
+    // a predecessor's listening sockets are already bound, with whoever
+    // connected during the handoff waiting in their backlog
+    if (cfg.listen && inherited.tcp_listener >= 0)
+        acceptor_.assign(tcp::v4(), std::exchange(inherited.tcp_listener, -1));
+    else if (cfg.listen) {
+        tcp::endpoint at(tcp::v4(), cfg.port);
+        acceptor_.open(at.protocol());
+        acceptor_.set_option(tcp::acceptor::reuse_address(true));
+        acceptor_.bind(at);
+        acceptor_.listen();
+    }
+    if (cfg.listen)
+        do_accept();
+    for (auto [path, acceptor, shm, fd] :
+         {std::tuple(&cfg.unix_path, &unix_acceptor_, false, &inherited.unix_listener),
+          std::tuple(&cfg.shm_path,  &shm_acceptor_,  true,  &inherited.shm_listener)}) {
+        if (path->empty())
+            continue;
+        if (*fd >= 0)
+            acceptor->assign(local_stream(), std::exchange(*fd, -1));
+        else {
+            ::unlink(path->c_str());        // a stale file from an earlier run
+            local_stream::endpoint at(*path);
+            acceptor->open(at.protocol());
+            acceptor->bind(at);
+            acceptor->listen();
+        }
+        socket_files_.push_back(*path);
+        LOG_INFO("server", shm ? "shared-memory publishers" : "local clients", " on ", *path);
+        do_accept_local(*acceptor, shm);
+    }
+    inherited.close_all();                  // listeners this configuration doesn't use
+    if (!cfg.upgrade_path.empty()) {
+        ::unlink(cfg.upgrade_path.c_str());
+        local_stream::endpoint at(cfg.upgrade_path);
+        upgrade_acceptor_.open(at.protocol());
+        upgrade_acceptor_.bind(at);
+        ::chmod(cfg.upgrade_path.c_str(), 0600);   // whoever connects gets every client
+        upgrade_acceptor_.listen();
+        socket_files_.push_back(cfg.upgrade_path);
+        do_accept_upgrade();
+    }
+    schedule_stats();
+    schedule_ticket_sweep();
+    schedule_presence();
+}
+
+Server::~Server()
+{
+    stop();
+    for (auto& s : shards_)
+        if (s->thread.joinable())
+            s->thread.join();
+
+    // A session outlives its slot while an operation of its holds it, and
+    // its last reference must not go after the shard it points into. Run
+    // what is ready (sessions still being added), close every session,
+    // detached so nothing reaches the Server any more, and run the failed
+    // completions; the shards then drop the last references.
+    for (auto& s : shards_) {
+        s->io.restart();
+        s->io.poll();
+        s->clients.for_each([](SessionId, ClientSessionInfo& c) {
+            if (c.session) {
+                c.session->detach();
+                c.session->stop();
+            }
+        });
+        s->io.restart();
+        s->io.poll();
+    }
+    for (auto& path : socket_files_)
+        ::unlink(path.c_str());
+}
+
+void Server::run()
+{
+    for (std::size_t i = 1; i < shards_.size(); ++i) {
+        Shard& s = *shards_[i];
+        s.thread = std::thread([&s] { s.io.run(); });
+    }
+    shards_[0]->io.run();
+
+    for (auto& s : shards_)
+        if (s->thread.joinable())
+            s->thread.join();
+}
+
+void Server::stop()
+{
+    for (auto& s : shards_) {
+        s->work.reset();
+        s->io.stop();
+    }
+}
+
+const char* Server::io_backend()
+{
+#if defined(BOOST_ASIO_HAS_IO_URING_AS_DEFAULT)
+    return "io_uring";
+#elif defined(BOOST_ASIO_HAS_EPOLL)
+    return "epoll";
+#else
+    return "other";
+#endif
 }
 
 //──────────────── private helpers ──────────────
-int Server::generate_client_id()
+namespace {
+    std::uint64_t elapsed_ns(std::chrono::steady_clock::time_point since)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - since).count();
+    }
+
+    /// @p s with CR and LF turned into spaces (copied to @p storage only if
+    /// it has any). Every record's text form is one line: a line break from
+    /// a framed client would otherwise start a line of its own – a fake
+    /// "[alice] …" or "[server] …" – on every text client's screen.
+    std::string_view one_line(std::string_view s, std::string& storage)
+    {
+        if (s.find_first_of("\r\n") == std::string_view::npos)
+            return s;
+        storage.assign(s);
+        std::replace_if(storage.begin(), storage.end(),
+                        [](char c) { return c == '\r' || c == '\n'; }, ' ');
+        return storage;
+    }
+}
+
+void Server::on_client_identified(Shard& shard, SessionId id, const std::string& name)
 {
-    int id = std::rand() % 1000;
-    while (clients_.find(id) != clients_.end())
-        id = std::rand() % 1000;
-    return id;
+    ClientSessionInfo* client = shard.clients.find(id);
+    if (!client)
+        return;
+    if (std::string_view(name).substr(0, 8) == "/resume ") {
+        resume(shard, id, *client, std::string_view(name).substr(8));
+        return;
+    }
+    std::string folded;
+    client->name = one_line(name, folded);
+    LOG_INFO("server", "Client ", id, " is named ", client->name);
+    if (client->session->protocol() == wire::Protocol::sequenced && resume_window_.count())
+        issue_ticket(shard, id, *client);
+    enter_room(shard, id, *client, *lobby_, "Conected");
 }
 
-void Server::on_client_identified(int id, const std::string& name)
+void Server::on_client_message(Shard& shard, SessionId id, std::string_view text)
 {
-    if (auto it = clients_.find(id); it != clients_.end()) {
-        it->second->name = name;
-        std::cout << "Client " << id << " is named " << name << '\n';
-        std::string payload = "[" + clients_[id]->name + "] " + "Conected" + '\n';
-        broadcastNoEcho(id,payload);
-        if (!recent_messages_.empty()) {
-            std::string backlog;
-            for (auto& m : recent_messages_) backlog += m;
-            it->second->session->deliver(backlog);
+    ClientSessionInfo* found = shard.clients.find(id);
+    if (!found || !found->room)
+        return;
+    ClientSessionInfo& client = *found;
+    std::string_view sender = client.name.empty() ? "Unknown" : client.name;
+    std::string folded;
+    text = one_line(text, folded);
+    if (transfer::is_transfer(text)) {
+        shard.transfer_lines.add();
+        relay_bulk(shard, *client.room, id,
+                   make_message("[" + std::string(sender) + "] " + std::string(text)));
+        return;
+    }
+    if (!text.empty() && text.front() == '/' && on_command(shard, id, client, text))
+        return;
+
+    // encode the record in place: "[sender] text"; with batching on it goes
+    // to the end of the room's pending batch instead of a buffer of its own
+    std::string  single;
+    std::string& rec   = batch_window_.count() ? shard.batches[client.room] : single;
+    std::size_t  start = rec.size();
+    rec.reserve(start + sender.size() + text.size() + 3 + kRecordOverhead);
+    rec.resize(start + kRecordHeader);            // seq is stamped by fan_out
+    rec += '[';
+    rec += sender;
+    rec += "] ";
+    rec += text;
+    wire::put_u32(rec.data() + start + wire::kSeqSize,
+                  static_cast<std::uint32_t>(rec.size() - start - kRecordHeader));
+    rec += '\n';
+
+    if (!batch_window_.count())
+        broadcast(shard, *client.room, make_payload(std::move(rec)));
+    else if (rec.size() >= batch_bytes_)
+        flush_batch(shard, *client.room);
+    else if (!shard.batch_armed) {
+        shard.batch_armed = true;
+        shard.batch_timer.expires_after(batch_window_);
+        shard.batch_timer.async_wait(bind_memory(shard.batch_mem,
+            [this, &shard](const boost::system::error_code& ec) {
+                if (!ec)
+                    flush_batches(shard);
+            }));
+    }
+}
+
+/**
+ * Room commands. Returns false for anything that isn't one, which is then
+ * sent to the room as an ordinary message.
+ */
+bool Server::on_command(Shard& shard, SessionId id, ClientSessionInfo& client, std::string_view text)
+{
+    std::string_view cmd = text.substr(0, text.find(' '));
+    std::string_view arg = cmd.size() < text.size() ? text.substr(cmd.size() + 1) : std::string_view{};
+
+    if (cmd == "/join") {
+        if (arg.empty() || arg.size() > 32 || arg.find(' ') != std::string_view::npos) {
+            client.session->deliver("[server] usage: /join NAME (1-32 characters, no spaces)");
+            return true;
         }
+        Room* room = find_room(arg, true);
+        if (!room)
+            client.session->deliver("[server] too many rooms, cannot create #" + std::string(arg));
+        else if (room == client.room)
+            client.session->deliver("[server] already in #" + room->name);
+        else {
+            leave_room(shard, id, client, "left #" + client.room->name);
+            enter_room(shard, id, client, *room, "joined #" + room->name);
+        }
+        return true;
+    }
+    if (cmd == "/leave") {
+        if (client.room == lobby_)
+            client.session->deliver("[server] already in #" + lobby_->name);
+        else {
+            leave_room(shard, id, client, "left #" + client.room->name);
+            enter_room(shard, id, client, *lobby_, "joined #" + lobby_->name);
+        }
+        return true;
+    }
+    if (cmd == "/rooms") {
+        client.session->deliver(list_rooms());
+        return true;
     }
+    if (cmd == "/who") {
+        std::vector<std::string> names = client.room->roster.names();
+        std::string line = "[server] #" + client.room->name + " (" + std::to_string(names.size()) + "):";
+        for (std::size_t i = 0; i < names.size(); ++i)
+            line += (i ? ", " : " ") + names[i];
+        client.session->deliver(line);
+        return true;
+    }
+    return false;
+}
+
+void Server::broadcast(Shard& origin, Room& room, Payload payload){
+    fan_out(origin, room, SlotTable<ClientSessionInfo>::kNone, payload);
 }
 
-void Server::on_client_message(int id, const std::string& text)
+void Server::broadcastNoEcho(Shard& origin, Room& room, SessionId id, Payload payload){
+    fan_out(origin, room, id, payload);         // ← skip echo
+}
+
+/**
+ * Every recipient (and the room history) shares the same immutable buffer;
+ * per-recipient cost is a refcount bump, independent of message size.
+ * Only the room's members are visited, and only shards that have any.
+ *
+ * @p payload must be fresh records that nobody else holds yet – one, or a
+ * whole batch: they are stamped with the room's next sequence numbers here.
+ * Unless they came from another node (@p federate false) they are also
+ * published to the federation, in the same order. A batch still pending
+ * for the room on @p origin goes first, so nothing overtakes it.
+ */
+void Server::fan_out(Shard& origin, Room& room, SessionId skip_id, const Payload& payload,
+                     bool federate)
 {
-    std::string sender = "Unknown";
-    if (auto it = clients_.find(id); it != clients_.end() && !it->second->name.empty())
-        sender = it->second->name;
+    if (!origin.batches.empty())
+        flush_batch(origin, room);
+    {
+        std::scoped_lock lk(room.order_mtx);
+        room.last_seq += stamp_seqs(payload, room.last_seq + 1);
+        for (std::size_t at = 0; at < payload->size(); ) {
+            std::string_view record(payload->data() + at, record_size(payload->data() + at));
+            room.history.append(record);
+            if (log_)
+                log_->append(room.name, record);
+            if (federation_ && federate)
+                federation_->publish(room.name, record.substr(kRecordHeader,
+                                                              record.size() - kRecordOverhead));
+            at += record.size();
+        }
+        // the skipped id lives on origin, so other shards deliver to every member
+        for (auto& s : shards_)
+            if (s.get() != &origin && room.members_on[s->index].load(std::memory_order_relaxed))
+                enqueue(*s, room, payload);
+
+        // Still under the lock: whatever other shards queued for us so far
+        // has a lower seq and goes first, and nothing numbered after ours
+        // can reach our inbox before we have delivered locally – so local
+        // members see sequence order too.
+        drain_inbox(origin);
 
-    std::string payload = "[" + sender + "] " + text + '\n';
-    broadcast(payload);
+        auto t0 = std::chrono::steady_clock::now();
+        if (auto m = origin.members.find(&room); m != origin.members.end()) {
+            for (auto& member : m->second) {
+                if (member.id == skip_id)
+                    continue;
+                member.session->deliver(payload);
+            }
+        }
+        origin.fanout_ns.observe(elapsed_ns(t0));
+    }
 }
 
-void Server::broadcast(const std::string& payload){
-  recent_messages_.push_back(payload);
-    for (auto& [_, info] : clients_)
-        info->session->deliver(payload);
+/**
+ * File transfer lines (Transfer.hpp): to every member but the sender, at
+ * bulk priority, unnumbered and unrecorded – history, the log and
+ * federation carry chat, not files. One sender's lines stay in order: they
+ * all leave from its shard, and inboxes and bulk queues are FIFO.
+ */
+void Server::relay_bulk(Shard& origin, Room& room, SessionId skip_id, const Payload& payload)
+{
+    for (auto& s : shards_)
+        if (s.get() != &origin && room.members_on[s->index].load(std::memory_order_relaxed))
+            enqueue(*s, room, payload, Priority::bulk);
+    if (auto m = origin.members.find(&room); m != origin.members.end())
+        for (auto& member : m->second)
+            if (member.id != skip_id)
+                member.session->deliver(payload, Priority::bulk);
+}
+
+/// Broadcast what @p shard has batched for @p room, if anything.
+void Server::flush_batch(Shard& shard, Room& room)
+{
+    auto it = shard.batches.find(&room);
+    if (it == shard.batches.end())
+        return;
+    Payload batch = make_payload(std::move(it->second));
+    shard.batches.erase(it);
+    fan_out(shard, room, SlotTable<ClientSessionInfo>::kNone, batch);
 }
 
-void Server::broadcastNoEcho(int id, const std::string& payload){
-    recent_messages_.push_back(payload);
-    for (auto& [client_id, entry] : clients_) { 
-        if (client_id == id)                     // ← skip echo
+/// The batch window closed: broadcast every room's pending batch.
+void Server::flush_batches(Shard& shard)
+{
+    shard.batch_armed = false;
+    while (!shard.batches.empty())
+        flush_batch(shard, *shard.batches.begin()->first);
+}
+
+/// A message another node broadcast to @p room; runs on shard 0.
+void Server::on_remote_message(std::string_view room, std::string_view text)
+{
+    std::string folded;
+    if (Room* r = find_room(room, true))
+        fan_out(*shards_[0], *r, SlotTable<ClientSessionInfo>::kNone,
+                make_message(one_line(text, folded)), false);
+}
+
+/**
+ * Append to the target shard's inbox. Only the first message into an empty
+ * inbox posts a drain, so a burst of broadcasts costs one handler per shard.
+ * Messages from one sender are appended in order and drained FIFO, which
+ * keeps per-sender ordering intact across shards.
+ */
+void Server::enqueue(Shard& target, Room& room, const Payload& payload, Priority prio)
+{
+    bool post_drain = false;
+    {
+        std::scoped_lock lk(target.inbox_mtx);
+        target.inbox.push_back({&room, payload, prio});
+        if (!target.drain_posted)
+            post_drain = target.drain_posted = true;
+    }
+    if (post_drain)
+        net::post(target.io, bind_memory(target.drain_mem, [this, &target] { drain_inbox(target); }));
+}
+
+void Server::drain_inbox(Shard& shard)
+{
+    std::vector<Shard::Delivery>& batch = shard.draining;
+    {
+        std::scoped_lock lk(shard.inbox_mtx);
+        batch.swap(shard.inbox);
+        shard.drain_posted = false;
+    }
+    // membership is checked here, not at enqueue time, so someone who left
+    // the room while this was in flight doesn't get it
+    for (auto& d : batch) {
+        auto m = shard.members.find(d.room);
+        if (m == shard.members.end())
             continue;
-        entry->session->deliver(payload);   // broadcast
+        auto t0 = std::chrono::steady_clock::now();
+        for (auto& member : m->second)
+            member.session->deliver(d.payload, d.prio);
+        shard.fanout_ns.observe(elapsed_ns(t0));
+    }
+    batch.clear();
+}
+
+//──────────────── rooms ────────────────────────
+/// Look up a room by name, creating it (up to max_rooms) if asked to.
+Server::Room* Server::find_room(std::string_view name, bool create)
+{
+    std::scoped_lock lk(rooms_mtx_);
+    if (auto it = rooms_.find(std::string(name)); it != rooms_.end())
+        return it->second.get();
+    if (!create || rooms_.size() >= max_rooms_)
+        return nullptr;
+    auto room = std::make_unique<Room>(std::string(name), shards_.size(),
+                                       history_messages_, history_bytes_,
+                                       presence_.mode == PresenceMode::batched);
+    Room* r = room.get();
+    rooms_.emplace(r->name, std::move(room));
+    return r;
+}
+
+/**
+ * Rebuild every room's history from the log. Records are copied straight
+ * from the mapped segments into the histories' flat buffers, so a large
+ * log costs one sequential read and no per‑message allocation.
+ */
+void Server::recover_history()
+{
+    auto t0 = std::chrono::steady_clock::now();
+    std::unordered_map<std::string_view, Room*> seen;   // keys view Room::name
+    std::deque<std::string>                     refused; // … or these, past max_rooms
+    std::uint64_t n = log_->replay([&](std::uint64_t, std::string_view name, std::string_view rec) {
+        auto it = seen.find(name);
+        if (it == seen.end()) {
+            Room* room = find_room(name, true);
+            std::string_view key = room ? std::string_view(room->name)
+                                        : std::string_view(refused.emplace_back(name));
+            it = seen.emplace(key, room).first;
+        }
+        if (it->second) {
+            it->second->history.append(rec);
+            it->second->last_seq = record_seq(rec.data());
+        }
+    });
+    LOG_INFO("server", "Recovered ", n, " messages (up to #", log_->last_seq(),
+             ") in ", elapsed_ns(t0) / 1'000'000, " ms");
+}
+
+void Server::enter_room(Shard& shard, SessionId id, ClientSessionInfo& client, Room& room,
+                        std::string_view note)
+{
+    announce(shard, room, id, client.name, note, true);
+
+    // With the room's order held, every broadcast is either already in the
+    // history – and whatever other shards queued here for it is delivered
+    // now, before we count as a member – or numbered after we do, and so
+    // reaches us through the inbox. Nothing is missed, nothing comes twice.
+    Payload backlog;
+    {
+        std::scoped_lock lk(room.order_mtx);
+        drain_inbox(shard);
+        add_member(shard, id, client, room);
+        backlog = room.history.snapshot();
+    }
+    // sequenced clients restart their seq tracking here
+    client.session->deliver("[server] now in #" + room.name);
+    if (backlog)
+        client.session->deliver(std::move(backlog));
+}
+
+void Server::leave_room(Shard& shard, SessionId id, ClientSessionInfo& client, std::string_view note)
+{
+    Room* room = client.room;
+    if (!room)
+        return;
+    remove_member(shard, client);
+    announce(shard, *room, id, client.name, note, false);
+}
+
+/// Membership only, no announcement.
+void Server::add_member(Shard& shard, SessionId id, ClientSessionInfo& client, Room& room)
+{
+    auto& list = shard.members[&room];
+    client.room       = &room;
+    client.member_pos = static_cast<std::uint32_t>(list.size());
+    list.push_back({id, client.session.get()});
+    room.members_on[shard.index].fetch_add(1, std::memory_order_relaxed);
+
+    if (!client.token.empty()) {                 // resume into this room
+        std::scoped_lock lk(tickets_mtx_);
+        if (auto t = tickets_.find(client.token); t != tickets_.end())
+            t->second.room = &room;
+    }
+}
+
+void Server::remove_member(Shard& shard, ClientSessionInfo& client)
+{
+    Room* room = client.room;
+    if (!room)
+        return;
+    if (auto m = shard.members.find(room); m != shard.members.end()) {
+        auto& list = m->second;
+        // swap‑remove: the last member takes our place and learns its new index
+        if (client.member_pos + 1 != list.size()) {
+            list[client.member_pos] = list.back();
+            shard.clients.find(list.back().id)->member_pos = client.member_pos;
+        }
+        list.pop_back();
+        if (list.empty())
+            shard.members.erase(m);
+    }
+    room->members_on[shard.index].fetch_sub(1, std::memory_order_relaxed);
+    client.room = nullptr;
+}
+
+/// "[server] rooms: #a (3), #b (1)" – rooms with members, by name,
+/// counting members on federated nodes too.
+std::string Server::list_rooms()
+{
+    std::unordered_map<std::string, std::uint32_t> remote;
+    if (federation_)
+        remote = federation_->remote_members();
+
+    std::vector<std::pair<std::string, std::size_t>> rows;
+    {
+        std::scoped_lock lk(rooms_mtx_);
+        for (auto& [name, room] : rooms_) {
+            std::size_t n = room->member_count();
+            if (auto r = remote.find(name); r != remote.end()) {
+                n += r->second;
+                remote.erase(r);
+            }
+            if (n)
+                rows.emplace_back(name, n);
+        }
+    }
+    for (auto& [name, n] : remote)                // rooms this node hasn't seen yet
+        rows.emplace_back(name, n);
+    std::sort(rows.begin(), rows.end());
+
+    std::string out = "[server] rooms:";
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        out += i ? ", #" : " #";
+        out += rows[i].first;
+        out += " (" + std::to_string(rows[i].second) + ")";
+    }
+    return out;
+}
+
+//──────────────── presence ─────────────────────
+/**
+ * Record a join or leave in @p room's roster and tell the room as the
+ * presence mode says: a line to everyone but @p skip_id now, a place in
+ * the next coalesced update, or nothing.
+ */
+void Server::announce(Shard& shard, Room& room, SessionId skip_id, const std::string& name,
+                      std::string_view note, bool joined)
+{
+    shard.presence_events.add();
+    bool first = joined ? room.roster.joined(name) : room.roster.left(name);
+    switch (presence_.mode) {
+    case PresenceMode::immediate:
+        broadcastNoEcho(shard, room, skip_id, make_message("[" + name + "] " + std::string(note)));
+        break;
+    case PresenceMode::batched:
+        if (first) {
+            std::scoped_lock lk(presence_mtx_);
+            presence_dirty_.push_back(&room);
+        }
+        break;
+    case PresenceMode::off:
+        break;
+    }
+}
+
+void Server::schedule_presence()
+{
+    if (presence_.mode != PresenceMode::batched)
+        return;
+    presence_timer_.expires_after(std::chrono::milliseconds(std::max(1u, presence_.tick_ms)));
+    presence_timer_.async_wait([this](auto ec) {
+        if (ec)
+            return;
+        send_presence();
+        schedule_presence();
+    });
+}
+
+/// One line per room whose roster changed since the last tick; runs on shard 0.
+void Server::send_presence()
+{
+    std::vector<Room*> dirty;
+    {
+        std::scoped_lock lk(presence_mtx_);
+        dirty.swap(presence_dirty_);
+    }
+    Shard& origin = *shards_[0];
+    for (Room* room : dirty) {
+        std::string line = room->roster.take_update(room->name, presence_.max_names);
+        if (line.empty())
+            continue;                               // everything cancelled out
+        broadcast(origin, *room, make_message(line));
+        origin.presence_updates.add();
     }
-        
 }
 
-void Server::on_client_disconnect(int id){
-    if (auto it = clients_.find(id); it != clients_.end()){
-      
-      std::string payload = "[" + clients_[id]->name + "] " + "Dissconected" + '\n';
-      std::cout << payload;
-      broadcastNoEcho(id,payload);
-      clients_.erase(it); 
+void Server::on_client_disconnect(Shard& shard, SessionId id, DisconnectReason why){
+    if (ClientSessionInfo* client = shard.clients.find(id)){
+
+      // a resumable client that dropped (rather than quit) leaves silently;
+      // sweep_tickets announces it if it doesn't come back in time
+      bool silent = false;
+      if (!client->token.empty()) {
+          std::scoped_lock lk(tickets_mtx_);
+          auto t = tickets_.find(client->token);
+          if (t == tickets_.end() || t->second.id != id)
+              silent = true;                     // already resumed elsewhere
+          else if (why != DisconnectReason::quit) {
+              t->second.id      = 0;
+              t->second.expires = Clock::now() + resume_window_;
+              detached_.emplace_back(t->second.expires, t->first);
+              silent = true;
+          }
+          else
+              tickets_.erase(t);
+      }
+
+      if (silent) {
+          LOG_INFO("server", "[", client->name, "] detached");
+          remove_member(shard, *client);
+      } else {
+          LOG_INFO("server", "[", client->name, "] Dissconected");
+          leave_room(shard, id, *client, "Dissconected");
+      }
+      shard.clients.erase(id);
+      shard.sessions.sub(1);
     }
 }
 
+/**
+ * Accept on shard 0 and hand each socket to the next shard round-robin.
+ * The socket is created on the target shard's io_context, so after the
+ * post every operation on it runs on that shard's thread.
+ */
 void Server::do_accept()
 {
-    acceptor_.async_accept(
-        [this](auto ec, tcp::socket socket) {
+    Shard& target = *shards_[next_shard_];
+    next_shard_ = (next_shard_ + 1) % shards_.size();
+
+    acceptor_.async_accept(target.io,
+        [this, &target](auto ec, tcp::socket socket) {
             if (!ec) {
-                int cid = generate_client_id();
+                boost::system::error_code ignored;
+                auto peer = socket.remote_endpoint(ignored).address();
+                net::post(target.io, [this, &target, peer, s = std::move(socket)]() mutable {
+                    add_session(target, std::make_unique<TcpTransport>(std::move(s)), peer);
+                });
+            }
+            if (!handing_off_)              // else the successor accepts from here on
+                do_accept();
+        });
+}
 
-                auto session = std::make_shared<Session>(
-                    std::move(socket), cid,
-                    [this](int i,const std::string& n){ on_client_identified(i,n); },
-                    [this](int i,const std::string& m){ on_client_message(i,m); },
-                    [this](int i){on_client_disconnect(i);}
-                  );
+/// Same round‑robin as TCP; sessions over AF_UNIX or a shared‑memory ring
+/// are indistinguishable once started.
+void Server::do_accept_local(local_stream::acceptor& acceptor, bool shm)
+{
+    Shard& target = *shards_[next_shard_];
+    next_shard_ = (next_shard_ + 1) % shards_.size();
 
-                clients_[cid] = std::make_shared<ClientSessionInfo>(session);
-                session->start();
-            }
-            do_accept();
+    acceptor.async_accept(target.io,
+        [this, &target, &acceptor, shm](auto ec, local_stream::socket socket) {
+            if (!ec)
+                net::post(target.io, [this, &target, shm, s = std::move(socket)]() mutable {
+                    if (!shm) {
+                        add_session(target, std::make_unique<LocalTransport>(std::move(s)), {});
+                        return;
+                    }
+                    ShmTransport::handshake(std::move(s),
+                        [this, &target](std::unique_ptr<Transport> t) {
+                            if (t)
+                                add_session(target, std::move(t), {});
+                        });
+                });
+            if (!handing_off_)
+                do_accept_local(acceptor, shm);
         });
 }
+
+void Server::attach(std::size_t shard, std::unique_ptr<Transport> transport,
+                    const net::ip::address& peer)
+{
+    Shard& target = *shards_[shard % shards_.size()];
+    net::post(target.io, [this, &target, peer, t = std::move(transport)]() mutable {
+        add_session(target, std::move(t), peer);
+    });
+}
+
+net::io_context& Server::shard_io(std::size_t shard)
+{
+    return shards_[shard % shards_.size()]->io;
+}
+
+/// Runs on @p target's thread. @p restored: a client carried over from a
+/// predecessor, already named and in a room there.
+void Server::add_session(Shard& target, std::unique_ptr<Transport> transport,
+                         const net::ip::address& peer, handoff::SessionState* restored)
+{
+    if (target.frozen && !transport->transferable())
+        return;     // a shared‑memory handshake done mid‑handoff; the publisher reconnects
+
+    // reserve the slot first: the session needs its id up front
+    SessionId cid = target.clients.emplace(nullptr);
+
+    auto session = std::make_shared<Session>(
+        std::move(transport), cid,
+        [this, &target](SessionId i,const std::string& n){ on_client_identified(target,i,n); },
+        [this, &target](SessionId i,std::string_view m){ on_client_message(target,i,m); },
+        [this, &target](SessionId i, DisconnectReason r){on_client_disconnect(target,i,r);},
+        &target.session_ctx
+      );
+
+    if (restored)
+        session->restore(*restored);
+    if (rate_limits_.per_address() && !peer.is_unspecified())   // not for local clients
+        session->set_address_limit(address_limit(peer));
+    ClientSessionInfo& client = *target.clients.find(cid);
+    client.session = session;
+    if (restored && restored->named) {
+        // back where it was, without an announcement: nobody saw it leave
+        client.name  = restored->name;
+        client.token = restored->token;
+        if (!client.token.empty()) {
+            std::scoped_lock lk(tickets_mtx_);
+            tickets_[client.token] = Ticket{client.name, nullptr, target.index, cid, {}};
+        }
+        Room* room = find_room(restored->room, true);
+        room = room ? room : lobby_;
+        add_member(target, cid, client, *room);
+        room->roster.restore(client.name);
+    }
+    else if (!restored)
+        target.accepts.add();
+    target.sessions.add(1);
+    if (target.frozen)          // accepted just as a handoff began: goes along unstarted
+        session->freeze();
+    else
+        session->start();
+}
+
+/// The buckets every session from @p addr shares; made on first use and
+/// forgotten once its last session is gone.
+std::shared_ptr<AddressLimit> Server::address_limit(const net::ip::address& addr)
+{
+    std::scoped_lock lk(address_mtx_);
+    std::string key = addr.to_string();
+    if (auto live = address_limits_[key].lock())
+        return live;
+    if (address_limits_.size() > 2 * address_prune_at_) {
+        for (auto it = address_limits_.begin(); it != address_limits_.end();)
+            it = it->second.expired() && it->first != key ? address_limits_.erase(it) : std::next(it);
+        address_prune_at_ = std::max<std::size_t>(1024, address_limits_.size());
+    }
+    auto limit = std::make_shared<AddressLimit>();
+    limit->messages = message_bucket(rate_limits_.address_messages, rate_limits_.burst_seconds);
+    limit->bytes    = byte_bucket(rate_limits_.address_bytes, rate_limits_.burst_seconds, max_message_);
+    address_limits_[key] = limit;
+    return limit;
+}
+
+//──────────────── resume ───────────────────────
+void Server::issue_ticket(Shard& shard, SessionId id, ClientSessionInfo& client)
+{
+    std::string token;
+    {
+        std::scoped_lock lk(tickets_mtx_);
+        do {
+            char buf[17];
+            std::uint64_t r = std::uint64_t(token_rng_()) << 32 | token_rng_();
+            std::snprintf(buf, sizeof buf, "%016llx", static_cast<unsigned long long>(r));
+            token = buf;
+        } while (tickets_.count(token));
+        tickets_[token] = Ticket{client.name, nullptr, shard.index, id, {}};
+    }
+    client.token = token;
+    client.session->deliver("[server] resume token " + token);
+}
+
+/**
+ * "/resume TOKEN SEQ" in place of a name: take over the ticket's identity
+ * and room without announcing anything, and send only the messages after
+ * SEQ. An old connection still holding the ticket (half‑open, not noticed
+ * yet) is dropped silently.
+ */
+void Server::resume(Shard& shard, SessionId id, ClientSessionInfo& client, std::string_view args)
+{
+    std::string_view token = args.substr(0, args.find(' '));
+    std::uint64_t    seq   = 0;
+    if (token.size() < args.size())
+        seq = std::strtoull(std::string(args.substr(token.size() + 1)).c_str(), nullptr, 10);
+
+    std::unique_lock lk(tickets_mtx_);
+    auto t = tickets_.find(std::string(token));
+    if (t == tickets_.end()) {
+        lk.unlock();
+        shard.resume_failures.add();
+        client.session->deliver("[server] resume failed");
+        client.session->stop();
+        return;
+    }
+    Ticket& ticket = t->second;
+    std::size_t old_shard = ticket.shard;
+    SessionId   old_id    = ticket.id;
+    ticket.shard = shard.index;
+    ticket.id    = id;
+    client.name  = ticket.name;
+    client.token = t->first;
+    Room& room   = ticket.room ? *ticket.room : *lobby_;
+    lk.unlock();
+
+    if (old_id) {
+        Shard& os = *shards_[old_shard];
+        net::post(os.io, [this, &os, old_id] { takeover(os, old_id); });
+    }
+
+    LOG_INFO("server", "Client ", id, " resumed as ", client.name);
+    shard.resumes.add();
+    MessageHistory::Delta d;
+    {
+        std::scoped_lock lk(room.order_mtx);     // as in enter_room()
+        drain_inbox(shard);
+        add_member(shard, id, client, room);
+        d = room.history.since(seq);
+    }
+    client.session->deliver("[server] resume token " + client.token);
+    client.session->deliver("[server] resumed #" + room.name);
+    if (d.lost)
+        client.session->deliver("[server] " + std::to_string(d.lost) + " messages missed");
+    if (d.records)
+        client.session->deliver(std::move(d.records));
+}
+
+/// Drop a session whose ticket was resumed by a newer connection.
+void Server::takeover(Shard& shard, SessionId id)
+{
+    ClientSessionInfo* client = shard.clients.find(id);
+    if (!client)
+        return;
+    auto session = client->session;
+    remove_member(shard, *client);
+    shard.clients.erase(id);
+    shard.sessions.sub(1);
+    session->stop();
+}
+
+//──────────────── hot upgrade ──────────────────
+void Server::do_accept_upgrade()
+{
+    upgrade_acceptor_.async_accept([this](auto ec, local_stream::socket successor) {
+        if (ec == net::error::operation_aborted)
+            return;
+        if (ec) {
+            do_accept_upgrade();
+            return;
+        }
+        successor_ = successor.release();
+        begin_handoff();
+    });
+}
+
+/**
+ * A successor connected. Stop accepting – the listening sockets stay open
+ * and new connections wait in their backlog – then hand everything over
+ * in three rounds, each ending when the last shard reports in:
+ *   1. freeze_shard() on every shard: no session parses or writes any more
+ *   2. snapshot_shard() on every shard, once its sessions' cancelled
+ *      operations have all completed
+ *   3. finish_handoff() on shard 0 sends it all, then stops the server
+ * Nothing is broadcast after round 1, so nothing is in flight between
+ * shards by round 2 except what their inboxes hold, and that is queued
+ * to the frozen sessions before they are taken apart.
+ */
+void Server::begin_handoff()
+{
+    LOG_INFO("server", "successor connected, handing off");
+    handing_off_   = true;
+    handoff_start_ = Clock::now();
+    boost::system::error_code ignored;
+    upgrade_acceptor_.close(ignored);       // one successor
+    acceptor_.cancel(ignored);
+    unix_acceptor_.cancel(ignored);
+    shm_acceptor_.cancel(ignored);
+    handoff_pending_ = shards_.size();
+    for (auto& s : shards_)
+        net::post(s->io, [this, &shard = *s] { freeze_shard(shard); });
+}
+
+void Server::freeze_shard(Shard& shard)
+{
+    shard.frozen = true;
+    flush_batches(shard);
+    std::vector<SessionId> stuck;           // in‑memory or shared‑memory: can't go along
+    shard.clients.for_each([&](SessionId id, ClientSessionInfo& c) {
+        if (!c.session->freeze())
+            stuck.push_back(id);
+    });
+    for (SessionId id : stuck) {
+        LOG_INFO("server", "[", shard.clients.find(id)->name, "] can't be handed off, disconnecting");
+        takeover(shard, id);
+    }
+    if (handoff_pending_.fetch_sub(1) != 1)
+        return;
+    net::post(shards_[0]->io, [this] {
+        send_presence();                    // pending joins / leaves go along queued
+        handoff_pending_ = shards_.size();
+        for (auto& s : shards_)
+            net::post(s->io, [this, &shard = *s] { snapshot_shard(shard); });
+    });
+}
+
+void Server::snapshot_shard(Shard& shard)
+{
+    bool settled = true;
+    shard.clients.for_each([&](SessionId, ClientSessionInfo& c) {
+        settled = settled && c.session->quiescent();
+    });
+    if (!settled) {                         // cancelled completions still to run
+        net::post(shard.io, [this, &shard] { snapshot_shard(shard); });
+        return;
+    }
+    drain_inbox(shard);
+
+    std::vector<handoff::SessionState> out;
+    shard.clients.for_each([&](SessionId, ClientSessionInfo& c) {
+        handoff::SessionState state;
+        c.session->hand_off(state);
+        c.session->detach();
+        if (state.fd < 0)
+            return;                         // closed meanwhile, e.g. as a slow consumer
+        state.name  = c.name;
+        state.room  = c.room ? c.room->name : std::string();
+        state.token = c.token;
+        out.push_back(std::move(state));
+    });
+    {
+        std::scoped_lock lk(handoff_mtx_);
+        for (auto& state : out)
+            handoff_.sessions.push_back(std::move(state));
+    }
+    if (handoff_pending_.fetch_sub(1) == 1)
+        net::post(shards_[0]->io, [this] { finish_handoff(); });
+}
+
+void Server::finish_handoff()
+{
+    handoff::State& state = handoff_;       // every shard is done with it
+    boost::system::error_code ignored;
+    if (acceptor_.is_open())
+        state.tcp_listener = acceptor_.release(ignored);
+    if (unix_acceptor_.is_open())
+        state.unix_listener = unix_acceptor_.release(ignored);
+    if (shm_acceptor_.is_open())
+        state.shm_listener = shm_acceptor_.release(ignored);
+    {
+        std::scoped_lock lk(rooms_mtx_);
+        for (auto& [name, room] : rooms_)
+            state.rooms.push_back({name, room->last_seq});
+    }
+    {
+        std::scoped_lock lk(tickets_mtx_);
+        auto now = Clock::now();
+        for (auto& [token, t] : tickets_)
+            if (!t.id)                      // attached ones travel with their session
+                state.tickets.push_back({token, t.name, t.room ? t.room->name : std::string(),
+                    std::chrono::duration_cast<std::chrono::milliseconds>(t.expires - now)});
+    }
+    std::size_t queued = 0;
+    for (auto& c : state.sessions)
+        for (auto& rec : c.outbox)
+            queued += rec.size();
+    try {
+        handoff::send(successor_, state);
+        LOG_INFO("server", "handed off ", state.sessions.size(), " sessions (", queued,
+                 " bytes queued) in ", elapsed_ns(handoff_start_) / 1000, " us; exiting");
+    }
+    catch (const std::exception& e) {
+        LOG_ERROR("server", "handoff failed, dropping every connection: ", e.what());
+    }
+    // our copies; successor_ stays open until this process exits, which is
+    // when the successor may open the log and bind the other ports
+    state.close_all();
+    socket_files_.clear();                  // the successor serves them now
+    stop();
+}
+
+/// In the constructor: what a predecessor handed over.
+void Server::adopt(handoff::State& inherited)
+{
+    for (auto& r : inherited.rooms)
+        if (Room* room = find_room(r.name, true))
+            room->last_seq = std::max(room->last_seq, r.last_seq);
+
+    auto now = Clock::now();
+    for (auto& t : inherited.tickets) {
+        Room* room    = find_room(t.room, false);
+        auto  expires = now + std::chrono::duration_cast<Clock::duration>(t.remaining);
+        if (room)
+            room->roster.restore(t.name);
+        std::scoped_lock lk(tickets_mtx_);
+        tickets_[t.token] = Ticket{t.name, room, 0, 0, expires};
+        detached_.emplace_back(expires, t.token);
+    }
+    std::sort(detached_.begin(), detached_.end());
+
+    for (auto& s : inherited.sessions) {
+        Shard& target = *shards_[next_shard_];
+        next_shard_ = (next_shard_ + 1) % shards_.size();
+        net::post(target.io, [this, &target, state = std::move(s)]() mutable {
+            restore_session(target, state);
+        });
+        s.fd = -1;                          // the handler owns it now
+    }
+    if (!inherited.sessions.empty())
+        LOG_INFO("server", "adopting ", inherited.sessions.size(), " sessions, ",
+                 inherited.rooms.size(), " rooms, ", inherited.tickets.size(), " resume tickets");
+}
+
+void Server::restore_session(Shard& target, handoff::SessionState& state)
+{
+    sockaddr_storage addr{};
+    socklen_t        len = sizeof addr;
+    ::getsockname(state.fd, reinterpret_cast<sockaddr*>(&addr), &len);
+
+    boost::system::error_code ec;
+    std::unique_ptr<Transport> transport;
+    net::ip::address peer;
+    if (addr.ss_family == AF_UNIX) {
+        local_stream::socket s(target.io);
+        s.assign(local_stream(), state.fd, ec);
+        transport = std::make_unique<LocalTransport>(std::move(s));
+    } else {
+        tcp::socket s(target.io);
+        s.assign(addr.ss_family == AF_INET6 ? tcp::v6() : tcp::v4(), state.fd, ec);
+        boost::system::error_code ignored;
+        peer = s.remote_endpoint(ignored).address();
+        transport = std::make_unique<TcpTransport>(std::move(s));
+    }
+    if (ec) {
+        LOG_WARN("server", "inherited socket for ", state.name, " unusable: ", ec.message());
+        ::close(state.fd);
+        return;
+    }
+    add_session(target, std::move(transport), peer, &state);
+}
+
+/**
+ * Step the shard's wheel once per kTimerTick. Ticks are counted from
+ * tick_epoch, so a late wakeup catches up instead of stretching every
+ * deadline; the timer is one per shard whatever the session count.
+ */
+void Server::schedule_timer_tick(Shard& shard)
+{
+    const auto next = static_cast<std::int64_t>(shard.timers.now() + 1);
+    shard.tick_timer.expires_at(shard.tick_epoch + next * kTimerTick);
+    shard.tick_timer.async_wait([this, &shard](auto ec) {
+        if (ec)
+            return;
+        const auto due = static_cast<TimerWheel::Tick>(
+            (std::chrono::steady_clock::now() - shard.tick_epoch) / kTimerTick);
+        while (shard.timers.now() < due)
+            shard.timers.advance();
+        schedule_timer_tick(shard);
+    });
+}
+
+void Server::schedule_ticket_sweep()
+{
+    if (!resume_window_.count())
+        return;
+    sweep_timer_.expires_after(std::chrono::seconds(1));
+    sweep_timer_.async_wait([this](auto ec) {
+        if (ec)
+            return;
+        sweep_tickets();
+        schedule_ticket_sweep();
+    });
+}
+
+/// Announce (on shard 0) everyone whose resume window ran out.
+void Server::sweep_tickets()
+{
+    std::vector<std::pair<std::string, Room*>> gone;
+    {
+        std::scoped_lock lk(tickets_mtx_);
+        auto now = Clock::now();
+        while (!detached_.empty() && detached_.front().first <= now) {
+            auto t = tickets_.find(detached_.front().second);
+            // skip if resumed since, or detached again with a later deadline
+            if (t != tickets_.end() && !t->second.id && t->second.expires <= now) {
+                gone.emplace_back(t->second.name, t->second.room);
+                tickets_.erase(t);
+            }
+            detached_.pop_front();
+        }
+    }
+    for (auto& [name, room] : gone) {
+        LOG_INFO("server", "[", name, "] Dissconected");
+        if (room)
+            announce(*shards_[0], *room, SlotTable<ClientSessionInfo>::kNone, name, "Dissconected", false);
+    }
+}
+
+//──────────────── stats ────────────────────────
+void Server::schedule_stats()
+{
+    if (!stats_interval_)
+        return;
+    stats_timer_.expires_after(std::chrono::seconds(stats_interval_));
+    stats_timer_.async_wait([this](auto ec) {
+        if (ec)
+            return;
+        dump_stats();
+        schedule_stats();
+    });
+}
+
+void Server::dump_stats()
+{
+    std::uint64_t writes = 0, msgs = 0, bytes = 0;
+    std::uint64_t slow = 0, dropped = 0, gaps = 0, collapses = 0;
+    for (auto& s : shards_) {
+        const SessionStats& st = s->session_ctx.stats;
+        writes    += st.write_calls.get();
+        msgs      += st.messages.get();
+        bytes     += st.bytes.get();
+        slow      += st.slow_disconnects.get();
+        dropped   += st.dropped.get();
+        gaps      += st.gap_markers.get();
+        collapses += st.collapses.get();
+    }
+    LOG_INFO("stats", "writes=", writes, " msgs_out=", msgs, " bytes_out=", bytes,
+             " syscalls/msg=", msgs ? double(writes) / double(msgs) : 0.0,
+             " queued_bytes=", global_queued_.load(std::memory_order_relaxed),
+             " slow_disconnects=", slow, " dropped=", dropped,
+             " gap_markers=", gaps, " collapses=", collapses);
+}
+
+/**
+ * Sum every shard and render in Prometheus text format. Reads are relaxed
+ * loads of single-writer counters, so a scrape never blocks a shard.
+ */
+std::string Server::render_metrics() const
+{
+    auto sum = [&](auto field) {
+        std::uint64_t v = 0;
+        for (auto& s : shards_) v += field(*s).get();
+        return v;
+    };
+    auto st = [](const Shard& s) -> const SessionStats& { return s.session_ctx.stats; };
+
+    metrics::Exposition out;
+    out.counter("chat_accepts_total", "Connections accepted",
+                sum([](const Shard& s) -> auto& { return s.accepts; }));
+    out.gauge("chat_sessions", "Connected sessions",
+              static_cast<std::int64_t>(sum([](const Shard& s) -> auto& { return s.sessions; })));
+    out.counter("chat_messages_in_total", "Chat messages received",
+                sum([&](const Shard& s) -> auto& { return st(s).messages_in; }));
+    out.counter("chat_bytes_in_total", "Bytes read from clients",
+                sum([&](const Shard& s) -> auto& { return st(s).bytes_in; }));
+    out.counter("chat_messages_out_total", "Messages fully written to clients",
+                sum([&](const Shard& s) -> auto& { return st(s).messages; }));
+    out.counter("chat_bytes_out_total", "Bytes written to clients",
+                sum([&](const Shard& s) -> auto& { return st(s).bytes; }));
+    out.counter("chat_write_calls_total", "Gathered socket writes issued",
+                sum([&](const Shard& s) -> auto& { return st(s).write_calls; }));
+    out.counter("chat_resumes_total", "Sessions resumed with a token",
+                sum([](const Shard& s) -> auto& { return s.resumes; }));
+    out.counter("chat_resume_failures_total", "Resume attempts with an unknown or expired token",
+                sum([](const Shard& s) -> auto& { return s.resume_failures; }));
+    {
+        std::scoped_lock lk(rooms_mtx_);
+        out.gauge("chat_rooms", "Rooms created", static_cast<std::int64_t>(rooms_.size()));
+    }
+    if (log_) {
+        const MessageLog::Stats& ls = log_->stats();
+        out.counter("chat_log_appended_total", "Entries appended to the message log", ls.appended.get());
+        out.counter("chat_log_dropped_total", "Entries dropped because the log writer fell behind",
+                    ls.dropped.get());
+        out.counter("chat_log_bytes_total", "Bytes written to log segments", ls.bytes.get());
+        out.counter("chat_log_fsyncs_total", "Group commits (fdatasync)", ls.fsyncs.get());
+    }
+    if (federation_) {
+        const Federation::Stats& fs = federation_->stats();
+        out.gauge("chat_fed_links", "Federation links up", fs.links.get());
+        out.counter("chat_fed_published_total", "Local messages published to peers", fs.published.get());
+        out.counter("chat_fed_received_total", "Remote messages broadcast here", fs.received.get());
+        out.counter("chat_fed_duplicates_total", "Frames already received over another link",
+                    fs.duplicates.get());
+        out.counter("chat_fed_forwarded_total", "Frames passed on to other links", fs.forwarded.get());
+        out.counter("chat_fed_link_drops_total", "Links closed by error or backlog", fs.link_drops.get());
+    }
+    out.counter("chat_logger_dropped_total", "Diagnostic lines dropped because the log ring was full",
+                logging::Logger::instance().dropped());
+    out.counter("chat_logger_suppressed_total", "Diagnostic lines suppressed as repeats",
+                logging::Logger::instance().suppressed());
+    out.gauge("chat_outbox_queued_bytes", "Bytes queued in all outboxes",
+              static_cast<std::int64_t>(global_queued_.load(std::memory_order_relaxed)));
+    out.counter("chat_outbox_dropped_total", "Messages dropped by the slow-consumer policy",
+                sum([&](const Shard& s) -> auto& { return st(s).dropped; }));
+    out.counter("chat_outbox_gap_markers_total", "Gap markers queued",
+                sum([&](const Shard& s) -> auto& { return st(s).gap_markers; }));
+    out.counter("chat_outbox_collapses_total", "Backlogs collapsed",
+                sum([&](const Shard& s) -> auto& { return st(s).collapses; }));
+    out.counter("chat_presence_events_total", "Joins and leaves announced",
+                sum([](const Shard& s) -> auto& { return s.presence_events; }));
+    out.counter("chat_presence_updates_total", "Coalesced presence lines sent to rooms",
+                sum([](const Shard& s) -> auto& { return s.presence_updates; }));
+    out.counter("chat_transfer_lines_total", "File transfer lines relayed at bulk priority",
+                sum([](const Shard& s) -> auto& { return s.transfer_lines; }));
+    out.counter("chat_bulk_dropped_total", "Bulk messages dropped at a full bulk queue",
+                sum([&](const Shard& s) -> auto& { return st(s).bulk_dropped; }));
+    out.counter("chat_bulk_waits_total", "Writes held back until the socket drained",
+                sum([&](const Shard& s) -> auto& { return st(s).bulk_waits; }));
+    out.counter("chat_heartbeats_total", "Pings sent to quiet clients",
+                sum([&](const Shard& s) -> auto& { return st(s).heartbeats; }));
+    out.counter("chat_rate_limited_total", "Inbound messages over a rate limit, by bucket",
+                sum([&](const Shard& s) -> auto& { return st(s).rate_limited_session; }),
+                "scope=\"session\"");
+    out.labelled("chat_rate_limited_total", "scope=\"address\"",
+                 sum([&](const Shard& s) -> auto& { return st(s).rate_limited_address; }));
+    out.counter("chat_rate_throttles_total", "Times reading from a client was paused",
+                sum([&](const Shard& s) -> auto& { return st(s).throttles; }));
+    out.counter("chat_rate_dropped_total", "Inbound messages dropped by a rate limit",
+                sum([&](const Shard& s) -> auto& { return st(s).rate_dropped; }));
+
+    constexpr int reasons = static_cast<int>(DisconnectReason::count_);
+    for (int r = 0; r < reasons; ++r) {
+        std::uint64_t v = sum([&](const Shard& s) -> auto& { return st(s).disconnects[r]; });
+        std::string label = std::string("reason=\"") + to_string(DisconnectReason(r)) + "\"";
+        if (r == 0)
+            out.counter("chat_disconnects_total", "Sessions ended, by reason", v, label);
+        else
+            out.labelled("chat_disconnects_total", label, v);
+    }
+
+    metrics::Log2Histogram<28>::Snapshot fanout;
+    metrics::Log2Histogram<16>::Snapshot depth;
+    for (auto& s : shards_) {
+        fanout.merge(s->fanout_ns);
+        depth.merge(st(*s).outbox_depth);
+    }
+    out.histogram<28>("chat_broadcast_fanout_seconds",
+                      "Time to hand one broadcast to every session of a shard", fanout, 1e-9);
+    out.histogram<16>("chat_outbox_depth", "Outbox entries after each enqueue", depth);
+    return out.str();
+}
@@ -0,0 +1,50 @@
+//──────────────────────────────────────────────────────────────────────────────
+// AllocCounter.cpp ― the replacement operator new / delete (AllocCounter.hpp)
+//──────────────────────────────────────────────────────────────────────────────
+#include "AllocCounter.hpp"
+#include <cstdlib>
+
+namespace alloc_counter {
+namespace {
+
+void* allocate(std::size_t n, std::size_t align = 0) noexcept
+{
+    allocs.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(n, std::memory_order_relaxed);
+    if (!n) n = 1;
+    if (align <= alignof(std::max_align_t))
+        return std::malloc(n);
+    return std::aligned_alloc(align, (n + align - 1) / align * align);
+}
+
+void* allocate_or_throw(std::size_t n, std::size_t align = 0)
+{
+    if (void* p = allocate(n, align)) return p;
+    throw std::bad_alloc();
+}
+
+} // namespace
+} // namespace alloc_counter
+
+// Every replaceable form, so each new pairs with a delete that frees the same way.
+void* operator new  (std::size_t n) { return alloc_counter::allocate_or_throw(n); }
+void* operator new[](std::size_t n) { return alloc_counter::allocate_or_throw(n); }
+void* operator new  (std::size_t n, std::align_val_t a) { return alloc_counter::allocate_or_throw(n, std::size_t(a)); }
+void* operator new[](std::size_t n, std::align_val_t a) { return alloc_counter::allocate_or_throw(n, std::size_t(a)); }
+void* operator new  (std::size_t n, const std::nothrow_t&) noexcept { return alloc_counter::allocate(n); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { return alloc_counter::allocate(n); }
+void* operator new  (std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept { return alloc_counter::allocate(n, std::size_t(a)); }
+void* operator new[](std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept { return alloc_counter::allocate(n, std::size_t(a)); }
+
+void operator delete  (void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete  (void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete  (void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete  (void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete  (void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete  (void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
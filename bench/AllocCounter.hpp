@@ -0,0 +1,28 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// AllocCounter.hpp ― global operator new / delete replacement for the benchmarks
+//
+//   • Link AllocCounter.cpp into the benchmark; this header only reads
+//     the counters
+//   • snapshot() / since() give allocations and bytes over a region
+//   • Every form is replaced – array, sized, aligned, nothrow – so each
+//     allocation is counted and each new pairs with a matching delete
+//   • The replacements live out of line so no caller sees new and delete
+//     as malloc and free (GCC would flag every pairing it inlines)
+//
+//──────────────────────────────────────────────────────────────────────────────
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+namespace alloc_counter {
+
+inline std::atomic<std::size_t> allocs{0};
+inline std::atomic<std::size_t> bytes{0};
+
+struct Sample { std::size_t allocs, bytes; };
+
+inline Sample snapshot() { return {allocs.load(), bytes.load()}; }
+inline Sample since(Sample s) { return {allocs.load() - s.allocs, bytes.load() - s.bytes}; }
+
+} // namespace alloc_counter
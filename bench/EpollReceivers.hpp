@@ -0,0 +1,143 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// EpollReceivers.hpp ― many chat clients' read ends on one epoll thread
+//
+//   • Connects N plain‑text clients to a server on loopback, names them
+//     r0 … rN‑1, then reads every socket from one epoll loop, so the
+//     measuring side costs the same whatever the server does
+//   • Senders end each line with their steady‑clock send time in ns;
+//     every delivered line that does records send → receive latency
+//     (server notices don't, and are skipped)
+//   • Counts read() calls that returned data (receiver wakeups) and bytes,
+//     and connections the server closed
+//
+//──────────────────────────────────────────────────────────────────────────────
+#include "Histogram.hpp"
+#include <boost/asio.hpp>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+inline std::uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class EpollReceivers
+{
+public:
+    using tcp = boost::asio::ip::tcp;
+
+    /// @param rcvbuf  SO_RCVBUF for every receiver (0 = kernel default); a
+    ///                small one stands in for a slow path on loopback
+    EpollReceivers(boost::asio::io_context& io, unsigned short port, std::size_t n,
+                   int rcvbuf = 0)
+    {
+        namespace net = boost::asio;
+        for (std::size_t i = 0; i < n; ++i) {
+            tcp::socket s(io);
+            if (rcvbuf) {                      // before connect: it sets the window scale
+                s.open(tcp::v4());
+                s.set_option(net::socket_base::receive_buffer_size(rcvbuf));
+            }
+            s.connect({net::ip::address_v4::loopback(), port});
+            s.set_option(tcp::no_delay(true));
+            net::write(s, net::buffer("r" + std::to_string(i) + "\n"));
+            s.non_blocking(true);
+            sockets_.push_back(std::move(s));
+        }
+        bufs_.resize(n);
+        epfd_ = ::epoll_create1(0);
+        for (std::size_t i = 0; i < n; ++i) {
+            epoll_event ev{};
+            ev.events   = EPOLLIN;
+            ev.data.u64 = i;
+            ::epoll_ctl(epfd_, EPOLL_CTL_ADD, sockets_[i].native_handle(), &ev);
+        }
+        thread_ = std::thread([this] { loop(); });
+    }
+
+    EpollReceivers(const EpollReceivers&)            = delete;
+    EpollReceivers& operator=(const EpollReceivers&) = delete;
+
+    ~EpollReceivers()
+    {
+        stop_ = true;
+        thread_.join();
+        ::close(epfd_);
+    }
+
+    std::uint64_t    stamped() const { return stamped_.load(std::memory_order_acquire); }
+    std::uint64_t    reads()   const { return reads_.load(std::memory_order_relaxed); }
+    std::uint64_t    bytes()   const { return bytes_.load(std::memory_order_relaxed); }
+    std::uint64_t    hangups() const { return hangups_.load(std::memory_order_relaxed); }
+    LatencyHistogram take()          { measuring_ = false; return latency_; }
+    void             measure()       { latency_ = {}; measuring_ = true; }
+
+private:
+    void loop()
+    {
+        epoll_event events[256];
+        char        chunk[64 * 1024];
+        while (!stop_) {
+            int n = ::epoll_wait(epfd_, events, 256, 50);
+            for (int e = 0; e < n; ++e) {
+                std::size_t i = events[e].data.u64;
+                for (;;) {
+                    ssize_t got = ::read(sockets_[i].native_handle(), chunk, sizeof chunk);
+                    if (got == 0 || (got < 0 && errno != EAGAIN && errno != EINTR)) {
+                        ::epoll_ctl(epfd_, EPOLL_CTL_DEL, sockets_[i].native_handle(), nullptr);
+                        hangups_.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    if (got <= 0)
+                        break;
+                    reads_.fetch_add(1, std::memory_order_relaxed);
+                    bytes_.fetch_add(static_cast<std::uint64_t>(got), std::memory_order_relaxed);
+                    consume(bufs_[i], std::string_view(chunk, static_cast<std::size_t>(got)));
+                }
+            }
+        }
+    }
+
+    /// Record every complete "[name] … <ns>" line; notices are skipped.
+    void consume(std::string& buf, std::string_view in)
+    {
+        buf.append(in);
+        std::size_t start = 0;
+        for (std::size_t nl; (nl = buf.find('\n', start)) != std::string::npos; start = nl + 1) {
+            std::string_view line(buf.data() + start, nl - start);
+            std::size_t sp = line.rfind(' ');
+            std::uint64_t sent = 0;
+            if (sp == std::string_view::npos || line.substr(0, 9) == "[server] ")
+                continue;
+            auto [end, ec] = std::from_chars(line.data() + sp + 1, line.data() + line.size(), sent);
+            if (ec != std::errc{} || end != line.data() + line.size())
+                continue;
+            if (measuring_)
+                latency_.record(now_ns() - sent);
+            stamped_.fetch_add(1, std::memory_order_release);
+        }
+        buf.erase(0, start);
+    }
+
+    std::vector<tcp::socket>   sockets_;
+    std::vector<std::string>   bufs_;
+    int                        epfd_ = -1;
+    std::atomic<bool>          stop_{false};
+    std::atomic<bool>          measuring_{false};
+    std::atomic<std::uint64_t> stamped_{0};
+    std::atomic<std::uint64_t> reads_{0};
+    std::atomic<std::uint64_t> bytes_{0};
+    std::atomic<std::uint64_t> hangups_{0};
+    LatencyHistogram           latency_;
+    std::thread                thread_;
+};
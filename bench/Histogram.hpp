@@ -0,0 +1,69 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// Histogram.hpp ― log‑linear latency histogram for the benchmarks
+//
+//   • 16 linear sub‑buckets per power of two → ≤ 6.25 % relative error
+//   • Fixed size, no allocation after construction; merge() to combine
+//     per‑thread instances before reading percentiles
+//
+//──────────────────────────────────────────────────────────────────────────────
+#include <array>
+#include <cstdint>
+
+class LatencyHistogram
+{
+public:
+    static constexpr int kSubBits = 4;                 // 16 sub‑buckets
+    static constexpr int kSub     = 1 << kSubBits;
+    static constexpr int kBuckets = (64 - kSubBits + 1) * kSub;
+
+    void record(std::uint64_t v)
+    {
+        ++counts_[index(v)];
+        ++total_;
+        if (v > max_) max_ = v;
+    }
+
+    void merge(const LatencyHistogram& o)
+    {
+        for (int i = 0; i < kBuckets; ++i) counts_[i] += o.counts_[i];
+        total_ += o.total_;
+        if (o.max_ > max_) max_ = o.max_;
+    }
+
+    /// Upper bound of the bucket holding quantile @p q (0..1).
+    std::uint64_t percentile(double q) const
+    {
+        if (!total_) return 0;
+        auto want = static_cast<std::uint64_t>(q * double(total_ - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i)
+            if ((seen += counts_[i]) >= want)
+                return upper(i) < max_ ? upper(i) : max_;
+        return max_;
+    }
+
+    std::uint64_t count() const { return total_; }
+    std::uint64_t max()   const { return max_; }
+
+private:
+    static int index(std::uint64_t v)
+    {
+        if (v < kSub) return static_cast<int>(v);
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - kSubBits;
+        return (shift + 1) * kSub + static_cast<int>((v >> shift) & (kSub - 1));
+    }
+
+    static std::uint64_t upper(int i)
+    {
+        if (i < kSub) return static_cast<std::uint64_t>(i);
+        int shift = i / kSub - 1;
+        std::uint64_t base = std::uint64_t(kSub + i % kSub) << shift;
+        return base + (std::uint64_t(1) << shift) - 1;
+    }
+
+    std::array<std::uint64_t, kBuckets> counts_{};
+    std::uint64_t total_ = 0;
+    std::uint64_t max_   = 0;
+};
@@ -0,0 +1,178 @@
+//──────────────────────────────────────────────────────────────────────────────
+// batching_bench.cpp ― broadcast batching window vs throughput and latency
+//
+//   • For each batch window (0 = batching off, then 500 us … 5 ms) starts a
+//     single‑shard Server in this process with --batch-us set to it
+//   • R receivers sit in the lobby, read by one epoll loop
+//     (EpollReceivers.hpp); S senders share the room and send M
+//     timestamped messages between them, round‑robin, at a fixed total
+//     rate (0 = as fast as the sockets take them)
+//   • Reports per window: messages/s delivered to everyone, server CPU per
+//     message, receiver reads per message (≈ writes the server made to
+//     each receiver) and send → receive latency p50 / p99 / max
+//
+// Expect CPU and reads per message to fall as the window grows, and the
+// latency floor to rise by about half the window.
+//
+// Usage: bench_batching [receivers] [senders] [messages] [rate_per_s] [body_bytes] [port]
+//──────────────────────────────────────────────────────────────────────────────
+#include "../include/Logger.hpp"
+#include "../include/Server.hpp"
+#include "EpollReceivers.hpp"
+#include <boost/asio.hpp>
+#include <pthread.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace net = boost::asio;
+using     tcp = net::ip::tcp;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    std::size_t    receivers = 100;
+    std::size_t    senders   = 10;
+    std::size_t    messages  = 50000;
+    double         rate      = 20000;
+    std::size_t    body      = 64;
+    unsigned short port      = 17200;
+};
+
+struct Result {
+    double           msgs_per_s   = 0;
+    double           cpu_ns       = 0;   ///< server CPU per message
+    double           reads        = 0;   ///< receiver reads per message
+    std::uint64_t    delivered    = 0;
+    LatencyHistogram latency;
+};
+
+std::uint64_t cpu_ns(clockid_t clock)
+{
+    timespec ts{};
+    ::clock_gettime(clock, &ts);
+    return std::uint64_t(ts.tv_sec) * 1'000'000'000u + std::uint64_t(ts.tv_nsec);
+}
+
+Result run(const Options& o, unsigned window_us, unsigned short port)
+{
+    ServerConfig cfg;
+    cfg.port             = port;
+    cfg.threads          = 1;
+    cfg.history_messages = 0;
+    cfg.resume_seconds   = 0;
+    cfg.outbox.session_bytes = 64u << 20;
+    cfg.batch.window_us  = window_us;
+
+    net::io_context server_io;
+    Server          server(server_io, cfg);
+    std::atomic<bool>      started{false};
+    std::atomic<clockid_t> server_clock{};
+    std::thread server_thread([&] {
+        clockid_t c;
+        pthread_getcpuclockid(pthread_self(), &c);
+        server_clock = c;
+        started      = true;
+        server.run();
+    });
+    while (!started) std::this_thread::yield();
+
+    Result r;
+    {
+        net::io_context io;
+        EpollReceivers rx(io, port, o.receivers);
+        std::vector<tcp::socket> senders;
+        for (std::size_t i = 0; i < o.senders; ++i) {
+            senders.emplace_back(io);
+            senders.back().connect({net::ip::address_v4::loopback(), port});
+            senders.back().set_option(tcp::no_delay(true));
+            net::write(senders.back(), net::buffer("s" + std::to_string(i) + "\n"));
+        }
+
+        const std::string pad(o.body > 20 ? o.body - 20 : 0, 'x');
+        std::string line;
+        auto send_one = [&](std::size_t i) {
+            line.assign(pad);
+            line += ' ';
+            line += std::to_string(now_ns());
+            line += '\n';
+            net::write(senders[i % senders.size()], net::buffer(line));
+        };
+        auto wait_for = [&](std::uint64_t target) {
+            auto give_up = clock_type::now() + std::chrono::seconds(60);
+            while (rx.stamped() < target && clock_type::now() < give_up)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        };
+
+        // warm‑up: everyone named and in the lobby, buffers grown
+        for (std::size_t i = 0; i < 50; ++i) send_one(i);
+        wait_for(50 * o.receivers);
+
+        std::uint64_t cpu0  = cpu_ns(server_clock);
+        std::uint64_t base  = rx.stamped();
+        std::uint64_t reads = rx.reads();
+        rx.measure();
+
+        auto start = clock_type::now();
+        for (std::size_t i = 0; i < o.messages; ++i) {
+            if (o.rate > 0)
+                std::this_thread::sleep_until(start + std::chrono::duration_cast<clock_type::duration>(
+                                                          std::chrono::duration<double>(double(i) / o.rate)));
+            send_one(i);
+        }
+        wait_for(base + o.messages * o.receivers);
+        double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+        r.msgs_per_s = double(o.messages) / seconds;
+        r.cpu_ns     = double(cpu_ns(server_clock) - cpu0) / double(o.messages);
+        r.reads      = double(rx.reads() - reads) / double(o.messages);
+        r.delivered  = rx.stamped() - base;
+        r.latency    = rx.take();
+
+        boost::system::error_code ignored;
+        for (auto& s : senders) s.close(ignored);
+    }
+    server.stop();
+    server_thread.join();
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options o;
+    if (argc > 1) o.receivers = std::stoul(argv[1]);
+    if (argc > 2) o.senders   = std::max<std::size_t>(1, std::stoul(argv[2]));
+    if (argc > 3) o.messages  = std::stoul(argv[3]);
+    if (argc > 4) o.rate      = std::stod(argv[4]);
+    if (argc > 5) o.body      = std::stoul(argv[5]);
+    if (argc > 6) o.port      = static_cast<unsigned short>(std::stoi(argv[6]));
+
+    logging::Config quiet;
+    quiet.level = logging::Level::warn;
+    logging::Logger::instance().configure(quiet);
+
+    std::printf("%zu receivers, %zu senders, %zu messages of %zu B at %s\n",
+                o.receivers, o.senders, o.messages, o.body,
+                o.rate > 0 ? (std::to_string(static_cast<long>(o.rate)) + "/s").c_str() : "full speed");
+    std::printf("%10s %12s %14s %14s %10s %10s %10s\n", "window us", "msgs/s",
+                "CPU us/msg", "reads/msg", "p50 us", "p99 us", "max us");
+
+    const unsigned windows[] = {0, 500, 1000, 2000, 5000};
+    unsigned short port = o.port;
+    for (unsigned w : windows) {
+        Result r = run(o, w, port++);
+        if (r.delivered < o.messages * o.receivers)
+            std::printf("  (window %u: only %llu of %zu deliveries arrived)\n", w,
+                        static_cast<unsigned long long>(r.delivered), o.messages * o.receivers);
+        std::printf("%10u %12.0f %14.2f %14.1f %10.1f %10.1f %10.1f\n", w, r.msgs_per_s,
+                    r.cpu_ns / 1e3, r.reads, r.latency.percentile(0.50) / 1e3,
+                    r.latency.percentile(0.99) / 1e3, r.latency.max() / 1e3);
+    }
+}
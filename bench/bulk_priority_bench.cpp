@@ -0,0 +1,166 @@
+//──────────────────────────────────────────────────────────────────────────────
+// bulk_priority_bench.cpp ― chat latency while a file transfer is in flight
+//
+//   • One single‑shard Server in this process; R receivers in the lobby,
+//     read by one epoll loop (EpollReceivers.hpp), with a small receive
+//     buffer (K KiB) so that, as over a real slow path, a backlog forms on
+//     the server's side of the connection – on loopback with default
+//     buffers it would sit in the receiver's kernel, beyond any scheduler
+//   • A chat sender sends timestamped lines at a fixed rate for D seconds;
+//     every delivery records send → receive latency
+//   • Meanwhile an uploader pushes F MB of base64 file data into the same
+//     room as fast as the server reads it, three ways:
+//       idle   no transfer – the baseline
+//       fifo   as ordinary chat lines, so it shares the interactive queue
+//              – what any large payload did before bulk priority
+//       bulk   as /chunk lines (Transfer.hpp), relayed at bulk priority
+//   • Reports chat p50 / p99 / max and the file data each receiver got
+//     per second while the chat ran
+//
+// Usage: bench_bulk_priority [receivers] [file_mb] [chat_per_s] [seconds] [rcvbuf_kib] [port]
+//──────────────────────────────────────────────────────────────────────────────
+#include "../include/Logger.hpp"
+#include "../include/Server.hpp"
+#include "../include/Transfer.hpp"
+#include "EpollReceivers.hpp"
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace net = boost::asio;
+using     tcp = net::ip::tcp;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+enum class Mode { idle, fifo, bulk };
+
+struct Result {
+    LatencyHistogram latency;
+    std::uint64_t    chat      = 0;   ///< chat deliveries seen
+    double           file_mb_s = 0;   ///< per receiver, during the chat
+};
+
+tcp::socket connect_as(net::io_context& io, unsigned short port, const std::string& name)
+{
+    tcp::socket s(io);
+    s.connect({net::ip::address_v4::loopback(), port});
+    s.set_option(tcp::no_delay(true));
+    net::write(s, net::buffer(name + "\n"));
+    return s;
+}
+
+Result run(Mode mode, std::size_t receivers, std::size_t file_mb, double rate, double seconds,
+           int rcvbuf, unsigned short port)
+{
+    ServerConfig cfg;
+    cfg.port             = port;
+    cfg.threads          = 1;
+    cfg.history_messages = 0;
+    cfg.resume_seconds   = 0;
+    cfg.outbox.session_bytes = 256u << 20;   // fifo mode queues the file as chat
+    cfg.outbox.bulk_bytes    = 256u << 20;
+
+    net::io_context server_io;
+    Server          server(server_io, cfg);
+    std::thread     server_thread([&] { server.run(); });
+
+    Result r;
+    {
+        net::io_context io;
+        EpollReceivers  rx(io, port, receivers, rcvbuf);
+        tcp::socket     chat = connect_as(io, port, "chat");
+        tcp::socket     up   = connect_as(io, port, "up");
+
+        auto wait_for = [&](std::uint64_t target) {
+            auto give_up = clock_type::now() + std::chrono::seconds(60);
+            while (rx.stamped() < target && clock_type::now() < give_up)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        };
+        std::string line;
+        auto send_chat = [&] {
+            line = "ping " + std::to_string(now_ns()) + '\n';
+            net::write(chat, net::buffer(line));
+        };
+        for (int i = 0; i < 20; ++i) send_chat();   // warm‑up
+        wait_for(20 * receivers);
+        std::uint64_t base = rx.stamped();
+
+        std::atomic<bool> stop{false};
+        std::thread uploader([&] {
+            if (mode == Mode::idle)
+                return;
+            std::string raw(transfer::kChunkBytes, 'x'), out;
+            for (std::size_t off = 0; off < (file_mb << 20) && !stop; off += raw.size()) {
+                out = mode == Mode::bulk ? std::string(transfer::kChunk) + "1 " + std::to_string(off) + ' '
+                                         : std::string("blob ");
+                transfer::base64_append(out, raw);
+                out += '\n';
+                net::write(up, net::buffer(out));
+            }
+        });
+
+        std::uint64_t bytes0 = rx.bytes();
+        rx.measure();
+        auto start = clock_type::now();
+        auto sent  = static_cast<std::size_t>(rate * seconds);
+        for (std::size_t i = 0; i < sent; ++i) {
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<clock_type::duration>(
+                                                      std::chrono::duration<double>(double(i) / rate)));
+            send_chat();
+        }
+        double elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+        std::uint64_t file_bytes = rx.bytes() - bytes0;
+        wait_for(base + sent * receivers);
+        stop = true;
+        uploader.join();
+
+        r.latency   = rx.take();
+        r.chat      = rx.stamped() - base;
+        r.file_mb_s = double(file_bytes) / double(receivers) / elapsed / 1e6;
+
+        boost::system::error_code ignored;
+        chat.close(ignored);
+        up.close(ignored);
+    }
+    server.stop();
+    server_thread.join();
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t    receivers = argc > 1 ? std::stoul(argv[1]) : 20;
+    std::size_t    file_mb   = argc > 2 ? std::stoul(argv[2]) : 16;
+    double         rate      = argc > 3 ? std::stod(argv[3])  : 200;
+    double         seconds   = argc > 4 ? std::stod(argv[4])  : 2;
+    int            rcvbuf    = argc > 5 ? std::stoi(argv[5]) * 1024 : 64 * 1024;
+    unsigned short port      = argc > 6 ? static_cast<unsigned short>(std::stoi(argv[6])) : 17300;
+
+    logging::Config quiet;
+    quiet.level = logging::Level::warn;
+    logging::Logger::instance().configure(quiet);
+
+    std::printf("%zu receivers (%d KiB receive buffers), chat at %.0f/s for %.1f s, %zu MB file\n",
+                receivers, rcvbuf / 1024, rate, seconds, file_mb);
+    std::printf("%8s %10s %10s %10s %14s\n", "transfer", "p50 us", "p99 us", "max us",
+                "file MB/s/rcv");
+    const std::pair<Mode, const char*> modes[] = {
+        {Mode::idle, "idle"}, {Mode::fifo, "fifo"}, {Mode::bulk, "bulk"}};
+    for (auto [mode, name] : modes) {
+        Result r = run(mode, receivers, file_mb, rate, seconds, rcvbuf, port++);
+        std::printf("%8s %10.1f %10.1f %10.1f %14.1f\n", name, r.latency.percentile(0.50) / 1e3,
+                    r.latency.percentile(0.99) / 1e3, r.latency.max() / 1e3, r.file_mb_s);
+        auto expected = static_cast<std::uint64_t>(rate * seconds) * receivers;
+        if (r.chat < expected)
+            std::printf("         (only %llu of %llu chat deliveries arrived)\n",
+                        static_cast<unsigned long long>(r.chat),
+                        static_cast<unsigned long long>(expected));
+    }
+}
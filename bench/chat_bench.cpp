@@ -0,0 +1,346 @@
+//──────────────────────────────────────────────────────────────────────────────
+// chat_bench.cpp ― load generator for a running chat_server
+//
+//   • Opens N simulated clients, each doing the name handshake
+//   • S of them send timestamped messages at a fixed per‑sender rate
+//   • Every client parses what it receives and records the end‑to‑end
+//     broadcast latency (send → delivery at each recipient)
+//   • Reports connection‑setup rate, throughput and p50/p99/p999 latency
+//
+// Latency uses steady_clock, which is CLOCK_MONOTONIC on Linux and thus
+// comparable across processes on the same host – run it against localhost.
+// Thousands of clients need `ulimit -n` raised accordingly.
+//
+// Usage: chat_bench [--host H] [--port P] [--clients N] [--senders S]
+//                   [--rate MSG_PER_SEC_PER_SENDER] [--size BYTES]
+//                   [--duration SECONDS] [--drain SECONDS] [--threads T]
+//                   [--framed]
+//──────────────────────────────────────────────────────────────────────────────
+#include "../include/Framing.hpp"
+#include "Histogram.hpp"
+#include <boost/asio.hpp>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace net = boost::asio;
+using     tcp = net::ip::tcp;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+struct Options
+{
+    std::string    host     = "127.0.0.1";
+    unsigned short port     = 12345;
+    std::size_t    clients  = 1000;
+    std::size_t    senders  = 10;
+    double         rate     = 10;     ///< messages per second per sender
+    std::size_t    size     = 64;     ///< body bytes (padded)
+    double         duration = 10;     ///< seconds of sending
+    double         drain    = 2;      ///< seconds to wait for stragglers afterwards
+    std::size_t    threads  = 2;
+    wire::Protocol proto    = wire::Protocol::text;
+};
+
+std::uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               clock_type::now().time_since_epoch()).count();
+}
+
+/// Per‑thread results, merged once the run is over.
+struct ThreadStats
+{
+    LatencyHistogram latency_us;
+    std::uint64_t    delivered = 0;
+    std::uint64_t    sent      = 0;
+};
+
+/// Shared run state; the phase flags gate what counts as "measured".
+struct Run
+{
+    Options                   opt;
+    std::atomic<std::size_t>  connected{0};
+    std::atomic<std::size_t>  failed{0};
+    std::atomic<std::uint64_t> measure_from{UINT64_MAX}; ///< ns; older messages ignored
+    std::atomic<bool>         sending{false};
+};
+
+class BenchClient : public std::enable_shared_from_this<BenchClient>
+{
+public:
+    BenchClient(net::io_context& io, Run& run, ThreadStats& stats, std::size_t id)
+        : socket_(io), timer_(io), run_(run), stats_(stats), id_(id) {}
+
+    void connect(const tcp::resolver::results_type& eps, std::function<void()> done)
+    {
+        net::async_connect(socket_, eps,
+            [self = shared_from_this(), done = std::move(done)](auto ec, auto) {
+                if (ec) {
+                    self->run_.failed.fetch_add(1);
+                    done();
+                    return;
+                }
+                socket_option_nodelay(self->socket_);
+                std::string hello;
+                if (self->run_.opt.proto == wire::Protocol::framed)
+                    wire::append_message(wire::Protocol::text, hello, wire::kFrameHello);
+                wire::append_message(self->run_.opt.proto, hello,
+                                     "bench" + std::to_string(self->id_));
+                self->send(std::move(hello));
+                self->connected_ = true;
+                self->run_.connected.fetch_add(1);
+                self->read();
+                done();
+            });
+    }
+
+    /// Send at opt.rate until the run stops sending; paced off an absolute
+    /// schedule so timer jitter doesn't lower the rate.
+    void start_sending()
+    {
+        if (!connected_)
+            return;
+        interval_ = std::chrono::nanoseconds(
+            static_cast<std::int64_t>(1e9 / run_.opt.rate));
+        next_ = clock_type::now() + interval_ * (id_ % 16) / 16; // stagger senders
+        tick();
+    }
+
+private:
+    static void socket_option_nodelay(tcp::socket& s)
+    {
+        boost::system::error_code ec;
+        s.set_option(tcp::no_delay(true), ec);
+    }
+
+    void tick()
+    {
+        timer_.expires_at(next_);
+        timer_.async_wait([self = shared_from_this()](auto ec) {
+            if (ec || !self->run_.sending.load(std::memory_order_relaxed))
+                return;
+            self->send_sample();
+            self->next_ += self->interval_;
+            self->tick();
+        });
+    }
+
+    void send_sample()
+    {
+        char body[64];
+        int n = std::snprintf(body, sizeof body, "B %llu ",
+                              static_cast<unsigned long long>(now_ns()));
+        std::string msg(body, static_cast<std::size_t>(n));
+        if (msg.size() < run_.opt.size)
+            msg.resize(run_.opt.size, 'x');
+        std::string wire_bytes;
+        wire::append_message(run_.opt.proto, wire_bytes, msg);
+        send(std::move(wire_bytes));
+        ++stats_.sent;
+    }
+
+    // one write in flight; later sends accumulate in pending_
+    void send(std::string bytes)
+    {
+        pending_ += bytes;
+        if (!writing_)
+            flush();
+    }
+
+    void flush()
+    {
+        if (pending_.empty())
+            return;
+        writing_ = true;
+        inflight_.swap(pending_);
+        pending_.clear();
+        net::async_write(socket_, net::buffer(inflight_),
+            [self = shared_from_this()](auto ec, std::size_t) {
+                self->writing_ = false;
+                if (!ec)
+                    self->flush();
+            });
+    }
+
+    void read()
+    {
+        constexpr std::size_t chunk = 64 * 1024;
+        socket_.async_read_some(net::buffer(rbuf_.prepare(chunk), chunk),
+            [self = shared_from_this()](auto ec, std::size_t n) {
+                if (ec)
+                    return;
+                self->rbuf_.commit(n);
+                self->parse();
+                self->read();
+            });
+    }
+
+    void parse()
+    {
+        std::uint64_t now = now_ns();
+        std::uint64_t from = run_.measure_from.load(std::memory_order_relaxed);
+        std::string_view msg;
+        std::size_t used = 0;
+        while (wire::next_message(run_.opt.proto, rbuf_.data(), SIZE_MAX, msg, used) ==
+               wire::Parse::message) {
+            // "[benchN] B <ns> xxxx"
+            if (auto at = msg.find("] B "); at != std::string_view::npos) {
+                std::uint64_t sent = 0;
+                const char* p = msg.data() + at + 4;
+                std::from_chars(p, msg.data() + msg.size(), sent);
+                if (sent >= from && now >= sent) {
+                    stats_.latency_us.record((now - sent) / 1000);
+                    ++stats_.delivered;
+                }
+            }
+            rbuf_.consume(used);
+        }
+    }
+
+    tcp::socket               socket_;
+    net::steady_timer         timer_;
+    Run&                      run_;
+    ThreadStats&              stats_;
+    std::size_t               id_;
+    wire::RecvBuffer          rbuf_;
+    std::string               pending_, inflight_;
+    bool                      writing_ = false;
+    bool                      connected_ = false;
+    clock_type::duration      interval_{};
+    clock_type::time_point    next_{};
+};
+
+void usage()
+{
+    std::cerr << "Usage: chat_bench [--host H] [--port P] [--clients N] [--senders S]\n"
+                 "                  [--rate MSG/S/SENDER] [--size BYTES] [--duration S]\n"
+                 "                  [--drain S] [--threads T] [--framed]\n";
+}
+
+bool parse_args(int argc, char* argv[], Options& o)
+{
+    for (int i = 1; i < argc; ++i) {
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument(argv[i]);
+            return argv[++i];
+        };
+        try {
+            if      (!std::strcmp(argv[i], "--host"))     o.host     = value();
+            else if (!std::strcmp(argv[i], "--port"))     o.port     = static_cast<unsigned short>(std::stoi(value()));
+            else if (!std::strcmp(argv[i], "--clients"))  o.clients  = std::stoul(value());
+            else if (!std::strcmp(argv[i], "--senders"))  o.senders  = std::stoul(value());
+            else if (!std::strcmp(argv[i], "--rate"))     o.rate     = std::stod(value());
+            else if (!std::strcmp(argv[i], "--size"))     o.size     = std::stoul(value());
+            else if (!std::strcmp(argv[i], "--duration")) o.duration = std::stod(value());
+            else if (!std::strcmp(argv[i], "--drain"))    o.drain    = std::stod(value());
+            else if (!std::strcmp(argv[i], "--threads"))  o.threads  = std::stoul(value());
+            else if (!std::strcmp(argv[i], "--framed"))   o.proto    = wire::Protocol::framed;
+            else return false;
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+    }
+    o.senders = std::min(o.senders, o.clients);
+    o.threads = std::max<std::size_t>(1, o.threads);
+    return o.rate > 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Run run;
+    if (!parse_args(argc, argv, run.opt)) {
+        usage();
+        return 1;
+    }
+    const Options& opt = run.opt;
+
+    // one io_context per thread; a client lives on exactly one of them
+    std::vector<std::unique_ptr<net::io_context>> ios;
+    std::vector<ThreadStats> stats(opt.threads);
+    for (std::size_t t = 0; t < opt.threads; ++t)
+        ios.push_back(std::make_unique<net::io_context>(1));
+
+    std::vector<net::executor_work_guard<net::io_context::executor_type>> work;
+    std::vector<std::thread> threads;
+    for (auto& io : ios) {
+        work.push_back(net::make_work_guard(*io));
+        threads.emplace_back([&io] { io->run(); });
+    }
+
+    tcp::resolver resolver(*ios[0]);
+    auto eps = resolver.resolve(opt.host, std::to_string(opt.port));
+
+    // ── connect phase: keep a bounded number of handshakes in flight ──
+    std::vector<std::shared_ptr<BenchClient>> clients;
+    for (std::size_t i = 0; i < opt.clients; ++i)
+        clients.push_back(std::make_shared<BenchClient>(
+            *ios[i % opt.threads], run, stats[i % opt.threads], i));
+
+    constexpr std::size_t kMaxPending = 256;
+    std::atomic<std::size_t> finished{0};
+    auto t_connect = clock_type::now();
+    for (std::size_t i = 0; i < opt.clients; ++i) {
+        while (i - finished.load() >= kMaxPending)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        clients[i]->connect(eps, [&finished] { finished.fetch_add(1); });
+    }
+    while (finished.load() < opt.clients)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    double connect_s = std::chrono::duration<double>(clock_type::now() - t_connect).count();
+
+    std::size_t connected = run.connected.load();
+    std::printf("connections : %zu ok, %zu failed in %.3f s (%.0f conn/s)\n",
+                connected, run.failed.load(), connect_s, connected / connect_s);
+
+    // let joins and history replays settle before measuring
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    // ── send phase ──
+    run.measure_from = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           clock_type::now().time_since_epoch()).count();
+    run.sending = true;
+    for (std::size_t i = 0; i < opt.senders; ++i)
+        net::post(*ios[i % opt.threads], [c = clients[i]] { c->start_sending(); });
+
+    auto t_send = clock_type::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(opt.duration));
+    run.sending = false;
+    double send_s = std::chrono::duration<double>(clock_type::now() - t_send).count();
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(opt.drain)); // in‑flight deliveries
+
+    for (auto& io : ios) io->stop();
+    for (auto& t : threads) t.join();
+
+    ThreadStats total;
+    for (auto& s : stats) {
+        total.latency_us.merge(s.latency_us);
+        total.delivered += s.delivered;
+        total.sent      += s.sent;
+    }
+
+    std::uint64_t expected = total.sent * connected;
+    std::printf("sent        : %llu msgs (%.0f msg/s)\n",
+                static_cast<unsigned long long>(total.sent), total.sent / send_s);
+    std::printf("delivered   : %llu of %llu expected (%.0f deliveries/s)\n",
+                static_cast<unsigned long long>(total.delivered),
+                static_cast<unsigned long long>(expected), total.delivered / send_s);
+    std::printf("latency (us): p50 %llu  p99 %llu  p999 %llu  max %llu\n",
+                static_cast<unsigned long long>(total.latency_us.percentile(0.50)),
+                static_cast<unsigned long long>(total.latency_us.percentile(0.99)),
+                static_cast<unsigned long long>(total.latency_us.percentile(0.999)),
+                static_cast<unsigned long long>(total.latency_us.max()));
+}
@@ -0,0 +1,95 @@
+//──────────────────────────────────────────────────────────────────────────────
+// fanout_alloc_bench.cpp ― heap cost of fanning one message out to N outboxes
+//
+//   • Replaces global operator new to count allocations and bytes
+//   • "copy"   : the old path, one std::string copy per recipient outbox
+//   • "shared" : Session::deliver(Payload), one refcount bump per recipient
+//
+// Sessions sit on real loopback sockets. While measuring, the io_context is
+// not run, so every message stays queued in the outbox; before each size an
+// untimed round of the same backlog grows every outbox ring to its peak, and
+// after each the outboxes are written out to the peers, so queue growth
+// never counts as a per‑message cost.
+//
+// Usage: bench_fanout_alloc [recipients] [messages]
+//──────────────────────────────────────────────────────────────────────────────
+#include "../include/session.hpp"
+#include "AllocCounter.hpp"
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+using alloc_counter::Sample;
+using alloc_counter::since;
+using alloc_counter::snapshot;
+
+int main(int argc, char* argv[])
+{
+    std::size_t recipients = argc > 1 ? std::stoul(argv[1]) : 1000;
+    std::size_t messages   = argc > 2 ? std::stoul(argv[2]) : 64;
+
+    net::io_context io;
+    tcp::acceptor   acceptor(io, tcp::endpoint(net::ip::address_v4::loopback(), 0));
+
+    std::vector<tcp::socket>              peers;   // the far ends, drained between rounds
+    std::vector<std::shared_ptr<Session>> sessions;
+    peers.reserve(recipients);
+    for (std::size_t i = 0; i < recipients; ++i) {
+        peers.emplace_back(io);
+        peers.back().connect(acceptor.local_endpoint());
+        peers.back().non_blocking(true);
+        sessions.push_back(std::make_shared<Session>(
+            acceptor.accept(), SessionId(i + 1),
+            [](SessionId, const std::string&) {}, [](SessionId, std::string_view) {},
+            [](SessionId, DisconnectReason) {}));
+    }
+
+    // run the writes until every outbox is empty and the peers have read it all
+    auto drain = [&] {
+        static char sink[64 * 1024];
+        for (int idle = 0; idle < 2;) {
+            bool busy = io.poll() > 0;
+            io.restart();
+            for (auto& p : peers) {
+                boost::system::error_code ec;
+                while (p.read_some(net::buffer(sink), ec) > 0)
+                    busy = true;
+            }
+            idle = busy ? 0 : idle + 1;
+        }
+    };
+
+    std::printf("%-8s %8s %10s %14s %14s\n",
+                "path", "msg_B", "recipients", "allocs/msg", "bytes/msg");
+
+    for (std::size_t size : {16, 200, 4096}) {
+        std::string body(size - 1, 'x');
+        body += '\n';
+
+        // old behaviour: one std::string per outbox entry
+        std::vector<std::deque<std::string>> copies(recipients);
+        Sample t0 = snapshot();
+        for (std::size_t m = 0; m < messages; ++m)
+            for (auto& q : copies) q.push_back(body);
+        Sample copy = since(t0);
+
+        auto fan_out = [&] {
+            for (std::size_t m = 0; m < messages; ++m) {
+                Payload p = make_message(body);
+                for (auto& s : sessions) s->deliver(p);
+            }
+        };
+        fan_out();   // warm‑up: same backlog, untimed
+        drain();
+        t0 = snapshot();
+        fan_out();
+        Sample shared = since(t0);
+        drain();
+
+        std::printf("%-8s %8zu %10zu %14.1f %14.1f\n", "copy", size, recipients,
+                    double(copy.allocs) / messages, double(copy.bytes) / messages);
+        std::printf("%-8s %8zu %10zu %14.1f %14.1f\n", "shared", size, recipients,
+                    double(shared.allocs) / messages, double(shared.bytes) / messages);
+    }
+}
@@ -0,0 +1,172 @@
+//──────────────────────────────────────────────────────────────────────────────
+// federation_bench.cpp ― cross‑node latency and link throughput
+//
+//   • Starts two federated Servers in this process (A dials B over a
+//     localhost link), one shard each
+//   • latency    : a client on A sends one timestamped message at a time;
+//                  a client on A and one on B each record when it arrives,
+//                  so same‑node and cross‑node delivery are compared
+//   • throughput : the client on A sends as fast as it can, the client on
+//                  B counts arrivals; reports messages/s and MB/s through
+//                  the link
+//
+// Usage: bench_federation [base_port] [latency_msgs] [throughput_msgs] [body_bytes]
+//──────────────────────────────────────────────────────────────────────────────
+#include "../include/Server.hpp"
+#include "Histogram.hpp"
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+namespace net = boost::asio;
+using     tcp = net::ip::tcp;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+std::uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               clock_type::now().time_since_epoch()).count();
+}
+
+/// One in‑process node: a Server on its own io_context and thread.
+struct Node {
+    net::io_context io;
+    Server          server;
+    std::thread     thread;
+
+    explicit Node(const ServerConfig& cfg) : server(io, cfg), thread([this] { server.run(); }) {}
+    ~Node() { server.stop(); thread.join(); }
+};
+
+/// Blocking text client: named on connect, reads line by line.
+class Client {
+public:
+    Client(net::io_context& io, unsigned short port, const std::string& name) : socket_(io)
+    {
+        socket_.connect({net::ip::address_v4::loopback(), port});
+        socket_.set_option(tcp::no_delay(true));
+        send(name);
+    }
+
+    void send(const std::string& line) { net::write(socket_, net::buffer(line + "\n")); }
+    void send_raw(const std::string& bytes) { net::write(socket_, net::buffer(bytes)); }
+
+    std::string line()
+    {
+        std::size_t n = net::read_until(socket_, net::dynamic_buffer(buf_), '\n');
+        std::string l = buf_.substr(0, n - 1);
+        buf_.erase(0, n);
+        return l;
+    }
+
+    /// Next line containing @p marker (skipping notices and others' messages).
+    std::string until(const std::string& marker)
+    {
+        for (;;)
+            if (std::string l = line(); l.find(marker) != std::string::npos)
+                return l;
+    }
+
+    tcp::socket& socket() { return socket_; }
+
+private:
+    tcp::socket socket_;
+    std::string buf_;
+};
+
+std::uint64_t stamp_of(const std::string& line)
+{
+    return std::stoull(line.substr(line.rfind(' ') + 1));
+}
+
+void print(const char* name, const LatencyHistogram& h)
+{
+    std::printf("  %-11s p50 %7.1f us  p99 %7.1f us  p999 %7.1f us  max %7.1f us\n", name,
+                h.percentile(0.50) / 1e3, h.percentile(0.99) / 1e3,
+                h.percentile(0.999) / 1e3, h.max() / 1e3);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    unsigned short base = argc > 1 ? static_cast<unsigned short>(std::stoi(argv[1])) : 17000;
+    std::size_t lat_msgs = argc > 2 ? std::stoul(argv[2]) : 5000;
+    std::size_t tp_msgs  = argc > 3 ? std::stoul(argv[3]) : 500000;
+    std::size_t body     = argc > 4 ? std::stoul(argv[4]) : 100;
+
+    ServerConfig a, b;
+    a.port = base;     a.federation.node_id = "A"; a.federation.peers = {"127.0.0.1:" + std::to_string(base + 11)};
+    b.port = base + 1; b.federation.node_id = "B"; b.federation.port  = static_cast<unsigned short>(base + 11);
+    a.history_messages = b.history_messages = 0;
+    a.resume_seconds   = b.resume_seconds   = 0;
+    a.outbox.session_bytes = b.outbox.session_bytes = 256u << 20;
+
+    Node nb(b), na(a);
+    net::io_context io;
+    Client sender(io, a.port, "sender"), local(io, a.port, "local"), remote(io, b.port, "remote");
+
+    // wait for the link: probe until B sees something from A
+    std::atomic<bool> up{false};
+    std::thread prober([&] {
+        for (int i = 0; !up && i < 100; ++i) {
+            sender.send("probe");
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    });
+    remote.until("[sender] probe");
+    up = true;
+    prober.join();
+    sender.send("sync");
+    for (Client* c : {&sender, &local, &remote})
+        c->until("[sender] sync");
+
+    // ── latency ──
+    LatencyHistogram same, cross;
+    std::string pad(body > 24 ? body - 24 : 0, 'x');
+    for (std::size_t i = 0; i < lat_msgs; ++i) {
+        sender.send("t" + pad + " " + std::to_string(now_ns()));
+        std::string l = local.until("[sender] t");
+        same.record(now_ns() - stamp_of(l));
+        std::string r = remote.until("[sender] t");
+        cross.record(now_ns() - stamp_of(r));
+        sender.until("[sender] t");
+    }
+    std::printf("latency  : %zu messages of %zu B, one in flight\n", lat_msgs, body);
+    print("same node", same);
+    print("cross node", cross);
+
+    // ── throughput ──
+    local.socket().close();
+    std::thread drain([&] {                   // the sender's own echo
+        for (std::size_t i = 0; i < tp_msgs; ++i)
+            sender.until("[sender] m");
+    });
+    std::string msg = "m" + std::string(body > 1 ? body - 1 : 0, 'x') + "\n";
+    std::string batch;
+    for (int i = 0; i < 256; ++i)
+        batch += msg;
+
+    auto t0 = clock_type::now();
+    std::thread writer([&] {
+        std::size_t sent = 0;
+        for (; sent + 256 <= tp_msgs; sent += 256)
+            sender.send_raw(batch);
+        for (; sent < tp_msgs; ++sent)
+            sender.send_raw(msg);
+    });
+    for (std::size_t i = 0; i < tp_msgs; ++i)
+        remote.until("[sender] m");
+    double secs = std::chrono::duration<double>(clock_type::now() - t0).count();
+    writer.join();
+    drain.join();
+
+    std::printf("link     : %zu messages of %zu B in %.2f s – %.0f msg/s, %.1f MB/s\n",
+                tp_msgs, body, secs, double(tp_msgs) / secs,
+                double(tp_msgs) * double(body) / secs / 1e6);
+}
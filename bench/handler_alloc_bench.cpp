@@ -0,0 +1,160 @@
+//──────────────────────────────────────────────────────────────────────────────
+// handler_alloc_bench.cpp ― heap allocations per relayed message, steady state
+//
+//   • One sender and R recipient Sessions on loopback sockets, driven by one
+//     io_context thread; the far ends are plain blocking sockets on their
+//     own threads (blocking calls don't allocate)
+//   • Each message the sender's Session parses is encoded into a Payload and
+//     delivered to every recipient, as Server::on_client_message does
+//   • Messages go out in rounds of kRound, each waited for at every
+//     recipient, so backlogs stay bounded and the warm‑up round reaches
+//     the peak; then every operator new is counted while M more messages
+//     are read, relayed and fully written to all recipients
+//
+// The Payload itself (record buffer + shared_ptr control block) is the
+// message, allocated once per broadcast whatever the recipient count, and
+// is reported separately. Everything else – read and write completion
+// handlers, gather lists, outbox queues, callbacks – must not allocate:
+// the exit status is 1 if it does, so this doubles as a regression check.
+//
+// Usage: bench_handler_alloc [recipients] [messages] [body_bytes]
+//──────────────────────────────────────────────────────────────────────────────
+#include "../include/session.hpp"
+#include "AllocCounter.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using alloc_counter::Sample;
+using alloc_counter::since;
+using alloc_counter::snapshot;
+
+namespace {
+
+constexpr std::size_t kRound = 1024;   ///< messages in flight at most
+
+/// Far end of a recipient: reads and counts newlines until told to stop.
+struct Reader {
+    tcp::socket              socket;
+    std::atomic<std::size_t> lines{0};
+    std::thread              thread;
+
+    explicit Reader(tcp::socket s) : socket(std::move(s)) {}
+
+    void start()
+    {
+        thread = std::thread([this] {
+            char buf[64 * 1024];
+            boost::system::error_code ec;
+            for (;;) {
+                std::size_t n = socket.read_some(net::buffer(buf), ec);
+                if (ec)
+                    return;
+                std::size_t l = 0;
+                for (std::size_t i = 0; i < n; ++i)
+                    l += buf[i] == '\n';
+                lines.fetch_add(l, std::memory_order_relaxed);
+            }
+        });
+    }
+};
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t recipients = argc > 1 ? std::stoul(argv[1]) : 8;
+    std::size_t messages   = argc > 2 ? std::stoul(argv[2]) : 100000;
+    std::size_t body       = argc > 3 ? std::stoul(argv[3]) : 100;
+
+    SessionContext ctx;                     // one shard's worth of sessions
+    ctx.limits.session_bytes = std::size_t(1) << 30;
+
+    net::io_context io(1);
+    tcp::acceptor   acceptor(io, tcp::endpoint(net::ip::address_v4::loopback(), 0));
+
+    std::vector<std::shared_ptr<Session>> sessions;
+    std::vector<std::unique_ptr<Reader>>  readers;
+    for (std::size_t i = 0; i < recipients; ++i) {
+        tcp::socket far(io);
+        far.connect(acceptor.local_endpoint());
+        sessions.push_back(std::make_shared<Session>(
+            acceptor.accept(), SessionId(i + 2),
+            [](SessionId, const std::string&) {}, [](SessionId, std::string_view) {},
+            [](SessionId, DisconnectReason) {}, &ctx));
+        net::write(far, net::buffer("r" + std::to_string(i) + "\n"));
+        readers.push_back(std::make_unique<Reader>(std::move(far)));
+    }
+
+    std::atomic<std::size_t> payload_allocs{0};
+    auto relay = [&](SessionId, std::string_view text) {
+        Sample s = snapshot();
+        std::string rec;
+        rec.reserve(text.size() + kRecordOverhead);
+        append_record(rec, text);
+        Payload p = make_payload(std::move(rec));
+        payload_allocs.fetch_add(since(s).allocs, std::memory_order_relaxed);
+        for (auto& r : sessions)
+            r->deliver(p);
+    };
+
+    tcp::socket sender_far(io);
+    sender_far.connect(acceptor.local_endpoint());
+    auto sender = std::make_shared<Session>(
+        acceptor.accept(), SessionId(1),
+        [](SessionId, const std::string&) {}, relay, [](SessionId, DisconnectReason) {}, &ctx);
+
+    sender->start();
+    for (auto& s : sessions) s->start();
+    for (auto& r : readers)  r->start();
+    auto work = net::make_work_guard(io);
+    std::thread io_thread([&] { io.run(); });
+
+    std::string line = std::string(body > 1 ? body - 1 : 0, 'x') + "\n";
+    std::string round;
+    for (std::size_t i = 0; i < kRound; ++i) round += line;
+    auto send = [&](std::size_t n) {
+        for (std::size_t sent = 0; sent < n; sent += kRound) {
+            std::size_t k = std::min(kRound, n - sent);
+            std::size_t target = readers[0]->lines.load() + k;
+            net::write(sender_far, net::buffer(round.data(), k * line.size()));
+            for (auto& r : readers)
+                while (r->lines.load(std::memory_order_relaxed) < target)
+                    std::this_thread::yield();
+        }
+    };
+
+    net::write(sender_far, net::buffer(std::string("sender\n")));
+    send(16 * kRound);                        // warm‑up: grow buffers and queues to peak
+
+    payload_allocs = 0;
+    Sample t0 = snapshot();
+    send(messages);
+    Sample total = since(t0);
+
+    double per_msg     = double(total.allocs) / double(messages);
+    double per_payload = double(payload_allocs.load()) / double(messages);
+    std::size_t net_allocs = total.allocs - payload_allocs.load();
+    std::printf("%zu messages of %zu B relayed to %zu recipients\n", messages, body, recipients);
+    std::printf("  allocations / message : %8.3f total\n", per_msg);
+    std::printf("                          %8.3f payload (once per broadcast)\n", per_payload);
+    std::printf("                          %8.3f networking (%zu in all)\n",
+                double(net_allocs) / double(messages), net_allocs);
+
+    boost::system::error_code ignored;
+    sender_far.shutdown(tcp::socket::shutdown_both, ignored);
+    for (auto& r : readers) r->socket.shutdown(tcp::socket::shutdown_both, ignored);
+    for (auto& s : sessions) net::post(io, [s] { s->stop(); });
+    net::post(io, [&] { sender->stop(); work.reset(); });
+    for (auto& r : readers) r->thread.join();
+    io_thread.join();
+
+    if (net_allocs) {
+        std::printf("FAIL: the per‑message networking path allocates\n");
+        return 1;
+    }
+    std::printf("OK: no networking allocations after warm‑up\n");
+}
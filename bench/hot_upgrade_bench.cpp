@@ -0,0 +1,191 @@
+//──────────────────────────────────────────────────────────────────────────────
+// hot_upgrade_bench.cpp ― chat_server replaced mid‑stream by a new process
+//
+//   • Runs the real binary: chat_server --upgrade-socket S, then, while
+//     traffic flows, U more of them in turn, each started with
+//     --takeover S (Handoff.hpp) – the old one hands over and exits
+//   • R receivers in the lobby over TCP, read by one epoll loop
+//     (EpollReceivers.hpp); one sender sends timestamped lines at a fixed
+//     rate for D seconds, the upgrades spread evenly across them
+//   • Reports, per upgrade, the time from starting the successor until
+//     the old process has exited, and the servers' own handoff timings
+//     (from their log); then lines delivered against lines sent × R,
+//     duplicates, connections the server closed, and send → receive
+//     latency – the max is the stall an upgrade causes
+//   • Exit status 1 if any line was lost or any client disconnected
+//
+// Usage: bench_hot_upgrade [receivers] [rate_per_s] [seconds] [upgrades] [port] [chat_server]
+//        (chat_server defaults to the one next to this binary)
+//──────────────────────────────────────────────────────────────────────────────
+#include "EpollReceivers.hpp"
+#include <boost/asio.hpp>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern char** environ;
+
+namespace net = boost::asio;
+using     tcp = net::ip::tcp;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+pid_t spawn(const std::string& binary, const std::vector<std::string>& args)
+{
+    std::vector<char*> argv{const_cast<char*>(binary.c_str())};
+    for (auto& a : args)
+        argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+    pid_t pid = -1;
+    if (::posix_spawn(&pid, binary.c_str(), nullptr, nullptr, argv.data(), environ) != 0)
+        return -1;
+    return pid;
+}
+
+bool wait_listening(net::io_context& io, unsigned short port)
+{
+    auto give_up = clock_type::now() + std::chrono::seconds(5);
+    while (clock_type::now() < give_up) {
+        tcp::socket probe(io);
+        boost::system::error_code ec;
+        probe.connect({net::ip::address_v4::loopback(), port}, ec);
+        if (!ec)
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t    receivers = argc > 1 ? std::stoul(argv[1]) : 50;
+    double         rate      = argc > 2 ? std::stod(argv[2])  : 2000;
+    double         seconds   = argc > 3 ? std::stod(argv[3])  : 3;
+    std::size_t    upgrades  = argc > 4 ? std::stoul(argv[4]) : 3;
+    unsigned short port      = argc > 5 ? static_cast<unsigned short>(std::stoi(argv[5])) : 17500;
+    std::string    binary    = argc > 6 ? argv[6] : std::string();
+    if (binary.empty()) {
+        std::string self = argv[0];
+        auto slash = self.rfind('/');
+        binary = (slash == std::string::npos ? std::string(".") : self.substr(0, slash)) + "/chat_server";
+    }
+
+    const std::string base    = "/tmp/chat_upgrade_" + std::to_string(::getpid());
+    const std::string sock    = base + ".sock";
+    const std::string log     = base + ".log";
+    const std::vector<std::string> common = {
+        "--port", std::to_string(port), "--upgrade-socket", sock, "--history", "0",
+        "--presence", "off", "--log-file", log, "--log-level", "info"};
+
+    pid_t server = spawn(binary, common);
+    net::io_context io;
+    if (server < 0 || !wait_listening(io, port)) {
+        std::printf("FAIL: could not start %s\n", binary.c_str());
+        return 1;
+    }
+
+    std::printf("%zu receivers, %.0f lines/s for %.1f s, %zu upgrades (%s)\n",
+                receivers, rate, seconds, upgrades, binary.c_str());
+    std::uint64_t sent = 0, lost = 0, dups = 0, hangups = 0;
+    LatencyHistogram latency;
+    std::vector<double> handover_ms;
+    {
+        EpollReceivers rx(io, port, receivers);
+        tcp::socket sender(io);
+        sender.connect({net::ip::address_v4::loopback(), port});
+        sender.set_option(tcp::no_delay(true));
+        net::write(sender, net::buffer(std::string("src\n")));
+        std::thread echo([fd = sender.native_handle()] {   // its own lines come back too
+            char chunk[64 * 1024];
+            while (::read(fd, chunk, sizeof chunk) > 0)
+                ;
+        });
+
+        auto wait_for = [&](std::uint64_t target) {
+            auto give_up = clock_type::now() + std::chrono::seconds(10);
+            while (rx.stamped() < target && clock_type::now() < give_up)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        };
+        std::string line;
+        auto send = [&] {
+            line = "t " + std::to_string(now_ns()) + '\n';
+            net::write(sender, net::buffer(line));
+            ++sent;
+        };
+        for (int i = 0; i < 20; ++i) send();   // warm‑up
+        wait_for(sent * receivers);
+
+        // the upgrades run on their own thread so the sender keeps its rate
+        std::thread upgrader([&] {
+            for (std::size_t u = 1; u <= upgrades; ++u) {
+                std::this_thread::sleep_for(std::chrono::duration<double>(
+                    seconds / double(upgrades + 1)));
+                std::vector<std::string> args = common;
+                args.push_back("--takeover");
+                args.push_back(sock);
+                auto t0 = clock_type::now();
+                pid_t next = spawn(binary, args);
+                int status = 0;
+                ::waitpid(server, &status, 0);
+                handover_ms.push_back(
+                    std::chrono::duration<double, std::milli>(clock_type::now() - t0).count());
+                server = next;
+            }
+        });
+
+        std::uint64_t base_sent = sent;
+        rx.measure();
+        auto start = clock_type::now();
+        auto total = static_cast<std::size_t>(rate * seconds);
+        for (std::size_t i = 0; i < total; ++i) {
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<clock_type::duration>(
+                                                      std::chrono::duration<double>(double(i) / rate)));
+            send();
+        }
+        upgrader.join();
+        wait_for(sent * receivers);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));   // anything extra
+
+        std::uint64_t expected = sent * receivers, got = rx.stamped();
+        lost    = expected > got ? expected - got : 0;
+        dups    = got > expected ? got - expected : 0;
+        hangups = rx.hangups();
+        latency = rx.take();
+        sent   -= base_sent;
+
+        ::kill(server, SIGTERM);
+        int status = 0;
+        ::waitpid(server, &status, 0);
+        echo.join();
+    }
+
+    for (std::size_t u = 0; u < handover_ms.size(); ++u)
+        std::printf("  upgrade %zu: successor started → old server gone in %.1f ms\n",
+                    u + 1, handover_ms[u]);
+    std::ifstream in(log);
+    for (std::string l; std::getline(in, l);)
+        if (l.find("handed off") != std::string::npos || l.find("took over") != std::string::npos)
+            std::printf("    %s\n", l.c_str());
+    std::printf("lines sent %llu × %zu receivers: lost %llu, duplicated %llu, disconnects %llu\n",
+                static_cast<unsigned long long>(sent), receivers,
+                static_cast<unsigned long long>(lost), static_cast<unsigned long long>(dups),
+                static_cast<unsigned long long>(hangups));
+    std::printf("latency us: p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+                latency.percentile(0.50) / 1e3, latency.percentile(0.99) / 1e3,
+                latency.percentile(0.999) / 1e3, latency.max() / 1e3);
+    ::unlink(log.c_str());
+    if (lost || dups || hangups) {
+        std::printf("FAIL\n");
+        return 1;
+    }
+    std::printf("OK: no line lost or repeated, no client disconnected\n");
+}
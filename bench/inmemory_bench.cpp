@@ -0,0 +1,528 @@
+//──────────────────────────────────────────────────────────────────────────────
+// inmemory_bench.cpp ― Server and Session over in‑memory transports
+//
+//   • No sockets: every client is a MemoryPeer (MemoryTransport.hpp) given
+//     to the Server with attach(); a single‑shard Server's io_context is
+//     polled on this thread, so each check replays the same sequence of
+//     events every run
+//   • Checks – the exit status is 1 if any fails:
+//       order       every member gets every broadcast once, in order
+//       disconnect  members hanging up mid‑stream (idle, with a write
+//                   pending on a full pipe, or queued behind one) and a
+//                   slow consumer cut off mid‑broadcast are all released;
+//                   everyone else still gets everything
+//       stop        destroying the Server with sessions mid‑handshake,
+//                   mid‑read and stalled mid‑write releases every one
+//       threaded    the same with 4 shards on their own threads, stopped
+//                   while clients are still joining and talking
+//       quiet       with a 1 s heartbeat and a 2 s idle limit, a silent
+//                   framed client is pinged and reaped; a silent text
+//                   client (maybe an old one) is neither, 3.5 s later
+//       one line    a framed sender's line breaks – in its message or its
+//                   name – never reach a text client as extra lines
+//       sequenced   4 shards on their own threads, 8 sequenced members all
+//                   talking at once: each sees the room's sequence numbers
+//                   strictly rising and gets every broadcast
+//       resume      4 shards, talkers on every one; a sequenced member
+//                   drops and resumes over and over and still sees every
+//                   seq exactly once, in order
+//   • Then measures fan‑out: one sender, N members; the Server's cost per
+//     delivery (message × member) for rounds of 1 and of 16 messages,
+//     with the members draining their pipes between rounds (not timed)
+//
+// Usage: bench_inmemory [members] [messages] [body_bytes]
+//──────────────────────────────────────────────────────────────────────────────
+#include "../include/Logger.hpp"
+#include "../include/MemoryTransport.hpp"
+#include "../include/Server.hpp"
+#include "../include/Framing.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+    std::printf("  %-4s %s\n", ok ? "ok" : "FAIL", what);
+    failures += !ok;
+}
+
+ServerConfig quiet_config(std::size_t threads = 1)
+{
+    ServerConfig cfg;
+    cfg.listen           = false;
+    cfg.threads          = threads;
+    cfg.history_messages = 0;
+    cfg.resume_seconds   = 0;
+    cfg.presence.mode    = PresenceMode::off;
+    cfg.timeouts         = {0, 0, 0};
+    return cfg;
+}
+
+/// A Server on the caller's io_context and its in‑memory clients.
+struct Harness {
+    net::io_context         io;
+    std::unique_ptr<Server> server;
+    std::vector<MemoryPeer> peers;
+
+    explicit Harness(const ServerConfig& cfg) : server(std::make_unique<Server>(io, cfg)) {}
+
+    MemoryPeer& connect(const std::string& name, std::size_t capacity = SIZE_MAX)
+    {
+        std::size_t shard = peers.size() % server->shard_count();
+        auto [transport, peer] = make_memory_pair(server->shard_io(shard).get_executor(), capacity);
+        server->attach(shard, std::move(transport));
+        if (!name.empty())
+            peer.write(name + "\n");
+        peers.push_back(std::move(peer));
+        return peers.back();
+    }
+
+    /// Run shard 0 until nothing is ready.
+    void settle()
+    {
+        while (io.poll())
+            ;
+    }
+};
+
+/// Lines of @p text that start with @p prefix, prefix stripped.
+std::vector<std::string> lines_from(const std::string& text, std::string_view prefix)
+{
+    std::vector<std::string> out;
+    std::size_t start = 0;
+    for (std::size_t nl; (nl = text.find('\n', start)) != std::string::npos; start = nl + 1) {
+        std::string_view line(text.data() + start, nl - start);
+        if (line.substr(0, prefix.size()) == prefix)
+            out.emplace_back(line.substr(prefix.size()));
+    }
+    return out;
+}
+
+bool in_order(const std::vector<std::string>& got, std::size_t first, std::size_t count)
+{
+    if (got.size() != count)
+        return false;
+    for (std::size_t i = 0; i < count; ++i)
+        if (got[i] != std::to_string(first + i))
+            return false;
+    return true;
+}
+
+//──────────────── checks ───────────────────────
+void check_order()
+{
+    constexpr std::size_t kMembers = 50, kMessages = 300;
+    Harness h(quiet_config());
+    for (std::size_t i = 0; i < kMembers; ++i)
+        h.connect("m" + std::to_string(i));
+    h.settle();
+
+    std::vector<std::string> got(kMembers);
+    for (std::size_t k = 0; k < kMessages; ++k) {
+        h.peers[k % 3].write(std::to_string(k) + "\n");   // three senders, interleaved
+        if (k % 7 == 0)
+            h.settle();
+        if (k % 11 == 0)
+            for (std::size_t i = 0; i < kMembers; ++i)
+                got[i] += h.peers[i].take();
+    }
+    h.settle();
+    bool ok = true;
+    for (std::size_t i = 0; i < kMembers; ++i) {
+        got[i] += h.peers[i].take();
+        // sender s sent s, s+3, s+6, …
+        for (std::size_t s = 0; s < 3; ++s) {
+            std::vector<std::string> lines = lines_from(got[i], "[m" + std::to_string(s) + "] ");
+            std::size_t expected = (kMessages - s + 2) / 3;
+            ok = ok && lines.size() == expected;
+            for (std::size_t n = 0; ok && n < expected; ++n)
+                ok = lines[n] == std::to_string(s + 3 * n);
+        }
+    }
+    check(ok, "order: 300 broadcasts from 3 senders reach 50 members once each, in order");
+}
+
+void check_disconnect()
+{
+    constexpr std::size_t kMembers = 40, kMessages = 200;
+    ServerConfig cfg = quiet_config();
+    cfg.outbox.session_bytes = 16 * 1024;
+    Harness h(cfg);
+    h.connect("sender");
+    for (std::size_t i = 1; i < kMembers; ++i)
+        h.connect("m" + std::to_string(i), i % 2 ? 512 : SIZE_MAX);   // odd: tiny pipes
+    MemoryPeer& slow = h.connect("slow", 64);                          // never drained
+    h.settle();
+
+    std::string body(100, 'x');
+    std::vector<std::string> got(kMembers);
+    auto send = [&](std::size_t k) { h.peers[0].write(std::to_string(k) + " " + body + "\n"); };
+    for (std::size_t k = 0; k < kMessages / 2; ++k) {
+        send(k);
+        h.settle();
+        for (std::size_t i = 0; i < kMembers; ++i)
+            if (i % 5 != 4 || k < 10)          // the closers stall after message 10
+                got[i] += h.peers[i].take();
+    }
+    // hang up mid‑stream: members 4, 9, … have writes pending on full pipes
+    // and more queued; close half of them before the next broadcast is
+    // read, the rest in the same poll as it
+    for (std::size_t i = 4; i < kMembers; i += 10)
+        h.peers[i].close();
+    send(kMessages / 2);
+    for (std::size_t i = 9; i < kMembers; i += 10)
+        h.peers[i].close();
+    for (std::size_t k = kMessages / 2 + 1; k < kMessages; ++k) {
+        send(k);
+        h.settle();
+        for (std::size_t i = 0; i < kMembers; ++i)
+            if (i % 5 != 4)
+                got[i] += h.peers[i].take();
+    }
+    h.settle();
+
+    bool closers_released = true, others_complete = true;
+    for (std::size_t i = 0; i < kMembers; ++i) {
+        if (i % 5 == 4) {
+            closers_released = closers_released && h.peers[i].released();
+            continue;
+        }
+        got[i] += h.peers[i].take();
+        std::vector<std::string> lines = lines_from(got[i], "[sender] ");
+        for (auto& l : lines) l.resize(l.find(' '));
+        others_complete = others_complete && in_order(lines, 0, kMessages);
+    }
+    check(closers_released, "disconnect: members hanging up with writes pending are released");
+    check(others_complete,  "disconnect: the other members still get all 200 broadcasts in order");
+    check(slow.closed() && slow.released(),
+          "disconnect: a slow consumer cut off mid‑broadcast is released");
+}
+
+void check_stop()
+{
+    Harness h(quiet_config());
+    h.connect("");                                   // mid‑handshake: no name yet
+    h.peers[0].write("hal");                         // … half a name
+    for (std::size_t i = 0; i < 20; ++i)
+        h.connect("m" + std::to_string(i), i % 2 ? 256 : SIZE_MAX);
+    h.settle();
+    for (std::size_t k = 0; k < 50; ++k)             // odd members stall mid‑write
+        h.peers[1].write("line " + std::to_string(k) + "\n");
+    h.peers[2].write("partial line, no newline");    // mid‑read
+    h.settle();
+
+    h.server.reset();
+    bool released = true;
+    for (auto& p : h.peers)
+        released = released && p.closed() && p.released();
+    check(released, "stop: destroying the Server releases every session, whatever it was doing");
+}
+
+void check_threaded_stop()
+{
+    constexpr std::size_t kClients = 2000;
+    Harness h(quiet_config(4));
+    std::thread runner([&] { h.server->run(); });
+    for (std::size_t i = 0; i < kClients; ++i) {
+        MemoryPeer& p = h.connect("t" + std::to_string(i));
+        p.write("hello from " + std::to_string(i) + "\n");
+        if (i == kClients / 2)
+            h.server->stop();                        // mid‑stream: half still joining
+        if (i % 64 == 0)
+            for (auto& q : h.peers) q.take();
+    }
+    runner.join();
+    h.server.reset();
+    bool released = true;
+    for (auto& p : h.peers)
+        released = released && p.released();
+    check(released, "threaded: 4 shards stopped while 2000 clients join and talk release them all");
+}
+
+void check_quiet_text_client()
+{
+    ServerConfig cfg = quiet_config();
+    cfg.timeouts = {10, 1, 2};
+    Harness h(cfg);
+    h.connect("old");                                // text, never says a word
+    std::string hello(wire::kFrameHello);
+    hello += '\n';
+    wire::append_message(wire::Protocol::framed, hello, "new");
+    h.connect("").write(hello);                      // framed, never answers a ping
+
+    std::string text_got, framed_got;
+    auto until = clock_type::now() + std::chrono::milliseconds(3500);
+    while (clock_type::now() < until) {
+        h.settle();
+        text_got   += h.peers[0].take();
+        framed_got += h.peers[1].take();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    check(!h.peers[0].closed() && text_got.find(wire::kPing) == std::string::npos,
+          "quiet: a silent text client is never pinged, and outlives the idle limit");
+    check(h.peers[1].closed() && framed_got.find(wire::kPing) != std::string::npos,
+          "quiet: a silent framed client is pinged, then reaped");
+}
+
+void check_one_line()
+{
+    Harness h(quiet_config());
+    h.connect("bob");                                // text
+    for (std::string name : {"alice", "eve\n[server] hi"}) {
+        MemoryPeer& framed = h.connect("");
+        std::string hello(wire::kFrameHello);
+        hello += '\n';
+        wire::append_message(wire::Protocol::framed, hello, name);
+        framed.write(hello);
+    }
+    h.settle();
+    MemoryPeer& text = h.peers[0];                   // connect() may have moved it
+    text.take();
+
+    std::string msg;
+    wire::append_message(wire::Protocol::framed, msg, "a\n[bob] x\r[server] y");
+    h.peers[1].write(msg);
+    h.peers[2].write(msg);
+    h.settle();
+    std::string got = text.take();
+    check(got == "[alice] a [bob] x [server] y\n[eve [server] hi] a [bob] x [server] y\n",
+          "one line: a framed sender's \"a\\n[bob] x\" reaches a text client as one line");
+}
+
+void check_sequenced_threaded()
+{
+    constexpr std::size_t kClients = 8, kMessages = 2500, kPerWrite = 50;
+    ServerConfig cfg = quiet_config(4);
+    cfg.outbox.session_bytes = 64u << 20;
+    Harness h(cfg);
+    std::thread runner([&] { h.server->run(); });
+
+    struct Member {
+        std::string   buf;                 ///< received, not yet parsed
+        std::uint64_t last_seq = 0;
+        std::size_t   chat = 0, out_of_order = 0;
+        bool          joined = false;
+    };
+    std::vector<Member> members(kClients);
+    auto drain = [&] {
+        for (std::size_t i = 0; i < kClients; ++i) {
+            Member& m = members[i];
+            m.buf += h.peers[i].take();
+            std::size_t at = 0, used = 0;
+            std::uint64_t seq = 0;
+            std::string_view msg;
+            while (wire::next_sequenced(std::string_view(m.buf).substr(at), SIZE_MAX, seq, msg, used)
+                   == wire::Parse::message) {
+                at += used;
+                if (!seq) {                    // server notice
+                    m.joined = m.joined || msg.substr(0, 15) == "[server] now in";
+                    continue;
+                }
+                m.out_of_order += seq <= m.last_seq;
+                m.last_seq = std::max(m.last_seq, seq);
+                m.chat += msg.substr(0, 9) != "[server] ";
+            }
+            m.buf.erase(0, at);
+        }
+    };
+    auto wait_until = [&](auto done) {
+        auto give_up = clock_type::now() + std::chrono::seconds(10);
+        while (drain(), !done() && clock_type::now() < give_up)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    };
+
+    for (std::size_t i = 0; i < kClients; ++i) {
+        MemoryPeer& p = h.connect("");
+        std::string hello(wire::kSeqHello);
+        hello += '\n';
+        wire::append_message(wire::Protocol::sequenced, hello, "s" + std::to_string(i));
+        p.write(hello);
+    }
+    wait_until([&] {
+        for (auto& m : members) if (!m.joined) return false;
+        return true;
+    });
+
+    std::string chunk;
+    for (std::size_t k = 0; k < kMessages; k += kPerWrite) {
+        for (std::size_t i = 0; i < kClients; ++i) {
+            chunk.clear();
+            for (std::size_t n = k; n < k + kPerWrite; ++n)
+                wire::append_message(wire::Protocol::sequenced, chunk, std::to_string(n));
+            h.peers[i].write(chunk);
+        }
+        drain();
+    }
+    wait_until([&] {
+        for (auto& m : members) if (m.chat < kClients * kMessages) return false;
+        return true;
+    });
+    h.server->stop();
+    runner.join();
+
+    bool ordered = true, complete = true;
+    for (auto& m : members) {
+        ordered  = ordered && m.out_of_order == 0;
+        complete = complete && m.chat == kClients * kMessages;
+    }
+    check(ordered,  "sequenced: 8 members across 4 shards see every room seq rising, never back");
+    check(complete, "sequenced: … and each gets all 20000 broadcasts");
+}
+
+void check_resume_threaded()
+{
+    constexpr std::size_t kTalkers = 3, kCycles = 40, kPerCycle = 60;
+    ServerConfig cfg = quiet_config(4);
+    cfg.history_messages     = 1u << 20;
+    cfg.history_bytes        = 256u << 20;
+    cfg.resume_seconds       = 60;
+    cfg.outbox.session_bytes = 64u << 20;
+    Harness h(cfg);
+    std::thread runner([&] { h.server->run(); });
+    for (std::size_t i = 0; i < kTalkers; ++i)
+        h.connect("t" + std::to_string(i));
+
+    std::size_t   member = 0;        ///< index of its current connection in h.peers
+    std::string   buf, token;
+    std::uint64_t last_seq = 0;
+    std::size_t   repeats_or_gaps = 0, failed = 0;
+    bool          in_room = false, saw_end = false;
+    auto open = [&](const std::string& name) {
+        std::string hello(wire::kSeqHello);
+        hello += '\n';
+        wire::append_message(wire::Protocol::sequenced, hello, name);
+        h.connect("").write(hello);
+        member  = h.peers.size() - 1;
+        in_room = false;
+        buf.clear();
+    };
+    auto drain = [&] {
+        for (std::size_t i = 0; i < kTalkers; ++i)
+            h.peers[i].take();
+        buf += h.peers[member].take();
+        std::size_t at = 0, used = 0;
+        std::uint64_t seq = 0;
+        std::string_view msg;
+        while (wire::next_sequenced(std::string_view(buf).substr(at), SIZE_MAX, seq, msg, used)
+               == wire::Parse::message) {
+            at += used;
+            if (!seq) {                        // server notice
+                if (msg.substr(0, 22) == "[server] resume token ")
+                    token = msg.substr(22);
+                in_room = in_room || msg.substr(0, 15) == "[server] now in"
+                                  || msg.substr(0, 16) == "[server] resumed";
+                failed += msg == "[server] resume failed";
+                continue;
+            }
+            repeats_or_gaps += last_seq && seq != last_seq + 1;
+            last_seq = std::max(last_seq, seq);
+            saw_end  = saw_end || msg == "[t0] end";
+        }
+        buf.erase(0, at);
+    };
+    auto wait_until = [&](auto done) {
+        auto give_up = clock_type::now() + std::chrono::seconds(10);
+        while (drain(), !done() && clock_type::now() < give_up)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    };
+    auto talk = [&](std::size_t from, std::size_t to) {
+        for (std::size_t k = from; k < to; ++k)
+            h.peers[k % kTalkers].write(std::to_string(k) + "\n");
+    };
+
+    open("member");
+    wait_until([&] { return in_room && !token.empty(); });
+    for (std::size_t c = 0; c < kCycles; ++c) {
+        talk(0, kPerCycle / 2);
+        drain();
+        h.peers[member].close();               // drop mid‑stream …
+        talk(kPerCycle / 2, kPerCycle);
+        open("/resume " + token + " " + std::to_string(last_seq));   // … and come back
+        talk(0, kPerCycle);                    // while the others keep talking
+        wait_until([&] { return in_room || failed; });
+    }
+    h.peers[0].write("end\n");
+    wait_until([&] { return saw_end; });
+    h.server->stop();
+    runner.join();
+
+    check(!failed && saw_end && repeats_or_gaps == 0,
+          "resume: a member resuming 40 times amid 4 shards of traffic sees each seq exactly once");
+}
+
+//──────────────── fan‑out cost ─────────────────
+void fan_out(std::size_t members, std::size_t messages, std::size_t body)
+{
+    Harness h(quiet_config());
+    h.connect("sender");
+    for (std::size_t i = 1; i < members; ++i)
+        h.connect("r" + std::to_string(i));
+    MemoryPeer& sender = h.peers[0];
+    h.settle();
+    for (auto& p : h.peers) p.take();
+
+    std::string line = std::string(body > 1 ? body - 1 : 0, 'x') + "\n";
+    std::printf("%zu members, %zu messages of %zu B\n", members, messages, body);
+    std::printf("%8s %14s %14s %12s\n", "round", "ns/delivery", "us/message", "delivered");
+    for (std::size_t round : {std::size_t(1), std::size_t(16)}) {
+        std::string batch;
+        for (std::size_t i = 0; i < round; ++i) batch += line;
+        clock_type::duration busy{};
+        std::size_t delivered = 0;
+        for (std::size_t sent = 0; sent < messages; sent += round) {
+            sender.write(batch);
+            auto t0 = clock_type::now();
+            h.settle();
+            busy += clock_type::now() - t0;
+            for (auto& p : h.peers)
+                delivered += lines_from(p.take(), "[sender] ").size();
+        }
+        double ns = std::chrono::duration<double, std::nano>(busy).count();
+        std::size_t sent = (messages + round - 1) / round * round;
+        std::printf("%8zu %14.1f %14.1f %12zu\n", round, ns / double(sent * members),
+                    ns / 1e3 / double(sent), delivered);
+        check(delivered == sent * members, "fan‑out: every message reached every member");
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t members  = argc > 1 ? std::stoul(argv[1]) : 5000;
+    std::size_t messages = argc > 2 ? std::stoul(argv[2]) : 256;
+    std::size_t body     = argc > 3 ? std::stoul(argv[3]) : 64;
+
+    logging::Config quiet;
+    quiet.level = logging::Level::error;
+    logging::Logger::instance().configure(quiet);
+
+    std::printf("checks\n");
+    check_order();
+    check_disconnect();
+    check_stop();
+    check_threaded_stop();
+    check_quiet_text_client();
+    check_one_line();
+    check_sequenced_threaded();
+    check_resume_threaded();
+    std::printf("\n");
+    fan_out(members, messages, body);
+
+    if (failures) {
+        std::printf("FAIL: %d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("OK: all checks passed\n");
+}
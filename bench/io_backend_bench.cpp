@@ -0,0 +1,173 @@
+//──────────────────────────────────────────────────────────────────────────────
+// io_backend_bench.cpp ― epoll vs io_uring under small‑message fan‑out
+//
+//   • Starts one single‑shard Server in this process, built on whichever
+//     Asio backend chat_core was configured with (CHAT_USE_IO_URING)
+//   • R receivers sit in the lobby, read by one plain epoll loop
+//     (EpollReceivers.hpp), so the measuring side is the same for both
+//     backends
+//   • One sender sends M timestamped messages at a fixed rate; every
+//     delivery records send → receive latency
+//   • Reports, for the server thread alone:
+//       syscalls / message   perf counter on raw_syscalls:sys_enter
+//                            (needs tracefs and perf_event_paranoid ≤ 1 or
+//                            CAP_PERFMON; otherwise "n/a" – use
+//                            `strace -c -f` or `perf stat` instead)
+//       CPU / message        the thread's CPU clock
+//     and delivery latency p50 / p99 / p999 / max
+//
+// To compare, configure two build trees, -DCHAT_USE_IO_URING=OFF and =ON,
+// and run the same command line in each.
+//
+// Usage: bench_io_backend [receivers] [messages] [rate_per_s] [body_bytes] [port]
+//──────────────────────────────────────────────────────────────────────────────
+#include "../include/Logger.hpp"
+#include "../include/Server.hpp"
+#include "EpollReceivers.hpp"
+#include <boost/asio.hpp>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace net = boost::asio;
+using     tcp = net::ip::tcp;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+/// Counts system calls made by thread @p tid; -1 if the kernel won't let us.
+int open_syscall_counter(pid_t tid)
+{
+    for (const char* path : {"/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+                             "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"}) {
+        std::ifstream in(path);
+        unsigned long long id = 0;
+        if (!(in >> id))
+            continue;
+        perf_event_attr attr{};
+        attr.type   = PERF_TYPE_TRACEPOINT;
+        attr.size   = sizeof attr;
+        attr.config = id;
+        return static_cast<int>(::syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0));
+    }
+    return -1;
+}
+
+std::uint64_t read_counter(int fd)
+{
+    std::uint64_t v = 0;
+    if (fd < 0 || ::read(fd, &v, sizeof v) != static_cast<ssize_t>(sizeof v))
+        return 0;
+    return v;
+}
+
+std::uint64_t cpu_ns(clockid_t clock)
+{
+    timespec ts{};
+    ::clock_gettime(clock, &ts);
+    return std::uint64_t(ts.tv_sec) * 1'000'000'000u + std::uint64_t(ts.tv_nsec);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t    receivers = argc > 1 ? std::stoul(argv[1]) : 500;
+    std::size_t    messages  = argc > 2 ? std::stoul(argv[2]) : 2000;
+    double         rate      = argc > 3 ? std::stod(argv[3])  : 500;
+    std::size_t    body      = argc > 4 ? std::stoul(argv[4]) : 64;
+    unsigned short port      = argc > 5 ? static_cast<unsigned short>(std::stoi(argv[5])) : 17100;
+
+    logging::Config quiet;
+    quiet.level = logging::Level::warn;
+    logging::Logger::instance().configure(quiet);
+
+    ServerConfig cfg;
+    cfg.port             = port;
+    cfg.threads          = 1;     // one server thread: its counters are the whole server
+    cfg.history_messages = 0;
+    cfg.resume_seconds   = 0;
+    cfg.outbox.session_bytes = 64u << 20;
+
+    net::io_context server_io;
+    Server          server(server_io, cfg);
+    std::atomic<pid_t>     server_tid{0};
+    std::atomic<clockid_t> server_clock{};
+    std::thread server_thread([&] {
+        clockid_t c;
+        pthread_getcpuclockid(pthread_self(), &c);
+        server_clock = c;
+        server_tid   = static_cast<pid_t>(::syscall(SYS_gettid));
+        server.run();
+    });
+    while (!server_tid) std::this_thread::yield();
+
+    net::io_context io;
+    EpollReceivers rx(io, port, receivers);
+    tcp::socket sender(io);
+    sender.connect({net::ip::address_v4::loopback(), port});
+    sender.set_option(tcp::no_delay(true));
+    net::write(sender, net::buffer(std::string("sender\n")));
+
+    const std::string pad(body > 20 ? body - 20 : 0, 'x');
+    auto send_one = [&] {
+        std::string line = pad + ' ' + std::to_string(now_ns()) + '\n';
+        net::write(sender, net::buffer(line));
+    };
+    auto wait_for = [&](std::uint64_t target) {
+        auto give_up = clock_type::now() + std::chrono::seconds(30);
+        while (rx.stamped() < target && clock_type::now() < give_up)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    };
+
+    // warm‑up: every receiver joined and buffers grown
+    for (int i = 0; i < 50; ++i) send_one();
+    wait_for(50 * receivers);
+
+    int sys_fd = open_syscall_counter(server_tid);
+    std::uint64_t sys0 = read_counter(sys_fd);
+    std::uint64_t cpu0 = cpu_ns(server_clock);
+    std::uint64_t base = rx.stamped();
+    rx.measure();
+
+    auto start = clock_type::now();
+    for (std::size_t i = 0; i < messages; ++i) {
+        std::this_thread::sleep_until(start + std::chrono::duration_cast<clock_type::duration>(
+                                                  std::chrono::duration<double>(double(i) / rate)));
+        send_one();
+    }
+    wait_for(base + messages * receivers);
+
+    std::uint64_t cpu  = cpu_ns(server_clock) - cpu0;
+    std::uint64_t sys  = read_counter(sys_fd) - sys0;
+    std::uint64_t got  = rx.stamped() - base;
+    LatencyHistogram h = rx.take();
+
+    std::printf("backend %s: %zu receivers, %zu messages of %zu B at %.0f/s, %llu deliveries\n",
+                Server::io_backend(), receivers, messages, body, rate,
+                static_cast<unsigned long long>(got));
+    if (sys_fd >= 0)
+        std::printf("  server syscalls / message : %9.1f  (%.3f per delivery)\n",
+                    double(sys) / double(messages), double(sys) / double(got ? got : 1));
+    else
+        std::printf("  server syscalls / message :       n/a  (no access to raw_syscalls tracepoint)\n");
+    std::printf("  server CPU / message      : %9.1f us (%.0f ns per delivery)\n",
+                double(cpu) / double(messages) / 1e3, double(cpu) / double(got ? got : 1));
+    std::printf("  delivery latency          : p50 %.1f us  p99 %.1f us  p999 %.1f us  max %.1f us\n",
+                h.percentile(0.50) / 1e3, h.percentile(0.99) / 1e3,
+                h.percentile(0.999) / 1e3, h.max() / 1e3);
+
+    if (sys_fd >= 0) ::close(sys_fd);
+    boost::system::error_code ignored;
+    sender.close(ignored);
+    server.stop();
+    server_thread.join();
+}
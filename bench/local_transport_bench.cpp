@@ -0,0 +1,202 @@
+//──────────────────────────────────────────────────────────────────────────────
+// local_transport_bench.cpp ― a co‑located publisher over TCP, AF_UNIX, shm
+//
+//   • One single‑shard Server in this process listening on loopback TCP,
+//     an AF_UNIX socket and a shared‑memory handshake socket; one receiver
+//     in the lobby over TCP, read by an epoll loop (EpollReceivers.hpp), so
+//     only the publisher's leg differs between runs
+//   • The publisher sends one timestamped line per write, three ways:
+//       tcp    loopback TCP, TCP_NODELAY
+//       unix   AF_UNIX stream socket (LocalTransport)
+//       shm    ShmPublisher: the bytes go through a shared ring, no
+//              syscall per message while the server keeps up
+//     and a thread drains the server's echoes to it, as a bot must
+//   • Throughput: M lines as fast as the publisher can write them; reports
+//     lines per second received end to end and the publisher thread's
+//     CPU time per line
+//   • Latency: R lines per second for D seconds; send → receive p50 / p99
+//
+// Usage: bench_local_transport [messages] [rate_per_s] [seconds] [port]
+//──────────────────────────────────────────────────────────────────────────────
+#include "../include/Logger.hpp"
+#include "../include/Server.hpp"
+#include "../include/ShmTransport.hpp"
+#include "EpollReceivers.hpp"
+#include <boost/asio.hpp>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace net = boost::asio;
+using     tcp = net::ip::tcp;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+enum class Kind { tcp, unix_socket, shm };
+
+struct Result {
+    double           msgs_per_s = 0;
+    double           cpu_ns     = 0;   ///< publisher thread CPU per line
+    LatencyHistogram latency;
+    bool             complete   = true;
+};
+
+std::uint64_t thread_cpu_ns()
+{
+    timespec ts{};
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return std::uint64_t(ts.tv_sec) * 1000000000u + std::uint64_t(ts.tv_nsec);
+}
+
+/// A blocking publisher of any kind, plus the thread draining its replies.
+class Publisher
+{
+public:
+    Publisher(Kind kind, net::io_context& io, unsigned short port, const std::string& unix_path,
+              const std::string& shm_path)
+        : tcp_(io), local_(io)
+    {
+        int fd = -1;
+        switch (kind) {
+        case Kind::tcp:
+            tcp_.connect({net::ip::address_v4::loopback(), port});
+            tcp_.set_option(tcp::no_delay(true));
+            fd     = tcp_.native_handle();
+            write_ = [this](std::string_view s) { net::write(tcp_, net::buffer(s)); return true; };
+            break;
+        case Kind::unix_socket:
+            local_.connect(net::local::stream_protocol::endpoint(unix_path));
+            fd     = local_.native_handle();
+            write_ = [this](std::string_view s) { net::write(local_, net::buffer(s)); return true; };
+            break;
+        case Kind::shm:
+            shm_   = std::make_unique<ShmPublisher>(shm_path);
+            fd     = shm_->reply_fd();
+            write_ = [this](std::string_view s) { return shm_->write(s); };
+            break;
+        }
+        drain_ = std::thread([this, fd] {
+            char chunk[64 * 1024];
+            pollfd p{fd, POLLIN, 0};
+            while (!stop_)
+                if (::poll(&p, 1, 20) > 0 && ::read(fd, chunk, sizeof chunk) <= 0)
+                    break;
+        });
+        write_("pub\n");
+    }
+
+    ~Publisher()
+    {
+        stop_ = true;
+        drain_.join();
+    }
+
+    bool write(std::string_view s) { return write_(s); }
+
+private:
+    tcp::socket                              tcp_;
+    net::local::stream_protocol::socket      local_;
+    std::unique_ptr<ShmPublisher>            shm_;
+    std::function<bool(std::string_view)>    write_;
+    std::atomic<bool>                        stop_{false};
+    std::thread                              drain_;
+};
+
+Result run(Kind kind, std::size_t messages, double rate, double seconds, unsigned short port)
+{
+    const std::string base = "/tmp/chat_bench_" + std::to_string(::getpid());
+    ServerConfig cfg;
+    cfg.port             = port;
+    cfg.threads          = 1;
+    cfg.history_messages = 0;
+    cfg.resume_seconds   = 0;
+    cfg.unix_path        = base + ".sock";
+    cfg.shm_path         = base + ".shm";
+    cfg.outbox.session_bytes = 256u << 20;   // the echoes queue while the publisher blasts
+
+    net::io_context server_io;
+    Server          server(server_io, cfg);
+    std::thread     server_thread([&] { server.run(); });
+
+    Result r;
+    {
+        net::io_context io;
+        EpollReceivers  rx(io, port, 1);
+        Publisher       pub(kind, io, port, cfg.unix_path, cfg.shm_path);
+
+        auto wait_for = [&](std::uint64_t target) {
+            auto give_up = clock_type::now() + std::chrono::seconds(60);
+            while (rx.stamped() < target && clock_type::now() < give_up)
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            return rx.stamped() >= target;
+        };
+        std::string line;
+        auto send = [&] {
+            line = std::to_string(now_ns()) + '\n';
+            return pub.write(line);
+        };
+        for (int i = 0; i < 100; ++i) send();      // warm‑up
+        r.complete = wait_for(100);
+
+        // throughput
+        std::uint64_t stamped0 = rx.stamped();
+        auto start = clock_type::now();
+        std::uint64_t cpu0 = thread_cpu_ns();
+        for (std::size_t i = 0; i < messages; ++i)
+            send();
+        r.cpu_ns = double(thread_cpu_ns() - cpu0) / double(messages);
+        r.complete = wait_for(stamped0 + messages) && r.complete;
+        r.msgs_per_s = double(messages) /
+                       std::chrono::duration<double>(clock_type::now() - start).count();
+
+        // latency at a fixed rate
+        stamped0 = rx.stamped();
+        rx.measure();
+        start = clock_type::now();
+        auto sent = static_cast<std::size_t>(rate * seconds);
+        for (std::size_t i = 0; i < sent; ++i) {
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<clock_type::duration>(
+                                                      std::chrono::duration<double>(double(i) / rate)));
+            send();
+        }
+        r.complete = wait_for(stamped0 + sent) && r.complete;
+        r.latency  = rx.take();
+    }
+    server.stop();
+    server_thread.join();
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t    messages = argc > 1 ? std::stoul(argv[1]) : 500000;
+    double         rate     = argc > 2 ? std::stod(argv[2])  : 5000;
+    double         seconds  = argc > 3 ? std::stod(argv[3])  : 2;
+    unsigned short port     = argc > 4 ? static_cast<unsigned short>(std::stoi(argv[4])) : 17400;
+
+    logging::Config quiet;
+    quiet.level = logging::Level::warn;
+    logging::Logger::instance().configure(quiet);
+
+    std::printf("throughput: %zu lines as fast as possible; latency: %.0f lines/s for %.1f s\n",
+                messages, rate, seconds);
+    std::printf("%6s %12s %14s %10s %10s\n", "leg", "lines/s", "pub CPU ns", "p50 us", "p99 us");
+    const std::pair<Kind, const char*> kinds[] = {
+        {Kind::tcp, "tcp"}, {Kind::unix_socket, "unix"}, {Kind::shm, "shm"}};
+    for (auto [kind, name] : kinds) {
+        Result r = run(kind, messages, rate, seconds, port++);
+        std::printf("%6s %12.0f %14.1f %10.1f %10.1f%s\n", name, r.msgs_per_s, r.cpu_ns,
+                    r.latency.percentile(0.50) / 1e3, r.latency.percentile(0.99) / 1e3,
+                    r.complete ? "" : "   (not every line arrived)");
+    }
+}
@@ -0,0 +1,146 @@
+//──────────────────────────────────────────────────────────────────────────────
+// log_bench.cpp ― MessageLog append throughput and cold‑start recovery time
+//
+//   • append   : W threads append records as fast as they can (the broadcast
+//                path's view of the log); reports appends/s until the last
+//                append returns and until the writer has made it durable
+//   • recover  : evicts the segments from the page cache, then opens the log
+//                and rebuilds per‑room MessageHistory windows from it, as
+//                chat_server does at startup
+//
+// chat_server drops appends once the writer is max_pending_bytes behind;
+// here a refused append is retried (after a yield) so the numbers are the
+// rate the writer can sustain. Retries are reported.
+//
+// Usage: bench_log [dir] [gigabytes] [body_bytes] [writers] [rooms]
+//──────────────────────────────────────────────────────────────────────────────
+#include "../include/History.hpp"
+#include "../include/MessageLog.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+double secs_since(clock_type::time_point t0)
+{
+    return std::chrono::duration<double>(clock_type::now() - t0).count();
+}
+
+/// Drop the log's (already synced) pages from the page cache.
+void evict(const std::string& dir)
+{
+    DIR* d = ::opendir(dir.c_str());
+    if (!d)
+        return;
+    while (dirent* e = ::readdir(d)) {
+        std::string path = dir + "/" + e->d_name;
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            continue;
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+    ::closedir(d);
+}
+
+void wipe(const std::string& dir)
+{
+    if (DIR* d = ::opendir(dir.c_str())) {
+        while (dirent* e = ::readdir(d))
+            if (e->d_name[0] != '.')
+                ::unlink((dir + "/" + e->d_name).c_str());
+        ::closedir(d);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string dir   = argc > 1 ? argv[1] : "/tmp/bench_log";
+    double gigabytes  = argc > 2 ? std::stod(argv[2]) : 2.0;
+    std::size_t body  = argc > 3 ? std::stoul(argv[3]) : 200;
+    unsigned writers  = argc > 4 ? static_cast<unsigned>(std::stoul(argv[4])) : 4;
+    unsigned rooms    = argc > 5 ? static_cast<unsigned>(std::stoul(argv[5])) : 64;
+
+    LogConfig cfg;
+    cfg.dir               = dir;
+    cfg.max_pending_bytes = 256u << 20;
+
+    std::string record = *make_message(std::string(body, 'x'));
+    std::vector<std::string> names;
+    for (unsigned r = 0; r < rooms; ++r)
+        names.push_back("room" + std::to_string(r));
+
+    std::size_t per_entry = MessageLog::kEntryOverhead + names[0].size() + record.size();
+    auto total = static_cast<std::uint64_t>(gigabytes * 1e9 / double(per_entry));
+    std::uint64_t per_writer = total / writers;
+
+    // ── append ──
+    wipe(dir);
+    double t_append = 0, t_durable = 0;
+    std::uint64_t appended = 0, dropped = 0;
+    {
+        auto log = std::make_unique<MessageLog>(cfg);
+        auto t0 = clock_type::now();
+        std::vector<std::thread> threads;
+        for (unsigned w = 0; w < writers; ++w)
+            threads.emplace_back([&, w] {
+                for (std::uint64_t i = 0; i < per_writer; ++i)
+                    while (!log->append(names[(i * writers + w) % rooms], record))
+                        std::this_thread::yield();
+            });
+        for (auto& t : threads) t.join();
+        t_append = secs_since(t0);
+        appended = log->stats().appended.get();
+        dropped  = log->stats().dropped.get();
+        log.reset();                                   // flush + fdatasync
+        t_durable = secs_since(t0);
+    }
+    double gb = double(appended) * double(per_entry) / 1e9;
+    std::printf("append   : %llu entries (%.2f GB, %zu B body) from %u threads, %llu retries\n",
+                static_cast<unsigned long long>(appended), gb, body, writers,
+                static_cast<unsigned long long>(dropped));
+    std::printf("           %.0f appends/s returned, %.0f appends/s durable (%.2f GB/s)\n",
+                double(appended) / t_append, double(appended) / t_durable, gb / t_durable);
+
+    // ── cold‑start recovery ──
+    evict(dir);
+    auto t0 = clock_type::now();
+    std::uint64_t replayed = 0;
+    {
+        MessageLog log(cfg);
+        std::vector<std::unique_ptr<std::pair<std::string, MessageHistory>>> owned;
+        std::unordered_map<std::string_view, MessageHistory*> hist;   // views into owned
+        replayed = log.replay([&](std::uint64_t, std::string_view room, std::string_view rec) {
+            auto it = hist.find(room);
+            if (it == hist.end()) {
+                owned.push_back(std::make_unique<std::pair<std::string, MessageHistory>>(
+                    std::piecewise_construct, std::forward_as_tuple(room),
+                    std::forward_as_tuple(200, 256u << 10)));
+                it = hist.emplace(owned.back()->first, &owned.back()->second).first;
+            }
+            it->second->append(rec);
+        });
+    }
+    double t_recover = secs_since(t0);
+    std::printf("recover  : %llu entries (%.2f GB) in %.2f s – %.2f GB/s, %.0f entries/s\n",
+                static_cast<unsigned long long>(replayed), gb, t_recover, gb / t_recover,
+                double(replayed) / t_recover);
+
+    wipe(dir);
+    ::rmdir(dir.c_str());
+}
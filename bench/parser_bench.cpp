@@ -0,0 +1,112 @@
+//──────────────────────────────────────────────────────────────────────────────
+// parser_bench.cpp ― inbound parsing cost: old streambuf path vs. flat buffer
+//
+//   • "streambuf" : what Session/Client used to do per message —
+//                   read_until('\n') into a net::streambuf, then
+//                   std::istream + std::getline into a fresh std::string
+//   • "text"      : wire::RecvBuffer + wire::next_line (string_view, no copy)
+//   • "framed"    : wire::RecvBuffer + wire::next_frame
+//
+// Input is fed in 16 KiB chunks, as async_read_some would deliver it.
+//
+// Usage: bench_parser [messages] [body_bytes]
+//──────────────────────────────────────────────────────────────────────────────
+#include "../include/Framing.hpp"
+#include "AllocCounter.hpp"
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <istream>
+#include <string>
+
+namespace net = boost::asio;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+constexpr std::size_t kChunk = 16 * 1024;
+
+struct Result { double secs; std::size_t msgs, bytes, allocs; };
+
+void report(const char* name, const Result& r)
+{
+    std::printf("%-10s %10.1f MB/s %8.1f ns/msg %8.2f allocs/msg\n", name,
+                r.bytes / r.secs / 1e6, r.secs * 1e9 / r.msgs,
+                double(r.allocs) / r.msgs);
+}
+
+template <class Body>
+Result timed(const std::string& input, Body&& body)
+{
+    auto a0 = alloc_counter::snapshot();
+    auto t0 = clock_type::now();
+    std::size_t msgs = body();
+    auto t1 = clock_type::now();
+    return {std::chrono::duration<double>(t1 - t0).count(), msgs, input.size(),
+            alloc_counter::since(a0).allocs};
+}
+
+std::size_t run_streambuf(const std::string& input)
+{
+    net::streambuf sb;
+    std::size_t msgs = 0, sink = 0;
+    for (std::size_t at = 0; at < input.size(); at += kChunk) {
+        std::size_t n = std::min(kChunk, input.size() - at);
+        auto dst = sb.prepare(n);
+        std::memcpy(dst.data(), input.data() + at, n);
+        sb.commit(n);
+        for (;;) {
+            auto data = sb.data();          // what read_until scans each call
+            auto b = net::buffers_begin(data), e = net::buffers_end(data);
+            if (std::find(b, e, '\n') == e)
+                break;
+            std::istream is(&sb);
+            std::string line;
+            std::getline(is, line);
+            sink += line.size();
+            ++msgs;
+        }
+    }
+    return msgs + (sink & 0);
+}
+
+std::size_t run_flat(const std::string& input, wire::Protocol proto)
+{
+    wire::RecvBuffer rb;
+    std::size_t msgs = 0, sink = 0;
+    std::string_view msg;
+    std::size_t used = 0;
+    for (std::size_t at = 0; at < input.size(); at += kChunk) {
+        std::size_t n = std::min(kChunk, input.size() - at);
+        std::memcpy(rb.prepare(n), input.data() + at, n);
+        rb.commit(n);
+        while (wire::next_message(proto, rb.data(), wire::kDefaultMaxBody, msg,
+                                  used) == wire::Parse::message) {
+            sink += msg.size();
+            rb.consume(used);
+            ++msgs;
+        }
+    }
+    return msgs + (sink & 0);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t messages = argc > 1 ? std::stoul(argv[1]) : 1'000'000;
+    std::size_t body_len = argc > 2 ? std::stoul(argv[2]) : 64;
+
+    std::string body(body_len, 'x');
+    std::string text, framed;
+    for (std::size_t i = 0; i < messages; ++i) {
+        wire::append_message(wire::Protocol::text,   text,   body);
+        wire::append_message(wire::Protocol::framed, framed, body);
+    }
+
+    std::printf("%zu messages, %zu‑byte bodies\n", messages, body_len);
+    report("streambuf", timed(text,   [&] { return run_streambuf(text); }));
+    report("text",      timed(text,   [&] { return run_flat(text, wire::Protocol::text); }));
+    report("framed",    timed(framed, [&] { return run_flat(framed, wire::Protocol::framed); }));
+}
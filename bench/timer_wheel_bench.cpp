@@ -0,0 +1,141 @@
+//──────────────────────────────────────────────────────────────────────────────
+// timer_wheel_bench.cpp ― deadline upkeep vs connection count
+//
+//   • Simulates N connections on one thread for T ticks of 100 ms; every
+//     connection reads once per R ticks (staggered), and must be pinged
+//     after 30 s and reaped after 90 s of silence – the server defaults
+//   • wheel  : one TimerWheel, entries re‑armed lazily as Session does –
+//              a read stores the tick, the entry moves when it fires
+//   • timers : one steady_timer per connection, re‑armed on every read
+//              (expires_after + async_wait, the cancelled wait completing
+//              through the io_context), the usual per‑socket approach
+//   • Reports wall time per tick and per read for N = 1k, 10k, 100k …
+//     up to max_connections; the wheel's cost per tick should follow the
+//     reads, not the connection count
+//
+// Usage: bench_timer_wheel [max_connections] [ticks] [ticks_between_reads]
+//──────────────────────────────────────────────────────────────────────────────
+#include "../include/TimerWheel.hpp"
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace net = boost::asio;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+constexpr TimerWheel::Tick kHeartbeat = 300;   // 30 s in 100 ms ticks
+constexpr TimerWheel::Tick kIdle      = 900;   // 90 s
+
+struct Result {
+    double        ns_per_tick = 0;
+    double        ns_per_read = 0;
+    std::uint64_t fired       = 0;   ///< wheel entries visited and due
+};
+
+/// Mirrors Session::arm_timer / on_timer for a named session.
+struct WheelConn {
+    TimerWheel*       wheel = nullptr;
+    TimerWheel::Entry entry{[this] { on_timer(); }};
+    TimerWheel::Tick  last_in = 0, last_ping = 0;
+    std::uint64_t     pings = 0, reaped = 0;
+
+    void arm()
+    {
+        wheel->schedule(entry, std::min(last_in + kIdle, std::max(last_in, last_ping) + kHeartbeat));
+    }
+    void on_timer()
+    {
+        TimerWheel::Tick now = wheel->now();
+        if (now >= last_in + kIdle) {
+            ++reaped;
+            return;
+        }
+        if (now >= std::max(last_in, last_ping) + kHeartbeat) {
+            ++pings;
+            last_ping = now;
+        }
+        arm();
+    }
+};
+
+Result run_wheel(std::size_t n, std::size_t ticks, std::size_t every)
+{
+    TimerWheel wheel;
+    std::vector<std::unique_ptr<WheelConn>> conns(n);
+    for (auto& c : conns) {
+        c = std::make_unique<WheelConn>();
+        c->wheel = &wheel;
+        c->arm();
+    }
+
+    std::uint64_t reads = 0, fired = 0;
+    auto t0 = clock_type::now();
+    for (std::size_t t = 0; t < ticks; ++t) {
+        for (std::size_t i = (every - t % every) % every; i < n; i += every) {
+            conns[i]->last_in = wheel.now();       // what a read costs
+            ++reads;
+        }
+        fired += wheel.advance();
+    }
+    double ns = std::chrono::duration<double, std::nano>(clock_type::now() - t0).count();
+    return {ns / double(ticks), reads ? ns / double(reads) : 0, fired};
+}
+
+Result run_timers(std::size_t n, std::size_t ticks, std::size_t every)
+{
+    net::io_context io(1);
+    std::vector<std::unique_ptr<net::steady_timer>> timers(n);
+    std::uint64_t expired = 0;
+    auto arm = [&](net::steady_timer& t) {
+        t.expires_after(std::chrono::milliseconds(100 * kHeartbeat));
+        t.async_wait([&expired](const boost::system::error_code& ec) {
+            if (!ec)
+                ++expired;
+        });
+    };
+    for (auto& t : timers) {
+        t = std::make_unique<net::steady_timer>(io);
+        arm(*t);
+    }
+
+    std::uint64_t reads = 0;
+    auto t0 = clock_type::now();
+    for (std::size_t t = 0; t < ticks; ++t) {
+        for (std::size_t i = (every - t % every) % every; i < n; i += every) {
+            arm(*timers[i]);                        // cancel + re‑arm per read
+            ++reads;
+        }
+        io.poll();                                  // run the cancelled waits
+    }
+    double ns = std::chrono::duration<double, std::nano>(clock_type::now() - t0).count();
+    for (auto& t : timers) t->cancel();
+    io.poll();
+    return {ns / double(ticks), reads ? ns / double(reads) : 0, expired};
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t max_conns = argc > 1 ? std::stoul(argv[1]) : 100000;
+    std::size_t ticks     = argc > 2 ? std::stoul(argv[2]) : 600;
+    std::size_t every     = argc > 3 ? std::max<std::size_t>(1, std::stoul(argv[3])) : 10;
+
+    std::printf("%zu ticks (%.0f s simulated), one read per connection every %zu ticks\n",
+                ticks, double(ticks) / 10, every);
+    std::printf("%12s  %14s %12s %10s  %14s %12s\n", "connections",
+                "wheel ns/tick", "ns/read", "fired", "timers ns/tick", "ns/read");
+    for (std::size_t n = 1000; n <= max_conns; n *= 10) {
+        Result w = run_wheel(n, ticks, every);
+        Result s = run_timers(n, ticks, every);
+        std::printf("%12zu  %14.0f %12.1f %10llu  %14.0f %12.1f\n", n,
+                    w.ns_per_tick, w.ns_per_read, static_cast<unsigned long long>(w.fired),
+                    s.ns_per_tick, s.ns_per_read);
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// AdminEndpoint.hpp ― minimal HTTP endpoint for scraping metrics
+//
+//   • Listens on 127.0.0.1 only; any request gets the current exposition
+//   • One response per connection (HTTP/1.0 semantics), then close
+//   • Runs on the io_context it is given – the server uses shard 0
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <boost/asio.hpp>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace net = boost::asio;
+using     tcp = net::ip::tcp;
+
+class AdminEndpoint
+{
+public:
+    /// Produces the response body (Prometheus text) on each scrape.
+    using Render = std::function<std::string()>;
+
+    AdminEndpoint(net::io_context& io, unsigned short port, Render render);
+
+private:
+    void do_accept();
+    void serve(std::shared_ptr<tcp::socket> sock);
+
+    tcp::acceptor acceptor_;
+    Render        render_;
+};
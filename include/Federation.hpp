@@ -0,0 +1,129 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// Federation.hpp ― relays room broadcasts between chat_server instances
+//
+//   • Each node accepts peer links on its federation port and dials the
+//     peers it was given, redialling once a second while they are down
+//   • A link is a stream of frames ([u32 len][body], Framing.hpp) whose
+//     first body byte says what it is:
+//         H  hello     [node id]
+//         M  message   [origin][u64 epoch][u64 seq][u8 room_len][room][text]
+//         P  presence  [origin][u64 epoch][u64 seq][u8 room_len][room][u32 members]
+//     origin is [u8 len][node id]; epoch is the origin's start time, so a
+//     restarted node's numbering supersedes the old one
+//   • Every node numbers what it publishes. A frame is accepted once per
+//     (origin, seq) – from whichever link brings it first – handed to the
+//     server and forwarded on every other link, so any connected topology
+//     works and redundant links only cost bandwidth. Links are FIFO, so an
+//     origin's frames are accepted in the order it published them
+//   • Presence is each node's member count per room, sent when it changes
+//     and refreshed every few seconds; counts from silent nodes expire
+//   • Everything except publish() and remote_members() runs on the
+//     io_context it is given – the server uses shard 0
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Metrics.hpp"
+#include "ServerConfig.hpp"
+
+namespace net = boost::asio;
+using     tcp = net::ip::tcp;
+
+class Federation
+{
+public:
+    /// A message another node published to @p room.
+    using Deliver  = std::function<void(std::string_view room, std::string_view text)>;
+    /// This node's member count per room (rooms without members may be left out).
+    using Presence = std::function<std::vector<std::pair<std::string, std::uint32_t>>()>;
+
+    struct Stats {
+        metrics::Gauge   links;        ///< links up (hello exchanged or not)
+        metrics::Counter published;    ///< local messages sent to peers
+        metrics::Counter received;     ///< remote messages delivered locally
+        metrics::Counter duplicates;   ///< frames already seen via another link
+        metrics::Counter forwarded;    ///< frames passed on to other links
+        metrics::Counter link_drops;   ///< links closed by error or backlog
+    };
+
+    /// @param node_id  this node's name on the links; must be unique
+    Federation(net::io_context& io, const FederationConfig& cfg, std::string node_id,
+               Deliver deliver, Presence presence);
+    ~Federation();
+
+    Federation(const Federation&)            = delete;
+    Federation& operator=(const Federation&) = delete;
+
+    /// Send one local room message to every peer. Thread‑safe; messages
+    /// are numbered in call order, so callers serialise per room.
+    void publish(std::string_view room, std::string_view text);
+
+    /// Members per room on all other nodes. Thread‑safe.
+    std::unordered_map<std::string, std::uint32_t> remote_members() const;
+
+    const std::string& node_id() const { return node_id_; }
+    const Stats&       stats()   const { return stats_; }
+
+private:
+    class Link;
+    using Clock = std::chrono::steady_clock;
+
+    struct Seen { std::uint64_t epoch = 0, seq = 0; };
+    struct NodePresence {
+        Clock::time_point                              heard;
+        std::unordered_map<std::string, std::uint32_t> rooms;
+    };
+
+    void do_accept();
+    void dial(const std::string& peer);
+    void redial(const std::string& peer);
+    void add_link(tcp::socket socket, std::string dialled);
+    void on_link_closed(Link& link);
+    void on_frame(Link& from, std::string_view body);
+
+    void numbered(char type, std::string_view room, std::string_view tail);
+    void flush();
+    void schedule_presence();
+    void send_presence();
+
+    net::io_context&                 io_;
+    const FederationConfig           cfg_;
+    const std::string                node_id_;
+    const std::uint64_t              epoch_;
+    Deliver                          deliver_;
+    Presence                         presence_;
+
+    std::unique_ptr<tcp::acceptor>   acceptor_;       ///< null unless cfg.port
+    std::vector<std::shared_ptr<Link>> links_;        ///< io thread only
+    std::atomic<std::size_t>         live_links_{0};  ///< lets publish() skip work with no peers
+    bool                             stopping_ = false;
+
+    // frames numbered by any thread, handed to the links on the io thread
+    std::mutex                       out_mtx_;
+    std::string                      outbox_;
+    std::uint64_t                    seq_ = 0;
+    bool                             flush_posted_ = false;
+    std::string                      batch_;          ///< io thread only
+
+    std::unordered_map<std::string, Seen> seen_;      ///< per origin; io thread only
+
+    net::steady_timer                presence_timer_;
+    unsigned                         presence_ticks_ = 0;
+    std::unordered_map<std::string, std::uint32_t> presence_sent_;  ///< io thread only
+    mutable std::mutex               remote_mtx_;
+    std::unordered_map<std::string, NodePresence> remote_;           ///< by origin node
+
+    Stats                            stats_;
+};
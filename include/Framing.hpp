@@ -0,0 +1,203 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// Framing.hpp ― wire protocols shared by Session and Client
+//
+//   • text      : one message per line, terminated by '\n' (the original protocol)
+//   • framed    : [u32 big‑endian length][body], body may hold '\n' or binary
+//                 (the server folds CR / LF in what it relays to spaces, so
+//                 text clients still see one line per message)
+//   • sequenced : framed, but every server→client frame is preceded by the
+//                 message's u64 sequence number within its room (0 for
+//                 server notices); what a client needs to resume a session
+//
+// A client opts into framing by sending kFrameHello (or kSeqHello) as its
+// very first line; from then on both directions use frames. Anything else
+// is a text client.
+//
+//   • RecvBuffer  → flat receive buffer, filled by async_read_some
+//   • next_line / next_frame → zero‑copy parsers returning string_views
+//     into that buffer; both enforce a maximum message size so a peer can't
+//     make us buffer without bound
+//
+// Header‑only: everything here is a few lines and sits on the hot path.
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace wire {
+
+enum class Protocol { text, framed, sequenced };
+
+/// First line a framing‑capable client sends instead of its name.
+inline constexpr std::string_view kFrameHello = "/proto frame";
+/// … or this, to also receive sequence numbers.
+inline constexpr std::string_view kSeqHello   = "/proto seq";
+
+/// Heartbeat: the server pings a client that has gone quiet and the client
+/// answers; either side answers a ping it receives. Neither is shown or
+/// broadcast.
+inline constexpr std::string_view kPing = "/ping";
+inline constexpr std::string_view kPong = "/pong";
+
+inline constexpr std::size_t kHeaderSize     = 4;
+inline constexpr std::size_t kSeqSize        = 8;
+inline constexpr std::size_t kDefaultMaxBody = 64 * 1024;
+
+inline void put_u32(char* out, std::uint32_t v)
+{
+    out[0] = static_cast<char>(v >> 24);
+    out[1] = static_cast<char>(v >> 16);
+    out[2] = static_cast<char>(v >> 8);
+    out[3] = static_cast<char>(v);
+}
+
+inline std::uint32_t get_u32(const char* in)
+{
+    auto b = reinterpret_cast<const unsigned char*>(in);
+    return std::uint32_t(b[0]) << 24 | std::uint32_t(b[1]) << 16 |
+           std::uint32_t(b[2]) << 8  | std::uint32_t(b[3]);
+}
+
+inline void put_u64(char* out, std::uint64_t v)
+{
+    put_u32(out, static_cast<std::uint32_t>(v >> 32));
+    put_u32(out + 4, static_cast<std::uint32_t>(v));
+}
+
+inline std::uint64_t get_u64(const char* in)
+{
+    return std::uint64_t(get_u32(in)) << 32 | get_u32(in + 4);
+}
+
+/// Outcome of one parse attempt.
+enum class Parse {
+    message,    ///< @p msg is valid, @p used bytes may be consumed
+    need_more,  ///< incomplete; read more and retry
+    too_large,  ///< peer exceeded the maximum – drop the connection
+};
+
+/**
+ * @brief  Extract one '\n'‑terminated line (without the '\n').
+ *
+ * A line longer than @p max_body is rejected as soon as that many bytes
+ * are buffered, without waiting for its terminator.
+ */
+inline Parse next_line(std::string_view in, std::size_t max_body,
+                       std::string_view& msg, std::size_t& used)
+{
+    std::size_t end = in.find('\n');
+    if (end == std::string_view::npos)
+        return in.size() > max_body ? Parse::too_large : Parse::need_more;
+    if (end > max_body)
+        return Parse::too_large;
+    msg  = in.substr(0, end);
+    used = end + 1;
+    return Parse::message;
+}
+
+/// Extract one length‑prefixed frame body.
+inline Parse next_frame(std::string_view in, std::size_t max_body,
+                        std::string_view& msg, std::size_t& used)
+{
+    if (in.size() < kHeaderSize)
+        return Parse::need_more;
+    std::size_t len = get_u32(in.data());
+    if (len > max_body)
+        return Parse::too_large;
+    if (in.size() < kHeaderSize + len)
+        return Parse::need_more;
+    msg  = in.substr(kHeaderSize, len);
+    used = kHeaderSize + len;
+    return Parse::message;
+}
+
+/// Extract one client→server message; sequenced clients send plain frames.
+inline Parse next_message(Protocol p, std::string_view in, std::size_t max_body,
+                          std::string_view& msg, std::size_t& used)
+{
+    return p == Protocol::text ? next_line (in, max_body, msg, used)
+                               : next_frame(in, max_body, msg, used);
+}
+
+/// Extract one server→client sequenced frame.
+inline Parse next_sequenced(std::string_view in, std::size_t max_body,
+                            std::uint64_t& seq, std::string_view& msg, std::size_t& used)
+{
+    if (in.size() < kSeqSize)
+        return Parse::need_more;
+    Parse r = next_frame(in.substr(kSeqSize), max_body, msg, used);
+    if (r == Parse::message) {
+        seq   = get_u64(in.data());
+        used += kSeqSize;
+    }
+    return r;
+}
+
+/**
+ * @brief  Flat, growable receive buffer.
+ *
+ * Bytes are appended at the back and consumed from the front; the live
+ * region is slid back to offset 0 only when more room is needed, so
+ * parsed messages can be handed out as views without copying.
+ */
+class RecvBuffer
+{
+public:
+    /// Writable space for at least @p n bytes; follow with commit().
+    char* prepare(std::size_t n)
+    {
+        if (buf_.size() - end_ < n) {
+            if (begin_) {                       // reclaim consumed prefix
+                std::memmove(buf_.data(), buf_.data() + begin_, end_ - begin_);
+                end_  -= begin_;
+                begin_ = 0;
+            }
+            if (buf_.size() - end_ < n)
+                buf_.resize(end_ + n);
+        }
+        return buf_.data() + end_;
+    }
+
+    void commit(std::size_t n)  { end_ += n; }
+
+    void consume(std::size_t n)
+    {
+        begin_ += n;
+        if (begin_ == end_)
+            begin_ = end_ = 0;                  // cheap reset when drained
+    }
+
+    std::string_view data() const { return {buf_.data() + begin_, end_ - begin_}; }
+
+private:
+    std::vector<char> buf_;
+    std::size_t       begin_ = 0;
+    std::size_t       end_   = 0;
+};
+
+/**
+ * @brief  Encode one message for @p p into a caller‑owned string.
+ *
+ * Used by the client, which writes its own messages; the server shares
+ * pre‑encoded Payload records instead (see Payload.hpp).
+ */
+inline void append_message(Protocol p, std::string& out, std::string_view body)
+{
+    if (p != Protocol::text) {
+        char hdr[kHeaderSize];
+        put_u32(hdr, static_cast<std::uint32_t>(body.size()));
+        out.append(hdr, kHeaderSize);
+        out.append(body);
+    } else {
+        out.append(body);
+        out += '\n';
+    }
+}
+
+} // namespace wire
@@ -0,0 +1,102 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// HandlerMemory.hpp ― recycled storage for asynchronous operation state
+//
+//   • Asio allocates every pending operation (socket op + our completion
+//     handler) through the handler's associated allocator
+//   • A HandlerMemory is one fixed block owned by whoever issues the
+//     operation – e.g. one for a session's read, one for its write; since
+//     only one such operation is ever outstanding, the block is reused by
+//     every read (or write) for the object's whole life
+//   • bind_memory(mem, handler) attaches the block to a handler; anything
+//     too large, or a second concurrent operation, falls back to the heap
+//
+// The block may be taken on one thread and given back on another (a post
+// to another shard), but only one operation may use it at a time – a
+// second one just gets heap memory.
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+class HandlerMemory
+{
+public:
+    static constexpr std::size_t kSize = 512;
+
+    HandlerMemory() = default;
+    HandlerMemory(const HandlerMemory&)            = delete;
+    HandlerMemory& operator=(const HandlerMemory&) = delete;
+
+    void* allocate(std::size_t size)
+    {
+        if (size <= kSize && !in_use_.exchange(true, std::memory_order_acquire))
+            return &storage_;
+        return ::operator new(size);
+    }
+
+    void deallocate(void* p)
+    {
+        if (p == &storage_)
+            in_use_.store(false, std::memory_order_release);
+        else
+            ::operator delete(p);
+    }
+
+private:
+    std::aligned_storage_t<kSize, alignof(std::max_align_t)> storage_;
+    std::atomic<bool> in_use_{false};
+};
+
+/// Minimal allocator over a HandlerMemory, as Asio's associated allocator.
+template <class T>
+class HandlerAllocator
+{
+public:
+    using value_type = T;
+
+    explicit HandlerAllocator(HandlerMemory& mem) noexcept : mem_(&mem) {}
+    template <class U>
+    HandlerAllocator(const HandlerAllocator<U>& other) noexcept : mem_(other.mem_) {}
+
+    T*   allocate(std::size_t n)          { return static_cast<T*>(mem_->allocate(sizeof(T) * n)); }
+    void deallocate(T* p, std::size_t)    { mem_->deallocate(p); }
+
+    template <class U>
+    bool operator==(const HandlerAllocator<U>& o) const noexcept { return mem_ == o.mem_; }
+    template <class U>
+    bool operator!=(const HandlerAllocator<U>& o) const noexcept { return mem_ != o.mem_; }
+
+private:
+    template <class> friend class HandlerAllocator;
+    HandlerMemory* mem_;
+};
+
+/// A completion handler that tells Asio to use a HandlerMemory.
+template <class Handler>
+class MemoryBoundHandler
+{
+public:
+    using allocator_type = HandlerAllocator<Handler>;
+
+    MemoryBoundHandler(HandlerMemory& mem, Handler h) : mem_(mem), handler_(std::move(h)) {}
+
+    allocator_type get_allocator() const noexcept { return allocator_type(mem_); }
+
+    template <class... Args>
+    void operator()(Args&&... args) { handler_(std::forward<Args>(args)...); }
+
+private:
+    HandlerMemory& mem_;
+    Handler        handler_;
+};
+
+template <class Handler>
+MemoryBoundHandler<std::decay_t<Handler>> bind_memory(HandlerMemory& mem, Handler&& h)
+{
+    return {mem, std::forward<Handler>(h)};
+}
@@ -0,0 +1,84 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// Handoff.hpp ― hot upgrade: a running server hands everything to its successor
+//
+//   • The running server listens on ServerConfig::upgrade_path (AF_UNIX);
+//     a new chat_server started with --takeover PATH connects there
+//   • The old process stops accepting, freezes every session at a message
+//     boundary and sends the successor one State: its listening sockets,
+//     each client's socket and what the client was in the middle of –
+//     name, room, resume token, bytes read but not yet parsed, messages
+//     queued but not yet written – plus every room's sequence number and
+//     the resume tickets of clients that are away
+//   • Descriptors travel with SCM_RIGHTS, the rest as one serialized blob;
+//     the kernel keeps every connection open throughout, so clients see a
+//     pause, not a disconnect, and connection attempts meanwhile wait in
+//     the listen backlog
+//   • The old process then exits; the successor waits for that (eof on the
+//     upgrade socket) before it opens the message log or binds the admin
+//     and federation ports, and serves the inherited sockets from there
+//
+// Linux only (SCM_RIGHTS, MSG_CMSG_CLOEXEC).
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Framing.hpp"
+
+namespace handoff {
+
+/// One client, frozen between two messages.
+struct SessionState {
+    int              fd = -1;           ///< connected TCP or AF_UNIX socket
+    wire::Protocol   proto = wire::Protocol::text;
+    bool             named = false;     ///< past the handshake
+    std::string      name;
+    std::string      room;              ///< empty until named
+    std::string      token;             ///< resume ticket; empty unless sequenced
+    std::string      unread;            ///< received, not yet parsed
+    std::vector<std::string> outbox;    ///< queued Payload records, oldest first
+    std::size_t      front_offset = 0;  ///< wire bytes of outbox[0] already sent
+    std::vector<std::string> bulk;      ///< … and the bulk queue
+    std::size_t      bulk_offset = 0;
+};
+
+struct RoomState {
+    std::string      name;
+    std::uint64_t    last_seq = 0;
+};
+
+/// A sequenced client whose connection dropped and may still resume.
+struct TicketState {
+    std::string      token, name, room;
+    std::chrono::milliseconds remaining{0};  ///< of its resume window
+};
+
+struct State {
+    int tcp_listener  = -1;             ///< -1 = wasn't listening
+    int unix_listener = -1;
+    int shm_listener  = -1;
+    std::vector<RoomState>    rooms;
+    std::vector<SessionState> sessions;
+    std::vector<TicketState>  tickets;
+
+    /// Close every descriptor still held (after sending, or on failure).
+    void close_all();
+};
+
+/// Send @p state over the connected AF_UNIX socket @p sock; blocking.
+/// Throws std::system_error.
+void send(int sock, const State& state);
+
+/**
+ * Connect to the running server's upgrade socket at @p path, receive its
+ * State, and wait until that process has exited. Throws std::system_error,
+ * or std::runtime_error if what arrives doesn't parse – in which case the
+ * old server has already let its connections go.
+ */
+State take_over(const std::string& path);
+
+} // namespace handoff
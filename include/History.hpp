@@ -0,0 +1,64 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// History.hpp ― bounded chat backlog replayed to clients when they join
+//
+//   • Capped by message count *and* bytes, oldest messages evicted first
+//   • Messages are kept back‑to‑back in one flat buffer, already encoded
+//     as records (Payload.hpp), so a join never concatenates message by
+//     message and either protocol can send the snapshot as is
+//   • snapshot() hands out one shared Payload; it is rebuilt at most once
+//     per change, so a burst of joins between two messages shares it
+//   • since(seq) hands out only what followed a given sequence number, for
+//     clients resuming a session (records carry their seq, see Payload.hpp)
+//
+// Thread‑safe: every shard appends and snapshots through the same object.
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "Payload.hpp"
+
+class MessageHistory
+{
+public:
+    /// @param max_messages  keep at most this many messages
+    /// @param max_bytes     … and at most this many bytes in total
+    MessageHistory(std::size_t max_messages, std::size_t max_bytes);
+
+    /// Record a broadcast; messages larger than max_bytes are not kept.
+    void append(const Payload& msg);
+
+    /// Same, from encoded record bytes (used to rebuild from the log).
+    void append(std::string_view record);
+
+    /// The whole retained window as one buffer, or nullptr when empty.
+    /// Cost is bounded by max_bytes regardless of uptime.
+    Payload snapshot();
+
+    /// What a client that has seen everything up to @p seq is missing.
+    struct Delta {
+        Payload       records;   ///< retained messages after seq (nullptr if none)
+        std::uint64_t lost = 0;  ///< messages after seq already evicted
+    };
+    Delta since(std::uint64_t seq);
+
+    std::size_t size()  const;   ///< messages retained
+    std::size_t bytes() const;   ///< bytes retained
+
+private:
+    void evict_front();
+
+    const std::size_t       max_messages_;
+    const std::size_t       max_bytes_;
+
+    mutable std::mutex      mtx_;
+    std::string             buf_;        ///< window is [head_, buf_.size())
+    std::size_t             head_ = 0;   ///< start of the oldest retained message
+    std::deque<std::size_t> lengths_;    ///< retained message sizes, oldest first
+    Payload                 snapshot_;   ///< cached snapshot(); reset on append
+};
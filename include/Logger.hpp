@@ -0,0 +1,166 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// Logger.hpp ― asynchronous diagnostics log, off the io threads
+//
+//   • LOG_INFO("server", "Client ", id, " is named ", name) formats into a
+//     stack buffer (no allocation, no lock) and pushes one fixed‑size
+//     record into a bounded lock‑free ring (multi‑producer, one consumer)
+//   • A background thread drains the ring to a file or stdout, stamps each
+//     line "2025‑07‑23T12:34:56.789Z info  server  …" and flushes per batch
+//   • Full ring → the record is dropped and counted, never waited for;
+//     the writer reports drops as they happen
+//   • Every call site allows kBurst lines per second; repeats past that
+//     are suppressed and summarised on the site's next line
+//   • Levels below the configured one cost one relaxed load
+//
+// One process‑wide instance (Logger::instance()), configured by main()
+// before any threads start; used by the server side only – chat_client
+// keeps writing its UI straight to the terminal.
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+namespace logging {
+
+enum class Level : std::uint8_t { debug, info, warn, error };
+
+const char* to_string(Level l);
+bool        parse_level(std::string_view s, Level& out);
+
+struct Config {
+    std::string path;                 ///< empty = stdout
+    Level       level = Level::info;  ///< lower levels are discarded at the call site
+    std::size_t ring_slots = 16384;   ///< records buffered (rounded up to a power of two)
+};
+
+/// Bytes of text one record holds; longer lines are cut off.
+inline constexpr std::size_t kLineBytes = 224;
+/// Lines per call site per second before repeats are suppressed.
+inline constexpr std::uint32_t kBurst   = 20;
+
+/// A formatted line on its way into the ring.
+struct Line {
+    char        text[kLineBytes];
+    std::size_t len = 0;
+
+    void put(std::string_view s)
+    {
+        std::size_t n = std::min(s.size(), kLineBytes - len);
+        std::memcpy(text + len, s.data(), n);
+        len += n;
+    }
+    void put(const char* s)        { put(std::string_view(s)); }
+    void put(const std::string& s) { put(std::string_view(s)); }
+    void put(char c)               { if (len < kLineBytes) text[len++] = c; }
+    void put(bool b)               { put(b ? "true" : "false"); }
+    void put(double v)
+    {
+        char buf[32];
+        int n = std::snprintf(buf, sizeof buf, "%g", v);
+        put(std::string_view(buf, static_cast<std::size_t>(n)));
+    }
+    template <class T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    void put(T v)
+    {
+        char buf[24];
+        auto r = std::to_chars(buf, buf + sizeof buf, v);
+        put(std::string_view(buf, static_cast<std::size_t>(r.ptr - buf)));
+    }
+};
+
+/// Per call site rate limit (static at each LOG_* use).
+struct Site {
+    std::atomic<std::int64_t>  second{0};
+    std::atomic<std::uint32_t> count{0};
+    std::atomic<std::uint32_t> suppressed{0};
+};
+
+class Logger
+{
+public:
+    static Logger& instance();
+
+    /// Open the sink and set the level; call before logging from other threads.
+    void configure(const Config& cfg);
+
+    bool enabled(Level l) const
+    {
+        return static_cast<std::uint8_t>(l) >= level_.load(std::memory_order_relaxed);
+    }
+
+    /// Queue one line; never blocks. False if the ring was full.
+    bool push(Level l, std::string_view component, const Line& line);
+
+    /// Rate‑limit check for @p site; may append a suppression note to @p line.
+    bool admit(Site& site, Line& line);
+
+    std::uint64_t dropped()    const { return dropped_.load(std::memory_order_relaxed); }
+    std::uint64_t suppressed() const { return suppressed_.load(std::memory_order_relaxed); }
+
+    ~Logger();
+
+private:
+    struct Record {
+        std::atomic<std::size_t> seq;
+        std::int64_t             when_ms;
+        Level                    level;
+        char                     component[8];
+        std::uint16_t            len;
+        char                     text[kLineBytes];
+    };
+
+    Logger();
+    void writer_loop();
+    void emit(std::string& out, std::int64_t when_ms, Level l,
+              std::string_view component, std::string_view text);
+
+    std::unique_ptr<Record[]>  ring_;
+    std::size_t                mask_ = 0;
+    alignas(64) std::atomic<std::size_t> tail_{0};   ///< next slot producers claim
+    alignas(64) std::size_t    head_ = 0;            ///< next slot the writer reads
+
+    std::atomic<std::uint8_t>  level_{static_cast<std::uint8_t>(Level::info)};
+    std::atomic<std::uint64_t> dropped_{0};
+    std::atomic<std::uint64_t> suppressed_{0};
+    std::FILE*                 sink_ = stdout;
+    std::atomic<bool>          stop_{false};
+    std::thread                writer_;
+};
+
+template <class... Args>
+void write(Site& site, Level level, std::string_view component, const Args&... args)
+{
+    Logger& log = Logger::instance();
+    Line line;
+    (line.put(args), ...);
+    if (log.admit(site, line))
+        log.push(level, component, line);
+}
+
+} // namespace logging
+
+#define LOG_AT(lvl, component, ...)                                              \
+    do {                                                                         \
+        if (::logging::Logger::instance().enabled(lvl)) {                        \
+            static ::logging::Site log_site_;                                    \
+            ::logging::write(log_site_, lvl, component, __VA_ARGS__);            \
+        }                                                                        \
+    } while (0)
+
+#define LOG_DEBUG(component, ...) LOG_AT(::logging::Level::debug, component, __VA_ARGS__)
+#define LOG_INFO(component, ...)  LOG_AT(::logging::Level::info,  component, __VA_ARGS__)
+#define LOG_WARN(component, ...)  LOG_AT(::logging::Level::warn,  component, __VA_ARGS__)
+#define LOG_ERROR(component, ...) LOG_AT(::logging::Level::error, component, __VA_ARGS__)
@@ -0,0 +1,78 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// MemoryTransport.hpp ― an in‑process connection, for benchmarks and checks
+//
+//   • make_memory_pair() gives two ends of one pipe: a MemoryTransport for
+//     a Session (e.g. Server::attach()) and a MemoryPeer standing in for
+//     the client
+//   • The peer side is plain calls – write() bytes in, take() what the
+//     transport wrote – so a driver needs no sockets, threads or callbacks
+//   • Transport completions are posted to the executor given at creation;
+//     with a single‑shard Server driven by io_context::poll() everything is
+//     deterministic
+//   • A capacity caps bytes written but not yet taken; past it writes stay
+//     pending, as on a socket whose reader stalls, and below_lowat() reads
+//     the same count
+//   • Either end closing fails the other's pending operations the way TCP
+//     would: eof for a read, broken_pipe for a write
+//
+// Thread‑safe: the two ends may be used from different threads.
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "Transport.hpp"
+
+struct MemoryPipe;   // shared state of both ends; MemoryTransport.cpp
+
+class MemoryTransport final : public Transport
+{
+public:
+    explicit MemoryTransport(std::shared_ptr<MemoryPipe> pipe) : pipe_(std::move(pipe)) {}
+    ~MemoryTransport() override { close(); }
+
+    void async_read(net::mutable_buffer buf, OwnerPtr owner) override;
+    void async_write(const net::const_buffer* bufs, std::size_t n, OwnerPtr owner) override;
+    void async_wait_writable(OwnerPtr owner) override;
+    bool below_lowat(std::size_t lowat) override;
+    bool is_open() const override;
+    void close() override;
+
+private:
+    std::shared_ptr<MemoryPipe> pipe_;
+};
+
+/// The client's end. Closes on destruction.
+class MemoryPeer
+{
+public:
+    MemoryPeer() = default;
+    explicit MemoryPeer(std::shared_ptr<MemoryPipe> pipe) : pipe_(std::move(pipe)) {}
+    MemoryPeer(MemoryPeer&&) noexcept            = default;
+    MemoryPeer& operator=(MemoryPeer&& o) noexcept { close(); pipe_ = std::move(o.pipe_); return *this; }
+    ~MemoryPeer() { close(); }
+
+    /// Send @p bytes to the transport; false once either end has closed.
+    bool write(std::string_view bytes);
+
+    /// Everything the transport wrote since the last call (frees capacity).
+    std::string take();
+
+    std::size_t pending() const;   ///< bytes written to us, not yet taken
+    bool        closed()  const;   ///< the transport end has closed
+    bool        released() const { return pipe_.use_count() == 1; } ///< … and been destroyed
+    void        close();           ///< hang up: eof to the transport's reads
+
+private:
+    std::shared_ptr<MemoryPipe> pipe_;
+};
+
+/// A connected pair whose transport completes on @p ex; at most
+/// @p capacity bytes may wait for the peer to take() them.
+std::pair<std::unique_ptr<MemoryTransport>, MemoryPeer>
+make_memory_pair(net::any_io_executor ex, std::size_t capacity = SIZE_MAX);
@@ -0,0 +1,104 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// MessageLog.hpp ― durable, append‑only, segmented log of broadcast records
+//
+//   • One directory of segment files, each named after the sequence number
+//     of its first entry (00000000000000000001.log …); a new segment is
+//     started at a batch boundary once the current one passes segment_bytes
+//   • Entry: [u32 len][u32 crc32][u64 seq][u8 room_len][room][record]
+//     (big‑endian like the wire; record is the Payload record as broadcast)
+//   • append() only copies the entry into a pending buffer under a mutex;
+//     a writer thread swaps that buffer out, checksums it, writes it with
+//     one write() and group‑commits with fdatasync at most every fsync_ms –
+//     the io threads never wait on the disk. If the writer falls max_pending_bytes behind,
+//     appends are dropped and counted rather than blocking a broadcast.
+//   • replay() maps each segment read‑only and walks it sequentially,
+//     handing out views into the mapping – no copy, no per‑entry allocation
+//   • A torn tail (crash mid‑write) is detected by length/crc and cut off
+//     when the log is opened
+//
+// POSIX only (open/write/fdatasync/mmap).
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "Metrics.hpp"
+#include "ServerConfig.hpp"
+
+class MessageLog
+{
+public:
+    /// Bytes in an entry besides room name and record.
+    static constexpr std::size_t kEntryOverhead = 4 + 4 + 8 + 1;
+
+    struct Stats {
+        metrics::Counter appended;   ///< entries accepted by append()
+        metrics::Counter dropped;    ///< entries refused (backlog full / writer failed)
+        metrics::Counter bytes;      ///< bytes written to segments
+        metrics::Counter batches;    ///< write() calls
+        metrics::Counter fsyncs;     ///< fdatasync() calls
+    };
+
+    /// Called by replay() for every intact entry, oldest first. The views
+    /// point into a read‑only mapping and are valid only during the call.
+    using Visitor = std::function<void(std::uint64_t seq, std::string_view room,
+                                       std::string_view record)>;
+
+    /// Open (creating if needed) the log in cfg.dir, cut off any torn tail
+    /// and start the writer thread. Throws std::system_error on I/O errors.
+    explicit MessageLog(const LogConfig& cfg);
+
+    /// Writes and syncs everything appended so far, then stops the writer.
+    ~MessageLog();
+
+    MessageLog(const MessageLog&)            = delete;
+    MessageLog& operator=(const MessageLog&) = delete;
+
+    /// Visit every entry on disk. Call before the first append().
+    /// @return number of entries visited
+    std::uint64_t replay(const Visitor& visit) const;
+
+    /// Queue one record. Never blocks on I/O; thread‑safe.
+    /// @return its sequence number, or 0 if it was dropped
+    std::uint64_t append(std::string_view room, std::string_view record);
+
+    /// Highest sequence number handed out (or recovered).
+    std::uint64_t last_seq() const;
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    struct Segment {
+        std::uint64_t first_seq;
+        std::string   path;
+    };
+
+    void recover_tail();
+    void open_segment(std::uint64_t first_seq);
+    void writer_loop();
+    void sync();
+
+    const LogConfig         cfg_;
+    std::vector<Segment>    segments_;   ///< oldest first; back() is being appended to
+    int                     fd_ = -1;    ///< back()'s descriptor (writer thread only)
+    std::size_t             seg_size_ = 0;
+
+    mutable std::mutex      mtx_;
+    std::condition_variable cv_;
+    std::string             pending_;    ///< encoded entries not yet handed to the writer
+    std::uint64_t           pending_first_ = 0;  ///< seq of pending_'s first entry
+    std::uint64_t           last_seq_ = 0;
+    bool                    stop_   = false;
+    bool                    failed_ = false;     ///< writer hit an I/O error; append drops
+
+    Stats                   stats_;
+    std::thread             writer_;
+};
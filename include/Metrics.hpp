@@ -0,0 +1,157 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// Metrics.hpp ― cheap always‑on instrumentation primitives
+//
+//   • Counter       → single‑writer (owning shard thread) monotonic count;
+//                     a relaxed load + store, no locked RMW on the hot path
+//   • Gauge         → multi‑writer signed level (fetch_add)
+//   • Log2Histogram → power‑of‑two buckets of single‑writer counters;
+//                     observe() is a clz and two stores, readers merge
+//   • Exposition    → renders all of the above in the Prometheus text format
+//
+// Each shard owns its own instances, so writers never share cache lines
+// with other threads; the admin endpoint sums shards when scraped.
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace metrics {
+
+class Counter
+{
+public:
+    void add(std::uint64_t n = 1)
+    {
+        v_.store(v_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    std::uint64_t get() const { return v_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::uint64_t> v_{0};
+};
+
+class Gauge
+{
+public:
+    void add(std::int64_t n) { v_.fetch_add(n, std::memory_order_relaxed); }
+    void sub(std::int64_t n) { v_.fetch_sub(n, std::memory_order_relaxed); }
+    std::int64_t get() const { return v_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::int64_t> v_{0};
+};
+
+/**
+ * @brief  Histogram with bucket upper bounds 1, 2, 4 … 2^(N‑1) (plus +Inf),
+ *         in whatever integer unit the caller observes (ns, entries …).
+ */
+template <int N>
+class Log2Histogram
+{
+public:
+    static constexpr int kBuckets = N;
+
+    void observe(std::uint64_t v)
+    {
+        int i = v <= 1 ? 0 : 64 - __builtin_clzll(v - 1); // ceil(log2 v)
+        buckets_[i < N ? i : N].add();
+        sum_.add(v);
+    }
+
+    /// Plain snapshot used for summing shards before rendering.
+    struct Snapshot
+    {
+        std::array<std::uint64_t, N + 1> buckets{};
+        std::uint64_t sum = 0;
+
+        void merge(const Log2Histogram& h)
+        {
+            for (int i = 0; i <= N; ++i) buckets[i] += h.buckets_[i].get();
+            sum += h.sum_.get();
+        }
+    };
+
+private:
+    std::array<Counter, N + 1> buckets_;   ///< [N] is the overflow (+Inf) bucket
+    Counter                    sum_;
+};
+
+/**
+ * @brief  Accumulates Prometheus text exposition format (version 0.0.4).
+ */
+class Exposition
+{
+public:
+    void counter(std::string_view name, std::string_view help, std::uint64_t v,
+                 std::string_view labels = {})
+    {
+        header(name, help, "counter");
+        sample(name, labels, std::to_string(v));
+    }
+
+    void gauge(std::string_view name, std::string_view help, std::int64_t v)
+    {
+        header(name, help, "gauge");
+        sample(name, {}, std::to_string(v));
+    }
+
+    /// Additional labelled sample for a family already opened by counter().
+    void labelled(std::string_view name, std::string_view labels, std::uint64_t v)
+    {
+        sample(name, labels, std::to_string(v));
+    }
+
+    /// @param scale  multiply bucket bounds and sum by this on output
+    ///               (e.g. 1e-9 to report nanosecond observations as seconds)
+    template <int N>
+    void histogram(std::string_view name, std::string_view help,
+                   const typename Log2Histogram<N>::Snapshot& h, double scale = 1.0)
+    {
+        header(name, help, "histogram");
+        std::string bucket = std::string(name) + "_bucket";
+        std::uint64_t cumulative = 0;
+        for (int i = 0; i < N; ++i) {
+            cumulative += h.buckets[i];
+            sample(bucket, "le=\"" + number(double(std::uint64_t(1) << i) * scale) + "\"",
+                   std::to_string(cumulative));
+        }
+        cumulative += h.buckets[N];
+        sample(bucket, "le=\"+Inf\"", std::to_string(cumulative));
+        sample(std::string(name) + "_sum", {}, number(double(h.sum) * scale));
+        sample(std::string(name) + "_count", {}, std::to_string(cumulative));
+    }
+
+    const std::string& str() const { return out_; }
+
+private:
+    void header(std::string_view name, std::string_view help, std::string_view type)
+    {
+        out_.append("# HELP ").append(name).append(" ").append(help).append("\n");
+        out_.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+    }
+
+    void sample(std::string_view name, std::string_view labels, const std::string& v)
+    {
+        out_.append(name);
+        if (!labels.empty())
+            out_.append("{").append(labels).append("}");
+        out_.append(" ").append(v).append("\n");
+    }
+
+    static std::string number(double v)
+    {
+        char buf[32];
+        std::snprintf(buf, sizeof buf, "%.9g", v);
+        return buf;
+    }
+
+    std::string out_;
+};
+
+} // namespace metrics
@@ -0,0 +1,126 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// Payload.hpp ― immutable, ref‑counted message bytes shared by every outbox
+//
+//   • A broadcast is serialized once into a Payload
+//   • Each recipient's outbox holds a shared_ptr to the same buffer, so
+//     fan‑out costs one refcount bump per recipient instead of a copy
+//
+// A Payload holds one or more *records*:
+//
+//       [u64 seq][u32 big‑endian body length][body]['\n']
+//
+// which serves every protocol without re‑encoding: a text session sends
+// body + '\n', a framed session sends length + body, a sequenced session
+// seq + length + body. Either way each record is one contiguous iovec.
+//
+// seq is the message's position in its room, stamped by the Server when it
+// is broadcast (stamp_seq); 0 for notices that are not part of a room.
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "Framing.hpp"
+
+using Payload = std::shared_ptr<const std::string>;
+
+inline constexpr std::size_t kRecordHeader   = wire::kSeqSize + wire::kHeaderSize;
+inline constexpr std::size_t kRecordOverhead = kRecordHeader + 1;
+
+/// Wrap bytes that are already a sequence of records.
+inline Payload make_payload(std::string records)
+{
+    return std::make_shared<const std::string>(std::move(records));
+}
+
+/// Append one record for @p body to @p out.
+inline void append_record(std::string& out, std::string_view body, std::uint64_t seq = 0)
+{
+    char hdr[kRecordHeader];
+    wire::put_u64(hdr, seq);
+    wire::put_u32(hdr + wire::kSeqSize, static_cast<std::uint32_t>(body.size()));
+    out.append(hdr, kRecordHeader);
+    out.append(body);
+    out += '\n';
+}
+
+/// Total bytes of the record starting at @p record.
+inline std::size_t record_size(const char* record)
+{
+    return wire::get_u32(record + wire::kSeqSize) + kRecordOverhead;
+}
+
+inline std::uint64_t record_seq(const char* record) { return wire::get_u64(record); }
+
+/**
+ * Set the sequence number of a single‑record payload. Only valid while the
+ * caller holds the only reference – before it is queued or recorded.
+ */
+inline void stamp_seq(const Payload& p, std::uint64_t seq)
+{
+    wire::put_u64(const_cast<char*>(p->data()), seq);
+}
+
+/**
+ * Number the records of a fresh payload @p first, @p first + 1, …; the
+ * same rules as stamp_seq apply. @return the number of records
+ */
+inline std::size_t stamp_seqs(const Payload& p, std::uint64_t first)
+{
+    std::size_t n = 0;
+    for (std::size_t at = 0; at < p->size(); at += record_size(p->data() + at))
+        wire::put_u64(const_cast<char*>(p->data()) + at, first + n++);
+    return n;
+}
+
+/// Encode a single message (one allocation for control block + string).
+inline Payload make_message(std::string_view body)
+{
+    std::string rec;
+    rec.reserve(body.size() + kRecordOverhead);
+    append_record(rec, body);
+    return make_payload(std::move(rec));
+}
+
+/// Byte range of one record as sent to a session speaking @p p.
+struct WireSpan { const char* data; std::size_t size; };
+
+inline WireSpan wire_span(wire::Protocol p, const char* record)
+{
+    std::size_t len = wire::get_u32(record + wire::kSeqSize);
+    switch (p) {
+    case wire::Protocol::sequenced: return {record, kRecordHeader + len};
+    case wire::Protocol::framed:    return {record + wire::kSeqSize, wire::kHeaderSize + len};
+    default:                        return {record + kRecordHeader, len + 1};
+    }
+}
+
+/// Bytes of each record that a session speaking @p p does not send.
+inline std::size_t wire_strip(wire::Protocol p)
+{
+    switch (p) {
+    case wire::Protocol::sequenced: return 1;
+    case wire::Protocol::framed:    return wire::kSeqSize + 1;
+    default:                        return kRecordHeader;
+    }
+}
+
+/// Number of records in @p p (1 for everything but history snapshots).
+inline std::size_t record_count(const std::string& p)
+{
+    if (p.size() >= kRecordOverhead && record_size(p.data()) == p.size())
+        return 1;
+    std::size_t n = 0;
+    for (std::size_t at = 0; at < p.size(); ++n)
+        at += record_size(p.data() + at);
+    return n;
+}
+
+/// Bytes @p p occupies on the wire for a session speaking @p proto.
+inline std::size_t wire_size(wire::Protocol proto, const std::string& p)
+{
+    return p.size() - record_count(p) * wire_strip(proto);
+}
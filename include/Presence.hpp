@@ -0,0 +1,61 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// Presence.hpp ― who is in a room, and what changed since the last update
+//
+//   • Roster: one per room, fed by the joins and leaves the server
+//     announces (a detached session that may still resume stays listed)
+//   • names() is the snapshot behind /who
+//   • With coalescing on, joined() / left() also net out a pending delta
+//     per name; take_update() turns it into one line per tick – names for
+//     a handful of changes, counts for a storm – so a mass reconnect costs
+//     each member O(1) writes per tick instead of one per event
+//
+// Thread‑safe: any shard may announce, the presence tick takes updates.
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class Roster
+{
+public:
+    /// @param coalesce  keep the pending delta for take_update()
+    explicit Roster(bool coalesce) : coalesce_(coalesce) {}
+
+    /// @return true for the first change since the last take_update()
+    ///         (always false without coalescing)
+    bool joined(std::string_view name) { return change(name, +1); }
+    bool left  (std::string_view name) { return change(name, -1); }
+
+    /// List @p name with no pending change (a client carried over by a
+    /// hot upgrade, already announced by the old process).
+    void restore(std::string_view name);
+
+    /// Names present, sorted; a name connected twice is listed once.
+    std::vector<std::string> names() const;
+    std::size_t              size()  const;   ///< distinct names present
+
+    /**
+     * The net changes since the last call as a server line for @p room,
+     * e.g. "[server] #lobby: +ann +bob -cid", or "… 812 joined, 3 left"
+     * past @p max_names; empty if nothing changed (or all cancelled out).
+     */
+    std::string take_update(std::string_view room, std::size_t max_names);
+
+private:
+    bool change(std::string_view name, int by);
+
+    const bool                                   coalesce_;
+    mutable std::mutex                           mtx_;
+    std::map<std::string, std::uint32_t, std::less<>> present_;   ///< name → connections
+    std::unordered_map<std::string, int>         pending_;        ///< name → net joins
+    bool                                         dirty_ = false;  ///< changed since take_update()
+};
@@ -0,0 +1,87 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// RateLimiter.hpp ― token buckets for inbound flood protection
+//
+//   • TokenBucket: `rate` tokens per second, at most `burst` banked;
+//     refilled lazily from the caller's clock reading, so an idle bucket
+//     costs nothing
+//   • Every session has one bucket for messages and one for bytes; every
+//     client address has another pair (AddressLimit) shared by all the
+//     sessions connected from it, on whatever shard
+//   • A message is admitted only if every bucket that applies can pay for
+//     it, and is then charged to all of them; otherwise the caller learns
+//     how long until it could be
+//
+// TokenBucket is not thread‑safe; AddressLimit guards its pair with a
+// mutex, taken once per inbound message of a limited client.
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+class TokenBucket
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket() = default;   ///< unlimited
+    TokenBucket(double rate, double burst) : rate_(rate), burst_(burst), tokens_(burst) {}
+
+    bool limited() const { return rate_ > 0; }
+
+    /// Time until @p n tokens are available (zero = now); refills first.
+    Clock::duration wait(double n, Clock::time_point now)
+    {
+        if (!limited())
+            return Clock::duration::zero();
+        refill(now);
+        if (tokens_ >= n)
+            return Clock::duration::zero();
+        return std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>((n - tokens_) / rate_));
+    }
+
+    /// Spend @p n tokens; call after wait() returned zero.
+    void take(double n)
+    {
+        if (limited())
+            tokens_ -= n;
+    }
+
+private:
+    void refill(Clock::time_point now)
+    {
+        if (now > last_) {
+            tokens_ = std::min(burst_, tokens_ + std::chrono::duration<double>(now - last_).count() * rate_);
+            last_   = now;
+        }
+    }
+
+    double            rate_   = 0;
+    double            burst_  = 0;
+    double            tokens_ = 0;
+    Clock::time_point last_{};
+};
+
+/// Message and byte buckets for one client address, shared across shards.
+struct AddressLimit {
+    std::mutex  mtx;
+    TokenBucket messages;
+    TokenBucket bytes;
+};
+
+/// Bucket for @p rate messages/s holding @p burst_seconds of them (≥ 1).
+inline TokenBucket message_bucket(double rate, double burst_seconds)
+{
+    return rate > 0 ? TokenBucket(rate, std::max(1.0, rate * burst_seconds)) : TokenBucket();
+}
+
+/// Bucket for @p rate bytes/s; always deep enough for one @p max_message.
+inline TokenBucket byte_bucket(double rate, double burst_seconds, std::size_t max_message)
+{
+    return rate > 0 ? TokenBucket(rate, std::max(double(max_message), rate * burst_seconds))
+                    : TokenBucket();
+}
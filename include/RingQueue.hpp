@@ -0,0 +1,78 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// RingQueue.hpp ― growable circular buffer, used as a session's outbox
+//
+//   • push_back / pop_front are O(1) and never allocate once the ring has
+//     grown to the session's peak backlog (std::deque allocates and frees
+//     a block every few dozen elements, forever)
+//   • insert / erase at an index shift the elements behind it – fine for
+//     the rare gap‑marker and drop operations they serve
+//   • Capacity is a power of two, so indexing is a mask, not a modulo
+//
+// Not thread‑safe.
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+template <class T>
+class RingQueue
+{
+public:
+    bool        empty() const { return size_ == 0; }
+    std::size_t size()  const { return size_; }
+
+    T&       operator[](std::size_t i)       { return buf_[(head_ + i) & (buf_.size() - 1)]; }
+    const T& operator[](std::size_t i) const { return buf_[(head_ + i) & (buf_.size() - 1)]; }
+    T&       front() { return (*this)[0]; }
+    T&       back()  { return (*this)[size_ - 1]; }
+
+    void push_back(T v)
+    {
+        if (size_ == buf_.size())
+            grow();
+        (*this)[size_++] = std::move(v);
+    }
+
+    void pop_front()
+    {
+        buf_[head_] = T();                     // release what it holds now
+        head_ = (head_ + 1) & (buf_.size() - 1);
+        --size_;
+    }
+
+    /// Insert before position @p at (0 … size()).
+    void insert(std::size_t at, T v)
+    {
+        push_back(std::move(v));
+        for (std::size_t i = size_ - 1; i > at; --i)
+            std::swap((*this)[i], (*this)[i - 1]);
+    }
+
+    void erase(std::size_t at)
+    {
+        if (at == 0) {
+            pop_front();
+            return;
+        }
+        for (std::size_t i = at; i + 1 < size_; ++i)
+            (*this)[i] = std::move((*this)[i + 1]);
+        (*this)[--size_] = T();
+    }
+
+private:
+    void grow()
+    {
+        std::vector<T> bigger(buf_.empty() ? 16 : buf_.size() * 2);
+        for (std::size_t i = 0; i < size_; ++i)
+            bigger[i] = std::move((*this)[i]);
+        buf_.swap(bigger);
+        head_ = 0;
+    }
+
+    std::vector<T> buf_;
+    std::size_t    head_ = 0;
+    std::size_t    size_ = 0;
+};
@@ -1,11 +1,31 @@
 #pragma once
 #include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <deque>
 #include <memory>
+#include <mutex>
+#include <random>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
+#include <vector>
+#include "AdminEndpoint.hpp"
+#include "Federation.hpp"
+#include "Handoff.hpp"
+#include "History.hpp"
+#include "MessageLog.hpp"
+#include "Metrics.hpp"
+#include "Payload.hpp"
+#include "Presence.hpp"
+#include "RateLimiter.hpp"
+#include "ServerConfig.hpp"
+#include "SlotTable.hpp"
+#include "TimerWheel.hpp"
+#include "session.hpp"
 
-class Session;                      // forward
 struct ClientSessionInfo;           // forward
 
 namespace net = boost::asio;
@@ -13,35 +33,328 @@ using     tcp = net::ip::tcp;
 
 /**
  * Chat server: accepts TCP clients, spawns a Session for each,
- * and broadcasts messages.
+ * and broadcasts messages to the members of the sender's room.
+ * Clients on the same host may also connect over an AF_UNIX socket, and
+ * high‑rate local publishers over a shared‑memory ring (ShmTransport.hpp);
+ * their sessions behave exactly like TCP ones, except that per‑address
+ * rate limits don't apply to them. Connections can also be handed over already open through attach() –
+ * any Transport, e.g. an in‑memory one (MemoryTransport.hpp) for
+ * benchmarks and checks that need no sockets.
+ *
+ * Every broadcast is stamped with its sequence number in the room. Clients
+ * speaking wire::Protocol::sequenced get a resume token; if their
+ * connection drops they can reconnect with "/resume TOKEN SEQ" instead of
+ * a name and receive only what they missed, and nobody sees them leave
+ * and rejoin. Their departure is announced only if they don't come back
+ * within resume_seconds.
+ *
+ * With federation configured, every room broadcast is also published to
+ * the other nodes, messages they publish are broadcast here as if sent
+ * locally (without being published again), and /rooms counts their
+ * members too. Rooms are matched by name across nodes.
+ *
+ * With an upgrade socket configured, a new server process can take over
+ * without dropping anyone (Handoff.hpp): on its connect every shard
+ * freezes its sessions between two messages, and the listening sockets,
+ * client sockets, unsent queues, room sequence numbers and resume tickets
+ * go to the successor, which carries on where this process stopped.
+ *
+ * With a log directory configured, every message that enters a room's
+ * history is also appended to a MessageLog, and the histories are rebuilt
+ * from it at startup.
+ *
+ * Every client is in exactly one room at a time, starting in kLobby;
+ * "/join NAME", "/leave" (back to the lobby) and "/rooms" move between and
+ * list them. Each room keeps its own history, and every shard keeps an
+ * index of its local members per room, so a broadcast only touches the
+ * sessions of that room and only wakes shards that have members in it.
+ *
+ * The server is split into shards. Each shard is one io_context driven by
+ * one thread and owns the sessions accepted onto it, so a session is only
+ * ever touched from its own shard's thread. A broadcast is delivered
+ * locally and then handed to every other shard through that shard's inbox.
  */
 class Server
 {
 public:
-    explicit Server(net::io_context& io_context, short port);
+    static constexpr std::string_view kLobby = "lobby";
+    /// Resolution of session deadlines: one TimerWheel step per shard.
+    static constexpr std::chrono::milliseconds kTimerTick{100};
+
+    /// @param io_context  becomes shard 0 (runs the acceptor); run by run()
+    /// @param inherited   a predecessor's sockets and sessions, from
+    ///                    handoff::take_over(); empty for a cold start
+    explicit Server(net::io_context& io_context, const ServerConfig& cfg,
+                    handoff::State inherited = {});
+    ~Server();
+
+    /// Start the extra shard threads and run shard 0 on the calling thread.
+    /// Returns once every shard has been stopped.
+    void run();
+
+    /// Stop every shard's io_context (safe from any thread).
+    void stop();
+
+    /**
+     * Serve a connected client over @p transport on shard @p shard, as if
+     * just accepted there; the transport must complete on that shard's
+     * io_context. @p peer keys per‑address rate limits. Safe from any
+     * thread; the session starts on the shard's thread.
+     */
+    void attach(std::size_t shard, std::unique_ptr<Transport> transport,
+                const net::ip::address& peer = {});
+
+    std::size_t      shard_count() const { return shards_.size(); }
+    net::io_context& shard_io(std::size_t shard);
+
+    /// Reactor Asio was built on: "epoll", "io_uring" (CHAT_USE_IO_URING) or "other".
+    static const char* io_backend();
 
 private:
+    struct Shard;
+    struct Room;
+    struct Ticket;
+    friend struct ClientSessionInfo;
+
     // helpers
-    int  generate_client_id();
-    void on_client_identified(int id, const std::string& name);
-    void on_client_message   (int id, const std::string& text);
+    void on_client_identified(Shard& shard, SessionId id, const std::string& name);
+    void on_client_message   (Shard& shard, SessionId id, std::string_view text);
+    bool on_command          (Shard& shard, SessionId id, ClientSessionInfo& client, std::string_view text);
     void do_accept();
-    void on_client_disconnect(int id);
-    void broadcast(const std::string& text);
-    void broadcastNoEcho(int id,const std::string& payload);
+    void do_accept_local(local_stream::acceptor& acceptor, bool shm);
+    void add_session(Shard& target, std::unique_ptr<Transport> transport,
+                     const net::ip::address& peer, handoff::SessionState* restored = nullptr);
+    std::shared_ptr<AddressLimit> address_limit(const net::ip::address& addr);
+    void on_client_disconnect(Shard& shard, SessionId id, DisconnectReason why);
+    void broadcast(Shard& origin, Room& room, Payload payload);
+    void broadcastNoEcho(Shard& origin, Room& room, SessionId id, Payload payload);
+    void fan_out(Shard& origin, Room& room, SessionId skip_id, const Payload& payload,
+                 bool federate = true);
+    void relay_bulk(Shard& origin, Room& room, SessionId skip_id, const Payload& payload);
+    void flush_batch  (Shard& shard, Room& room);
+    void flush_batches(Shard& shard);
+    void on_remote_message(std::string_view room, std::string_view text);
+    void enqueue(Shard& target, Room& room, const Payload& payload,
+                 Priority prio = Priority::interactive);
+    void drain_inbox(Shard& shard);
+
+    // rooms
+    Room* find_room(std::string_view name, bool create);
+    void  recover_history();
+    void  enter_room(Shard& shard, SessionId id, ClientSessionInfo& client, Room& room,
+                     std::string_view note);
+    void  leave_room(Shard& shard, SessionId id, ClientSessionInfo& client, std::string_view note);
+    void  add_member   (Shard& shard, SessionId id, ClientSessionInfo& client, Room& room);
+    void  remove_member(Shard& shard, ClientSessionInfo& client);
+    std::string list_rooms();
+
+    // presence
+    void announce(Shard& shard, Room& room, SessionId skip_id, const std::string& name,
+                  std::string_view note, bool joined);
+    void schedule_presence();
+    void send_presence();
+
+    // session resumption
+    void issue_ticket(Shard& shard, SessionId id, ClientSessionInfo& client);
+    void resume(Shard& shard, SessionId id, ClientSessionInfo& client, std::string_view args);
+    void takeover(Shard& shard, SessionId id);
+    void schedule_ticket_sweep();
+    void sweep_tickets();
+
+    // hot upgrade
+    void do_accept_upgrade();
+    void begin_handoff();
+    void freeze_shard  (Shard& shard);
+    void snapshot_shard(Shard& shard);
+    void finish_handoff();
+    void adopt(handoff::State& inherited);
+    void restore_session(Shard& target, handoff::SessionState& state);
+
+    void schedule_timer_tick(Shard& shard);
+
+    void schedule_stats();
+    void dump_stats();
+    std::string render_metrics() const;
 
     // data
-    tcp::acceptor                                              acceptor_;
-    std::unordered_map<int, std::shared_ptr<ClientSessionInfo>> clients_;
-    std::deque<std::string>                                   recent_messages_;
+    std::vector<std::unique_ptr<net::io_context>> owned_io_; ///< shards 1..N-1
+    std::vector<std::unique_ptr<Shard>>           shards_;
+    std::size_t                                   next_shard_ = 0; ///< round-robin accept
+    tcp::acceptor                                 acceptor_;  ///< closed unless cfg.listen
+    local_stream::acceptor                        unix_acceptor_; ///< closed unless cfg.unix_path
+    local_stream::acceptor                        shm_acceptor_;  ///< closed unless cfg.shm_path
+    std::vector<std::string>                      socket_files_;  ///< unlinked on destruction
+    net::steady_timer                             stats_timer_;
+    unsigned                                      stats_interval_;
+
+    std::atomic<std::size_t>                      global_queued_{0}; ///< outbox bytes, all shards
+
+    // room registry; rooms live as long as the server so shards may hold Room*
+    std::size_t                                   history_messages_;
+    std::size_t                                   history_bytes_;
+    std::size_t                                   max_rooms_;
+    mutable std::mutex                            rooms_mtx_;
+    std::unordered_map<std::string, std::unique_ptr<Room>> rooms_;
+    Room*                                         lobby_ = nullptr;
+
+    std::unique_ptr<MessageLog>                   log_;     ///< null unless --log-dir
+    std::unique_ptr<Federation>                   federation_; ///< null unless peers/port given
+
+    // resume tickets, shared by all shards; detached_ lists dropped
+    // sessions in expiry order (entries whose ticket moved on are skipped)
+    using Clock = std::chrono::steady_clock;
+    std::chrono::seconds                          resume_window_;
+    net::steady_timer                             sweep_timer_;
+    std::mutex                                    tickets_mtx_;
+    std::unordered_map<std::string, Ticket>       tickets_;
+    std::deque<std::pair<Clock::time_point, std::string>> detached_;
+    std::random_device                            token_rng_;
+
+    // hot upgrade: a successor connecting to upgrade_acceptor_ gets
+    // handoff_, filled shard by shard (see begin_handoff())
+    local_stream::acceptor                        upgrade_acceptor_; ///< closed unless cfg.upgrade_path
+    bool                                          handing_off_ = false; ///< shard 0 only
+    int                                           successor_   = -1;    ///< open until we exit: its cue
+    Clock::time_point                             handoff_start_;
+    std::atomic<std::size_t>                      handoff_pending_{0};  ///< shards yet to finish a round
+    std::mutex                                    handoff_mtx_;
+    handoff::State                                handoff_;
+
+    // per-address rate limit buckets, shared by all shards
+    RateLimitConfig                               rate_limits_;
+    std::size_t                                   max_message_;
+    std::mutex                                    address_mtx_;
+    std::unordered_map<std::string, std::weak_ptr<AddressLimit>> address_limits_;
+    std::size_t                                   address_prune_at_ = 1024;
+
+    // broadcast batching; window 0 = off
+    std::chrono::microseconds                     batch_window_;
+    std::size_t                                   batch_bytes_;
+
+    // presence: rooms with a pending delta, sent by shard 0 every tick
+    PresenceConfig                                presence_;
+    net::steady_timer                             presence_timer_;
+    std::mutex                                    presence_mtx_;
+    std::vector<Room*>                            presence_dirty_;
+
+    std::unique_ptr<AdminEndpoint>                admin_;   ///< null unless --admin-port
 };
 
 /* ---------------------------------------------------------------------------
- * Helper wrapper stored in the map
+ * Per-client state, stored inline in the shard's SlotTable
  * -------------------------------------------------------------------------*/
 struct ClientSessionInfo {
     std::shared_ptr<Session> session;
     std::string              name;
+    Server::Room*            room = nullptr;   ///< null until named
+    std::uint32_t            member_pos = 0;   ///< index in the shard's member list for room
+    std::string              token;            ///< resume ticket; empty unless sequenced
     explicit ClientSessionInfo(std::shared_ptr<Session> s)
         : session(std::move(s)) {}
 };
+
+/* ---------------------------------------------------------------------------
+ * One io_context + thread and the sessions that live on it
+ * -------------------------------------------------------------------------*/
+struct Server::Shard {
+    using WorkGuard = net::executor_work_guard<net::io_context::executor_type>;
+
+    std::size_t      index;
+    net::io_context& io;
+    WorkGuard        work;          ///< keeps run() alive with no sessions
+    std::thread      thread;        ///< empty for shard 0 (caller's thread)
+
+    /// Every session's handshake / heartbeat / idle deadline; declared
+    /// before `clients` so it outlives the sessions that link into it.
+    TimerWheel                            timers;
+    net::steady_timer                     tick_timer;
+    std::chrono::steady_clock::time_point tick_epoch;   ///< when timers.now() was 0
+
+    /// Every session on this shard; ids are striped by shard index.
+    SlotTable<ClientSessionInfo> clients;
+
+    /// room → local members, packed; the index a broadcast walks linearly.
+    /// Sessions are owned by `clients`, entries are removed before the
+    /// session is, and each client remembers its position (member_pos)
+    /// so leaving is a swap‑remove.
+    struct Member { SessionId id; Session* session; };
+    std::unordered_map<const Room*, std::vector<Member>> members;
+
+    // cross-shard broadcast queue: filled by other shards, drained here
+    struct Delivery { Room* room; Payload payload; Priority prio; };
+    std::mutex               inbox_mtx;
+    std::vector<Delivery>    inbox;
+    std::vector<Delivery>    draining;      ///< swapped with inbox; both keep capacity
+    bool                     drain_posted = false;
+    HandlerMemory            drain_mem;     ///< for the one drain posted at a time
+
+    /// Chat lines received here and not yet broadcast, per room, as
+    /// unnumbered records; sent when batch_timer fires or one grows past
+    /// the size limit (only used with batching on).
+    std::unordered_map<Room*, std::string> batches;
+    net::steady_timer        batch_timer;
+    bool                     batch_armed = false;
+    HandlerMemory            batch_mem;
+
+    SessionContext           session_ctx;   ///< limits + counters for this shard's sessions
+    bool                     frozen = false; ///< handing off: sessions frozen (freeze_shard())
+
+    // server-side metrics for this shard (written only by its thread)
+    metrics::Counter            accepts;
+    metrics::Gauge              sessions;
+    metrics::Log2Histogram<28>  fanout_ns;  ///< per broadcast, per shard that delivers it
+    metrics::Counter            resumes;
+    metrics::Counter            resume_failures;
+    metrics::Counter            presence_events;   ///< joins / leaves announced from here
+    metrics::Counter            presence_updates;  ///< coalesced lines sent (shard 0 only)
+    metrics::Counter            transfer_lines;    ///< /file, /chunk, /sent relayed from here
+
+    Shard(std::size_t i, std::size_t count, net::io_context& ctx)
+        : index(i), io(ctx), work(net::make_work_guard(ctx)), tick_timer(ctx)
+        , clients(static_cast<std::uint32_t>(count), static_cast<std::uint32_t>(i))
+        , batch_timer(ctx) {}
+};
+
+/* ---------------------------------------------------------------------------
+ * A named channel: its history and how many members each shard has
+ * -------------------------------------------------------------------------*/
+struct Server::Room {
+    std::string    name;
+    MessageHistory history;
+
+    /// Held while a broadcast is numbered, recorded, handed to the other
+    /// shards and delivered on its own, so every shard sees the room's
+    /// messages in sequence order.
+    std::mutex     order_mtx;
+    std::uint64_t  last_seq = 0;
+
+    /// Members per shard, written by that shard, read by senders on other
+    /// shards to skip posting to shards with nobody in the room.
+    std::vector<std::atomic<std::uint32_t>> members_on;
+
+    /// Who has been announced here; see Presence.hpp.
+    Roster         roster;
+
+    Room(std::string n, std::size_t shards, std::size_t max_messages, std::size_t max_bytes,
+         bool coalesce_presence)
+        : name(std::move(n)), history(max_messages, max_bytes), members_on(shards)
+        , roster(coalesce_presence) {}
+
+    std::size_t member_count() const
+    {
+        std::size_t n = 0;
+        for (auto& c : members_on) n += c.load(std::memory_order_relaxed);
+        return n;
+    }
+};
+
+/* ---------------------------------------------------------------------------
+ * What a sequenced client needs to resume: who it was and where it was
+ * -------------------------------------------------------------------------*/
+struct Server::Ticket {
+    std::string       name;
+    Room*             room  = nullptr;
+    std::size_t       shard = 0;    ///< where the session lives while attached
+    SessionId         id    = 0;    ///< 0 while detached (connection dropped)
+    Clock::time_point expires;      ///< only meaningful while detached
+};
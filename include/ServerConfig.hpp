@@ -0,0 +1,172 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// ServerConfig.hpp ― tunables for chat_server
+//
+//   • Plain aggregate filled in by main_server.cpp from the command line
+//   • Passed by const& to Server, which copies what it needs
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// What to do when a session's outbound queue would exceed its byte cap.
+enum class SlowConsumerPolicy {
+    disconnect,   ///< close the connection
+    drop_oldest,  ///< drop queued messages oldest‑first, leave a "gap" marker
+    collapse,     ///< drop the whole queued backlog, leave one summary marker
+};
+
+/**
+ * @brief  Byte caps on queued‑but‑unsent data.
+ *
+ * The session cap is hard. The global cap is shared by all sessions on all
+ * shards; it is only enforced against sessions that already have a backlog,
+ * so a reader that keeps up can always receive the next message.
+ */
+struct OutboxLimits
+{
+    std::size_t        session_bytes = 4u  << 20;  ///< per‑session queued bytes
+    std::size_t        global_bytes  = 512u << 20; ///< whole process
+    std::size_t        bulk_bytes    = 8u  << 20;  ///< per‑session bulk queue; chunks past it are dropped
+    SlowConsumerPolicy policy        = SlowConsumerPolicy::disconnect;
+};
+
+/**
+ * @brief  Optional on‑disk message log (see MessageLog.hpp).
+ *
+ * Appends are group‑committed by a background thread: at most one
+ * fdatasync per fsync_ms, so a crash loses at most that window.
+ */
+struct LogConfig
+{
+    std::string dir;                            ///< empty = no persistence
+    std::size_t segment_bytes     = 64u << 20;  ///< roll to a new segment past this
+    unsigned    fsync_ms          = 10;         ///< group‑commit interval; 0 = sync every batch
+    std::size_t max_pending_bytes = 64u << 20;  ///< writer backlog before appends are dropped
+};
+
+/**
+ * @brief  Links to other chat_server instances (see Federation.hpp).
+ *
+ * Federation is on when a port to accept peers on or at least one peer to
+ * dial is given. Every node needs a distinct node_id.
+ */
+struct FederationConfig
+{
+    std::string              node_id;                 ///< empty = "<hostname>:<client port>"
+    unsigned short           port = 0;                ///< accept peer links here; 0 = don't
+    std::vector<std::string> peers;                   ///< "host:port" of peers to dial (and redial)
+    std::size_t              max_link_bytes = 64u << 20; ///< unsent bytes before a link is dropped
+
+    bool enabled() const { return port || !peers.empty(); }
+};
+
+/**
+ * @brief  Connection liveness checks (see TimerWheel.hpp); 0 turns one off.
+ *
+ * A named client that has sent nothing for heartbeat_seconds is sent
+ * wire::kPing; one that has sent nothing for idle_seconds – pongs
+ * included – is disconnected, as is a connection that hasn't sent its
+ * name within handshake_seconds. Heartbeats and the idle limit apply only
+ * to framed and sequenced clients: a text client may predate pings, so
+ * once named it is never pinged or reaped for being quiet.
+ */
+struct TimeoutConfig
+{
+    unsigned handshake_seconds = 10;
+    unsigned heartbeat_seconds = 30;
+    unsigned idle_seconds      = 90;
+};
+
+/// What happens to a message that exceeds a rate limit.
+enum class RateLimitAction {
+    throttle,     ///< stop reading from the client until its tokens refill
+    drop,         ///< discard the message, keep the connection
+    disconnect,   ///< close the connection
+};
+
+/**
+ * @brief  Inbound token buckets (see RateLimiter.hpp); a rate of 0 is no limit.
+ *
+ * Session limits apply to each connection, address limits to all
+ * connections from one IP together. Each bucket holds burst_seconds worth
+ * of its rate (and never less than one maximal message).
+ */
+struct RateLimitConfig
+{
+    double          session_messages = 0;   ///< messages per second per session
+    double          session_bytes    = 0;   ///< bytes per second per session
+    double          address_messages = 0;   ///< messages per second per client IP
+    double          address_bytes    = 0;   ///< bytes per second per client IP
+    double          burst_seconds    = 2;
+    RateLimitAction action = RateLimitAction::throttle;
+
+    bool per_session() const { return session_messages > 0 || session_bytes > 0; }
+    bool per_address() const { return address_messages > 0 || address_bytes > 0; }
+};
+
+/**
+ * @brief  Broadcast batching: the chat lines one shard receives for a room
+ *         within window_us go out as one payload, one write per recipient.
+ *
+ * 0 sends every line immediately (the default). A batch is sent early once
+ * it holds max_bytes. The window is the latency added, at most, to buy
+ * fewer writes and wakeups under load.
+ */
+struct BatchConfig
+{
+    unsigned    window_us = 0;
+    std::size_t max_bytes = 16u << 10;
+};
+
+/// How joins and leaves are announced to a room.
+enum class PresenceMode {
+    immediate,    ///< one "[name] joined" line per event, to everyone else
+    batched,      ///< one coalesced delta per room every tick_ms
+    off,          ///< none; clients ask for the roster with /who
+};
+
+/**
+ * @brief  Presence announcements (see Presence.hpp).
+ *
+ * In batched mode a join followed by a leave within one tick cancels out,
+ * and a tick with more than max_names changes sends counts instead of
+ * names, so a mass reconnect costs each client one short line per tick.
+ */
+struct PresenceConfig
+{
+    PresenceMode mode      = PresenceMode::immediate;
+    unsigned     tick_ms   = 250;
+    std::size_t  max_names = 32;
+};
+
+/**
+ * @brief  Everything the Server needs to know before it starts accepting.
+ *
+ * Defaults reproduce the original single-threaded behaviour on port 12345.
+ */
+struct ServerConfig
+{
+    unsigned short port    = 12345; ///< TCP listen port
+    bool           listen  = true;  ///< accept TCP clients; false = only Server::attach()
+    std::string    unix_path;       ///< also accept AF_UNIX stream clients here; empty = off
+    std::string    shm_path;        ///< shared‑memory publishers connect here (ShmTransport.hpp); empty = off
+    std::string    upgrade_path;    ///< a successor process connects here to take over (Handoff.hpp); empty = off
+    std::size_t    threads = 1;     ///< shard count (io_context + thread each); 0 = one per core
+    unsigned       stats_interval = 0; ///< seconds between stats dumps to stdout; 0 = off
+    unsigned short admin_port = 0;  ///< 127.0.0.1 metrics endpoint (Prometheus text); 0 = off
+    OutboxLimits   outbox;          ///< slow‑consumer protection
+    std::size_t    history_messages = 200;       ///< per‑room backlog replayed on join (0 = none)
+    std::size_t    history_bytes    = 256u << 10; ///< … capped at this many bytes
+    std::size_t    max_rooms        = 1024;      ///< /join refuses to create rooms past this
+    unsigned       resume_seconds   = 60;        ///< how long a dropped sequenced client may resume (0 = off)
+    LogConfig      log;             ///< durable history; off unless log.dir is set
+    FederationConfig federation;    ///< relay rooms to other nodes; off unless configured
+    std::size_t    max_message_bytes = 64u << 10; ///< longest inbound line / frame body
+    TimeoutConfig  timeouts;        ///< handshake / heartbeat / idle reaping
+    RateLimitConfig rate_limits;    ///< inbound flood protection; off by default
+    BatchConfig    batch;           ///< broadcast batching; off by default
+    PresenceConfig presence;        ///< join / leave announcements
+};
@@ -0,0 +1,135 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// ShmTransport.hpp ― shared‑memory ring transport for publishers on this host
+//
+//   • A local publisher (ShmPublisher) connects to the server's shm socket
+//     (ServerConfig::shm_path, AF_UNIX) and passes it, with SCM_RIGHTS, a
+//     memfd holding a byte ring and two eventfds; from then on everything
+//     it sends goes through the ring, in the ordinary wire protocol (name
+//     first), and the server's replies come back over the socket
+//   • Single producer, single consumer: head and tail count bytes ever
+//     written / read, each side stores only its own, so no locks
+//   • Doorbells: the producer rings `data` only when the consumer has said
+//     it is going to sleep, the consumer rings `room` only when the
+//     producer has. A busy stream costs no syscalls per message; each side
+//     sets its flag, fences, then re‑checks the other's index, so no wake
+//     is lost
+//   • ShmTransport is the server end, a Transport like any other, so the
+//     Session on top parses, rate‑limits and relays exactly as for TCP
+//   • The ring is the publisher's memory: the server only copies out of
+//     it and drops a connection whose indices stop making sense. The memfd
+//     must come sealed against shrinking and growing (the server checks),
+//     so the publisher can't pull the mapping out from under it
+//   • The socket carries hang‑up both ways: a publisher that exits or
+//     crashes reads as eof once the ring is drained
+//
+// Linux only (memfd, eventfd, MSG_CMSG_CLOEXEC).
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "Transport.hpp"
+
+namespace shm {
+
+inline constexpr std::uint32_t kMagic       = 0x31524843;    // "CHR1"
+inline constexpr std::size_t   kHeaderBytes = 4096;          ///< the ring data starts here
+inline constexpr std::size_t   kMinRing     = 4096;
+inline constexpr std::size_t   kMaxRing     = 64u << 20;
+
+/// The first page of the memfd; written by the producer before handing it over.
+struct Header {
+    std::uint32_t magic;
+    std::uint32_t reserved;
+    std::uint64_t capacity;                                  ///< data bytes, a power of two
+    alignas(64) std::atomic<std::uint64_t> head;             ///< bytes written (producer)
+    alignas(64) std::atomic<std::uint64_t> tail;             ///< bytes read (consumer)
+    alignas(64) std::atomic<std::uint32_t> consumer_waiting; ///< ring `data` on the next write
+    alignas(64) std::atomic<std::uint32_t> producer_waiting; ///< ring `room` on the next read
+};
+static_assert(sizeof(Header) <= kHeaderBytes);
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+} // namespace shm
+
+/// Server end: reads come out of the ring, writes go to the socket.
+class ShmTransport final : public Transport
+{
+public:
+    /**
+     * Receive a publisher's ring on its freshly accepted @p socket, then
+     * call @p done on the socket's executor with the transport – or with
+     * null if what arrived isn't a usable ring.
+     */
+    static void handshake(local_stream::socket socket,
+                          std::function<void(std::unique_ptr<Transport>)> done);
+
+    ~ShmTransport() override;
+
+    void async_read(net::mutable_buffer buf, OwnerPtr owner) override;
+    void async_write(const net::const_buffer* bufs, std::size_t n, OwnerPtr owner) override;
+    void async_wait_writable(OwnerPtr owner) override;
+    bool below_lowat(std::size_t) override { return true; }   ///< AF_UNIX: not paced
+    bool is_open() const override { return !closed_; }
+    void close() override;
+
+private:
+    ShmTransport(local_stream::socket socket, void* map, std::size_t map_bytes,
+                 std::uint64_t capacity, int data_fd, int room_fd);
+
+    void fill_read();                      ///< complete the pending read if possible, else wait
+    void complete_read(boost::system::error_code ec, std::size_t n);
+
+    local_stream::socket           socket_;
+    net::posix::stream_descriptor  data_;        ///< doorbell the publisher rings
+    int                            room_fd_;     ///< doorbell we ring
+    shm::Header*                   hdr_;
+    const char*                    ring_;
+    std::uint64_t                  capacity_;    ///< as validated at handshake
+    std::size_t                    map_bytes_;
+    std::uint64_t                  tail_ = 0;    ///< our copy of hdr_->tail
+
+    net::mutable_buffer            read_buf_;
+    OwnerPtr                       reader_;      ///< pending async_read
+    bool                           data_armed_  = false;
+    bool                           hup_armed_   = false;
+    bool                           peer_closed_ = false;
+    bool                           closed_      = false;
+    HandlerMemory                  read_mem_, write_mem_, wait_mem_, data_mem_, hup_mem_;
+};
+
+/// Publisher end, for bots on the server's host; blocking calls.
+class ShmPublisher
+{
+public:
+    /// Connect to the server's shm socket at @p path and hand it a ring of
+    /// @p ring_bytes (a power of two). Throws std::system_error.
+    explicit ShmPublisher(const std::string& path, std::size_t ring_bytes = 1u << 20);
+    ~ShmPublisher();
+
+    ShmPublisher(const ShmPublisher&)            = delete;
+    ShmPublisher& operator=(const ShmPublisher&) = delete;
+
+    /// Append wire bytes – the name line first, then messages, as over
+    /// TCP – waiting while the ring is full; false once the server hung up.
+    bool write(std::string_view bytes);
+
+    /// The server's replies (welcome, echoes, …) arrive here; keep reading
+    /// them, or the server's outbox to this publisher fills up.
+    int reply_fd() const { return sock_; }
+
+    void close();
+
+private:
+    int           sock_ = -1, mem_ = -1, data_fd_ = -1, room_fd_ = -1;
+    shm::Header*  hdr_  = nullptr;
+    char*         ring_ = nullptr;
+    std::uint64_t capacity_ = 0;
+    std::uint64_t head_     = 0;   ///< our copy of hdr_->head
+};
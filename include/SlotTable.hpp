@@ -0,0 +1,113 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// SlotTable.hpp ― dense, generation‑tagged table of per‑client state
+//
+//   • Values live inline in one vector; a freed slot is reused by the next
+//     insert (LIFO), so the table stays as dense as the peak population
+//   • An id is [generation : 32][slot : 32]; every reuse of a slot bumps
+//     its generation, so an id held past erase() never finds the new
+//     occupant – find() just returns nullptr
+//   • The slot field is striped (slot * stride + offset) so several tables,
+//     one per shard, hand out ids that never collide
+//
+// O(1) insert / find / erase, no hashing, no per‑entry allocation.
+// Not thread‑safe: each shard owns its table.
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+template <class T>
+class SlotTable
+{
+public:
+    using Id = std::uint64_t;
+
+    /// Never returned by insert(); use as "no id".
+    static constexpr Id kNone = 0;
+
+    /// @param stride  number of tables sharing the id space (shard count)
+    /// @param offset  this table's position among them (shard index)
+    explicit SlotTable(std::uint32_t stride = 1, std::uint32_t offset = 0)
+        : stride_(stride ? stride : 1), offset_(offset) {}
+
+    template <class... Args>
+    Id emplace(Args&&... args)
+    {
+        std::uint32_t slot;
+        if (!free_.empty()) {
+            slot = free_.back();
+            free_.pop_back();
+        } else {
+            slot = static_cast<std::uint32_t>(slots_.size());
+            slots_.emplace_back();
+        }
+        Slot& s = slots_[slot];
+        s.value.emplace(std::forward<Args>(args)...);
+        ++live_;
+        return Id(s.generation) << 32 | (Id(slot) * stride_ + offset_);
+    }
+
+    /// The live value for @p id, or nullptr if it was erased (or never ours).
+    T* find(Id id)
+    {
+        Slot* s = slot_of(id);
+        return s ? &*s->value : nullptr;
+    }
+
+    /// Destroy the value and retire @p id; false if it wasn't live.
+    bool erase(Id id)
+    {
+        Slot* s = slot_of(id);
+        if (!s)
+            return false;
+        s->value.reset();
+        if (++s->generation == 0)          // 0 is reserved so kNone never matches
+            s->generation = 1;
+        free_.push_back(static_cast<std::uint32_t>(s - slots_.data()));
+        --live_;
+        return true;
+    }
+
+    std::size_t size()     const { return live_; }
+    std::size_t capacity() const { return slots_.size(); }
+
+    /// Call @p f(id, value) for every live entry, in slot order.
+    template <class F>
+    void for_each(F&& f)
+    {
+        for (std::size_t i = 0; i < slots_.size(); ++i)
+            if (auto& s = slots_[i]; s.value)
+                f(Id(s.generation) << 32 | (Id(i) * stride_ + offset_), *s.value);
+    }
+
+private:
+    struct Slot {
+        std::optional<T> value;
+        std::uint32_t    generation = 1;
+    };
+
+    Slot* slot_of(Id id)
+    {
+        auto low = static_cast<std::uint32_t>(id);
+        if (low % stride_ != offset_)
+            return nullptr;
+        std::size_t slot = low / stride_;
+        if (slot >= slots_.size())
+            return nullptr;
+        Slot& s = slots_[slot];
+        if (!s.value || s.generation != static_cast<std::uint32_t>(id >> 32))
+            return nullptr;
+        return &s;
+    }
+
+    std::vector<Slot>          slots_;
+    std::vector<std::uint32_t> free_;     ///< erased slots, reused newest first
+    std::size_t                live_ = 0;
+    std::uint32_t              stride_;
+    std::uint32_t              offset_;
+};
@@ -0,0 +1,152 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// TimerWheel.hpp ― hashed timing wheel: one per shard, every session on it
+//
+//   • Time advances in ticks (the owner calls advance() from one periodic
+//     steady_timer); an entry due at tick T sits in slot T mod slots, in
+//     an intrusive doubly‑linked list – schedule and cancel are O(1) and
+//     never allocate
+//   • advance() visits one slot: entries due now fire, entries due a lap
+//     or more later stay; with the span (slots × tick) longer than the
+//     usual timeout, a tick costs about (entries / slots) steps however
+//     many connections there are
+//   • Entries embed in their owner (a Session) and unlink themselves on
+//     destruction; owners that only need "no activity since X" checks
+//     schedule the earliest possible deadline and re‑arm when it fires,
+//     instead of rescheduling on every read
+//
+// Not thread‑safe: a wheel and its entries belong to one io_context.
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+
+class TimerWheel
+{
+public:
+    using Tick = std::uint64_t;
+
+    /// Intrusive list node plus the callback run when it falls due.
+    class Entry
+    {
+    public:
+        Entry() = default;
+        explicit Entry(std::function<void()> on_due) : on_due_(std::move(on_due)) {}
+        Entry(const Entry&)            = delete;
+        Entry& operator=(const Entry&) = delete;
+        ~Entry() { cancel(); }
+
+        bool scheduled() const { return next_ != nullptr; }
+        Tick due() const       { return due_; }
+
+        void cancel()
+        {
+            if (!next_)
+                return;
+            prev_->next_ = next_;
+            next_->prev_ = prev_;
+            prev_ = next_ = nullptr;
+        }
+
+    private:
+        friend class TimerWheel;
+
+        void make_head() { prev_ = next_ = this; }
+
+        Entry*                prev_ = nullptr;
+        Entry*                next_ = nullptr;
+        Tick                  due_  = 0;
+        std::function<void()> on_due_;
+    };
+
+    /// @param slots  rounded up to a power of two
+    explicit TimerWheel(std::size_t slots = 1024)
+    {
+        std::size_t n = 1;
+        while (n < slots) n <<= 1;
+        slots_ = std::make_unique<Entry[]>(n);
+        mask_  = n - 1;
+        for (std::size_t i = 0; i < n; ++i)
+            slots_[i].make_head();
+    }
+
+    TimerWheel(const TimerWheel&)            = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /// Entries outliving the wheel are left unscheduled, not dangling.
+    ~TimerWheel()
+    {
+        for (std::size_t i = 0; i <= mask_; ++i)
+            while (slots_[i].next_ != &slots_[i])
+                slots_[i].next_->cancel();
+    }
+
+    /// Ticks advanced so far.
+    Tick now() const { return now_; }
+
+    std::size_t slots() const { return mask_ + 1; }
+
+    /// (Re)arm @p e to fire at tick @p at; a tick already past fires on the next one.
+    void schedule(Entry& e, Tick at)
+    {
+        e.cancel();
+        e.due_ = at > now_ ? at : now_ + 1;
+        link(slots_[e.due_ & mask_], e);
+    }
+
+    void schedule_in(Entry& e, Tick ticks) { schedule(e, now_ + (ticks ? ticks : 1)); }
+
+    /**
+     * Move to the next tick and fire what is due in it. Callbacks may
+     * schedule or cancel any entry, their own included; an entry
+     * rescheduled into the current slot waits a full lap.
+     * @return entries fired
+     */
+    std::size_t advance()
+    {
+        ++now_;
+        Entry& slot = slots_[now_ & mask_];
+        if (slot.next_ == &slot)
+            return 0;
+
+        // detach the slot's list so callbacks can relink into it freely
+        Entry batch;
+        batch.next_ = slot.next_;
+        batch.prev_ = slot.prev_;
+        batch.next_->prev_ = &batch;
+        batch.prev_->next_ = &batch;
+        slot.make_head();
+
+        std::size_t fired = 0;
+        while (batch.next_ != &batch) {
+            Entry& e = *batch.next_;
+            e.cancel();
+            if (e.due_ > now_) {          // a later lap
+                link(slot, e);
+                continue;
+            }
+            ++fired;
+            if (e.on_due_)
+                e.on_due_();
+        }
+        batch.prev_ = batch.next_ = nullptr;   // empty; nothing to unlink
+        return fired;
+    }
+
+private:
+    static void link(Entry& head, Entry& e)
+    {
+        e.prev_ = head.prev_;
+        e.next_ = &head;
+        head.prev_->next_ = &e;
+        head.prev_ = &e;
+    }
+
+    std::unique_ptr<Entry[]> slots_;
+    std::size_t              mask_ = 0;
+    Tick                     now_  = 0;
+};
@@ -0,0 +1,96 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// Transfer.hpp ― file transfer over the chat connection (/send)
+//
+//   • The sender announces, streams and closes a transfer with three kinds
+//     of line, all ordinary messages in any protocol:
+//         /file  ID SIZE NAME
+//         /chunk ID OFFSET BASE64      (at most kChunkBytes of file each)
+//         /sent  ID
+//   • The server relays them to the sender's room as "[sender] <line>",
+//     at bulk priority – behind interactive messages in every outbox – and
+//     keeps them out of history, the message log and federation
+//   • A receiver's outbox drops chunks past its bulk cap rather than
+//     stalling chat; the OFFSETs tell the receiver a file came incomplete
+//   • Base64 keeps chunks line‑safe for text clients
+//
+// Header‑only: shared by Server and Client.
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace transfer {
+
+inline constexpr std::string_view kFile  = "/file ";
+inline constexpr std::string_view kChunk = "/chunk ";
+inline constexpr std::string_view kSent  = "/sent ";
+
+/// File bytes per chunk; a chunk line stays well under the default max message.
+inline constexpr std::size_t kChunkBytes = 12 * 1024;
+
+/// True for a /file, /chunk or /sent line.
+inline bool is_transfer(std::string_view text)
+{
+    return text.substr(0, kFile.size())  == kFile ||
+           text.substr(0, kChunk.size()) == kChunk ||
+           text.substr(0, kSent.size())  == kSent;
+}
+
+inline void base64_append(std::string& out, std::string_view in)
+{
+    static constexpr char digits[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    auto byte = [&](std::size_t i) { return static_cast<unsigned char>(in[i]); };
+    std::size_t i = 0;
+    for (; i + 3 <= in.size(); i += 3) {
+        std::uint32_t v = byte(i) << 16 | byte(i + 1) << 8 | byte(i + 2);
+        out += digits[v >> 18];
+        out += digits[v >> 12 & 63];
+        out += digits[v >> 6 & 63];
+        out += digits[v & 63];
+    }
+    if (std::size_t rest = in.size() - i) {
+        std::uint32_t v = byte(i) << 16 | (rest > 1 ? byte(i + 1) << 8 : 0);
+        out += digits[v >> 18];
+        out += digits[v >> 12 & 63];
+        out += rest > 1 ? digits[v >> 6 & 63] : '=';
+        out += '=';
+    }
+}
+
+/// Append the bytes @p in encodes; false on anything that isn't base64.
+inline bool base64_decode(std::string& out, std::string_view in)
+{
+    auto value = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+') return 62;
+        if (c == '/') return 63;
+        return -1;
+    };
+    if (in.size() % 4)
+        return false;
+    for (std::size_t i = 0; i < in.size(); i += 4) {
+        std::size_t pad = (in[i + 3] == '=') + (in[i + 2] == '=');
+        if (pad && i + 4 != in.size())
+            return false;
+        std::uint32_t v = 0;
+        for (std::size_t k = 0; k < 4 - pad; ++k) {
+            int d = value(in[i + k]);
+            if (d < 0)
+                return false;
+            v |= std::uint32_t(d) << (18 - 6 * k);
+        }
+        out += static_cast<char>(v >> 16);
+        if (pad < 2) out += static_cast<char>(v >> 8 & 0xff);
+        if (pad < 1) out += static_cast<char>(v & 0xff);
+    }
+    return true;
+}
+
+} // namespace transfer
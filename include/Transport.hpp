@@ -0,0 +1,127 @@
+#pragma once
+//──────────────────────────────────────────────────────────────────────────────
+// Transport.hpp ― the byte stream under a Session
+//
+//   • Transport: what a Session needs from its connection – one read, one
+//     write and one wait for send room outstanding at a time, an estimate
+//     of bytes queued but unsent, and close()
+//   • Completions go to the session through Transport::Owner; the transport
+//     holds a shared_ptr to it while an operation is pending, just as an
+//     Asio handler capturing `self` would, so there is nothing to allocate
+//     per operation beyond what the stream itself needs
+//   • SocketTransport: a connected stream socket, each operation kind
+//     running in its own HandlerMemory – TcpTransport, and LocalTransport
+//     for AF_UNIX clients on the same host
+//   • A socket can also be handed to another process (Handoff.hpp):
+//     cancel() settles its operations without closing it, release() gives
+//     up the descriptor; other transports can't be handed over
+//   • MemoryTransport.hpp has an in‑process one for benchmarks and checks,
+//     ShmTransport.hpp one fed from a shared‑memory ring
+//
+// Completions are never invoked from inside the call that starts the
+// operation; they run on the transport's executor, like Asio's.
+//
+// 2025‑07‑23
+//──────────────────────────────────────────────────────────────────────────────
+#include <boost/asio.hpp>
+#include <cstddef>
+#include <memory>
+#include "HandlerMemory.hpp"
+
+namespace net = boost::asio;
+using     tcp = net::ip::tcp;
+
+class Transport
+{
+public:
+    /// Receives a transport's completions (implemented by Session).
+    class Owner
+    {
+    public:
+        virtual void on_read    (const boost::system::error_code& ec, std::size_t n) = 0;
+        virtual void on_write   (const boost::system::error_code& ec, std::size_t n) = 0;
+        virtual void on_writable(const boost::system::error_code& ec)                = 0;
+
+    protected:
+        ~Owner() = default;
+    };
+    using OwnerPtr = std::shared_ptr<Owner>;
+
+    virtual ~Transport() = default;
+
+    /// Read at least one byte into @p buf → Owner::on_read.
+    virtual void async_read(net::mutable_buffer buf, OwnerPtr owner) = 0;
+
+    /// Write a prefix of @p bufs[0, n) → Owner::on_write; the array and
+    /// what it points to must stay valid until then.
+    virtual void async_write(const net::const_buffer* bufs, std::size_t n, OwnerPtr owner) = 0;
+
+    /// Complete once fewer than the last below_lowat() mark are unsent →
+    /// Owner::on_writable.
+    virtual void async_wait_writable(OwnerPtr owner) = 0;
+
+    /// Whether fewer than @p lowat written bytes are still queued unsent
+    /// (true where that can't be told).
+    virtual bool below_lowat(std::size_t lowat) = 0;
+
+    virtual bool is_open() const = 0;
+
+    /// Shut down both directions and close; pending operations complete
+    /// with an error. Idempotent.
+    virtual void close() = 0;
+
+    /// Whether release() would give up an open descriptor.
+    virtual bool transferable() const { return false; }
+
+    /// Abort pending operations without closing; each still completes,
+    /// with operation_aborted unless it had already finished.
+    virtual void cancel() {}
+
+    /// Give up the descriptor, open and not shut down, for another process;
+    /// -1 if there is none. The transport is closed afterwards.
+    virtual int release() { return -1; }
+};
+
+/// A connected stream socket; instantiated for TCP and AF_UNIX.
+template <class Protocol>
+class SocketTransport final : public Transport
+{
+public:
+    using socket_type = typename Protocol::socket;
+
+    explicit SocketTransport(socket_type socket) : socket_(std::move(socket)) {}
+
+    void async_read(net::mutable_buffer buf, OwnerPtr owner) override;
+    void async_write(const net::const_buffer* bufs, std::size_t n, OwnerPtr owner) override;
+    void async_wait_writable(OwnerPtr owner) override;
+    bool below_lowat(std::size_t lowat) override;
+    bool is_open() const override { return socket_.is_open(); }
+    void close() override;
+    bool transferable() const override { return socket_.is_open(); }
+    void cancel() override;
+    int  release() override;
+
+private:
+    socket_type   socket_;
+    int           lowat_set_ = 0;  ///< TCP_NOTSENT_LOWAT: 0 untried, 1 set, -1 unavailable
+    HandlerMemory read_mem_;       ///< the one outstanding read's state
+    HandlerMemory write_mem_;      ///< … and the one outstanding write's
+    HandlerMemory wait_mem_;       ///< … and async_wait_writable()'s
+};
+
+extern template class SocketTransport<tcp>;
+using TcpTransport = SocketTransport<tcp>;
+
+using local_stream = net::local::stream_protocol;
+extern template class SocketTransport<local_stream>;
+using LocalTransport = SocketTransport<local_stream>;
+
+/// A prefix of a const_buffer array, as a buffer sequence Asio can hold by
+/// value without copying a container.
+struct GatherView {
+    using value_type     = net::const_buffer;
+    using const_iterator = const net::const_buffer*;
+    const net::const_buffer *first, *last;
+    const_iterator begin() const { return first; }
+    const_iterator end()   const { return last; }
+};
@@ -3,18 +3,67 @@
 // Client.hpp ― public interface for the asynchronous chat client
 //
 //   • Uses Boost.Asio for networking
-//   • One instance owns a TCP socket, resolver, and a background input thread
+//   • One instance owns a stream socket – TCP, or AF_UNIX when
+//     ClientOptions::unix_path is set – a resolver, and a background input
+//     thread
+//   • Outgoing messages are appended to one pending buffer; a single
+//     async_write is in flight at a time and carries everything queued
+//     behind the previous one, so lines typed or piped back to back never
+//     overlap on the socket and go out in as few writes as possible
+//   • In sequenced mode (--resume) it keeps the server's resume token and
+//     the last sequence number shown, and on a dropped connection
+//     reconnects and resumes without duplicating or losing messages
+//   • Headless mode (ClientOptions::script) reads messages from a file or
+//     pipe instead of a terminal, sends them as fast as the socket takes
+//     them or at a fixed rate, prints incoming lines plainly (or not at
+//     all) and quits once the script is sent
+//   • "/send PATH" (typed or scripted) streams a file to the room in
+//     chunks (Transfer.hpp), one per write and only while no chat is
+//     pending, so typing isn't held up; incoming files are reassembled and
+//     saved under ClientOptions::downloads
 //
-// 2025-07-23
+// 2025‑07‑23
 //──────────────────────────────────────────────────────────────────────────────
 #include <boost/asio.hpp>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iosfwd>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Framing.hpp"
+#include "HandlerMemory.hpp"
 
 namespace net = boost::asio;
 using     tcp = net::ip::tcp;
+using     stream_protocol = net::generic::stream_protocol;   ///< TCP or AF_UNIX
+
+/// How the client talks to the server and where its input comes from.
+struct ClientOptions {
+    wire::Protocol proto = wire::Protocol::text;  ///< framed / sequenced as negotiated
+    std::string    name;             ///< empty = prompt for it
+    std::string    script;           ///< headless: message file, "-" = stdin; empty = interactive
+    double         rate = 0;         ///< headless: messages per second, 0 = as fast as possible
+    unsigned       linger_ms = 1000; ///< headless: keep reading this long after the last send
+    bool           quiet = false;    ///< headless: don't print incoming lines
+    std::string    downloads;        ///< save received files here; empty = don't save
+    std::string    unix_path;        ///< connect to this AF_UNIX socket instead of host:port
+};
+
+/// What a client sent and received, for the headless summary.
+struct ClientStats {
+    std::uint64_t sent_messages = 0;
+    std::uint64_t sent_bytes    = 0;   ///< on the wire, framing included
+    std::uint64_t writes        = 0;   ///< async_write calls that carried them
+    std::uint64_t received      = 0;   ///< messages received
+    double        send_seconds  = 0;   ///< first queued → last written
+};
 
 /**
  * @brief  Asynchronous chat client.
@@ -30,9 +79,13 @@ class Client : public std::enable_shared_from_this<Client>
 {
 public:
     /// Construct with an existing io_context, remote host, and port.
+    /// @param opts.proto  wire::Protocol::framed to negotiate length‑prefixed
+    ///                    frames, wire::Protocol::sequenced to also resume
+    ///                    after a drop
     Client(net::io_context& io,
            std::string      host,
-           unsigned short   port);
+           unsigned short   port,
+           ClientOptions    opts = {});
 
     /// Joins the background input thread on destruction.
     ~Client();
@@ -42,30 +95,83 @@ public:
 
     void send_quit();
 
-    
+    /// Counters so far; call once io.run() has returned.
+    ClientStats stats() const;
+    void        print_stats(std::ostream& out) const;
 
 private:
     //── networking helpers ──────────────────────────────────────────────
     void send_name();                   ///< prompt user & write the name line
-    void write(std::string text);       ///< enqueue a chat line to the socket
-    void read_loop();                   ///< perpetual async_read_until('\n')
-    
+    void write(std::string_view text);  ///< encode one message and queue it
+    void flush();                       ///< start the next write if idle
+    void submit(std::string line);      ///< from an input thread: hand a line to write()
+    void pong();                        ///< answer a wire::kPing
+    void read_loop();                   ///< perpetual async_read_some + parse
+    void reconnect();                   ///< resume after a dropped connection
+    bool resumable() const;
+
+    //── file transfer (io thread only) ──────────────────────────────────
+    void start_send(const std::string& path);   ///< "/send PATH": announce, then pump
+    void pump_transfer();                       ///< queue the next chunk if no chat is pending
+    bool on_transfer(std::string_view msg);     ///< incoming transfer line; true if it was one
 
     //── UI helpers ──────────────────────────────────────────────────────
     void show_incoming(std::string_view msg);  ///< pretty-print a server line
+    void print_line(std::string_view msg);     ///< … without counting it as received
     void launch_input_loop();                  ///< spawn std::thread for stdin
+    void launch_script_loop();                 ///< headless: spawn the script reader
+    void finish_script();                      ///< headless: linger, then hang up
+    bool headless() const { return !opts_.script.empty(); }
 
     //── data members ────────────────────────────────────────────────────
     net::io_context&   io_;        ///< event loop (owned by caller)
-    tcp::socket        socket_;    ///< connected after start()
+    stream_protocol::socket socket_;  ///< connected after start()
     tcp::resolver      resolver_;  ///< for DNS / endpoint lookup
-    net::streambuf     resp_buf_;  ///< collects bytes until '\n'
+    wire::RecvBuffer   resp_buf_;  ///< flat receive buffer, parsed in place
+    HandlerMemory      read_mem_;  ///< recycled by every read_loop() read
+    HandlerMemory      write_mem_; ///< recycled by every flush() write
+    ClientOptions      opts_;
+    wire::Protocol     proto_;
 
-    std::mutex         write_mtx_; ///< serialize writes to the socket
+    //── outbound queue (io thread only, except backlog_) ────────────────
+    std::string        pending_;        ///< encoded, not yet handed to the socket
+    std::string        in_flight_;      ///< what the current async_write sends
+    std::size_t        pending_msgs_   = 0;
+    std::size_t        in_flight_msgs_ = 0;
+    bool               writing_   = false;
+    bool               connected_ = false;  ///< name / resume sent; writes may go
+    std::size_t        backlog_   = 0;      ///< submitted, not yet written; under queue_mtx_
+    std::mutex              queue_mtx_;
+    std::condition_variable queue_cv_;  ///< the script reader waits for room here
     std::thread        input_thread_;
 
+    //── headless bookkeeping ────────────────────────────────────────────
+    net::steady_timer  linger_timer_;
+    bool               script_eof_ = false;  ///< script read to the end, hang up when idle
+    ClientStats        stats_;
+    std::chrono::steady_clock::time_point first_send_{}, last_write_{};
+
     std::string        host_;
     unsigned short     port_;
     std::string        name_;      ///< cached “clean” name (no trailing \n)
+    std::vector<stream_protocol::endpoint> endpoints_;   ///< kept for reconnect()
+    net::steady_timer  retry_timer_;
+    struct Outgoing {
+        std::ifstream  file;
+        std::uint64_t  id = 0, size = 0, offset = 0;
+        std::string    name;
+    };
+    struct Incoming {
+        std::string    name;
+        std::uint64_t  size = 0, received = 0;
+        bool           broken = false;   ///< a chunk was dropped or garbled
+        std::ofstream  out;
+    };
+    std::deque<Outgoing>                      sending_;    ///< front one is being sent
+    std::unordered_map<std::string, Incoming> receiving_;  ///< "sender id" → transfer
+    std::uint64_t                             next_transfer_ = 1;
+
+    std::string        token_;     ///< resume token (sequenced only)
+    std::uint64_t      last_seq_ = 0;  ///< newest room message shown
     std::atomic_bool   running_{true};
 };
@@ -2,75 +2,296 @@
 //──────────────────────────────────────────────────────────────────────────────
 // Session.hpp ― represents one connected client on the server side
 //
-//   • Owns the TCP socket for that client
-//   • Reads the user’s name (phase 1), then chat lines (phase 2)
+//   • Owns the client's connection: a Transport (Transport.hpp) – a TCP
+//     socket in the server, or an in‑memory pipe in benchmarks
+//   • Reads the user’s name (phase 1), then chat lines (phase 2), either
+//     as text lines or as length‑prefixed frames (see Framing.hpp)
 //   • Relays incoming messages to the Server via callbacks
-//   • Queues outbound messages so only one async_write is active at a time
+//   • Queues outbound messages so only one write is active at a time, and
+//     flushes as much of the queue as fits in one gathered write (writev)
+//   • Caps queued bytes and applies a SlowConsumerPolicy when a reader stalls
+//   • Allocation‑free per message once warmed up: read and write handlers
+//     run in per‑transport HandlerMemory, the outbox is a RingQueue and the
+//     gather list is a fixed array (bench/handler_alloc_bench.cpp checks)
+//   • Handshake, heartbeat and idle deadlines run on the shard's TimerWheel;
+//     a read only records the current tick, the wheel entry is re‑armed
+//     when it fires. Text clients get the handshake deadline only
+//   • Chat messages pass the session's (and its address's) token buckets
+//     before reaching the Server; over the limit they are dropped, end
+//     the session, or pause reading until the buckets refill
+//   • Bulk messages (file transfer chunks) wait in a second queue that is
+//     only drained behind interactive ones, a bounded amount per write and
+//     only while the transport has little unsent, so a transfer never puts
+//     more than ~kBulkLowat bytes between a live message and the wire
+//   • For a hot upgrade a session can be frozen between two messages and
+//     handed, socket and queues, to a Session in the successor process
+//     (Handoff.hpp)
 //
 // 2025‑07‑23
 //──────────────────────────────────────────────────────────────────────────────
 #include <boost/asio.hpp>
-#include <deque>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
+#include "Framing.hpp"
+#include "Handoff.hpp"
+#include "Metrics.hpp"
+#include "Payload.hpp"
+#include "RateLimiter.hpp"
+#include "RingQueue.hpp"
+#include "ServerConfig.hpp"
+#include "TimerWheel.hpp"
+#include "Transport.hpp"
 
 namespace net = boost::asio;
 using     tcp = net::ip::tcp;
 
+/// Outbound priority; interactive messages always go ahead of bulk ones.
+enum class Priority { interactive, bulk };
+
+/// Why a session ended; one counter per reason in SessionStats.
+enum class DisconnectReason {
+    quit, eof, error, slow_consumer, protocol, handshake_timeout, idle_timeout, rate_limited,
+    count_
+};
+
+inline const char* to_string(DisconnectReason r)
+{
+    static constexpr const char* names[] = {"quit", "eof", "error", "slow_consumer", "protocol",
+                                            "handshake_timeout", "idle_timeout", "rate_limited"};
+    return names[static_cast<int>(r)];
+}
+
+/**
+ * @brief  Session‑side counters, shared by all sessions of one shard.
+ *
+ * Only the owning shard's thread writes them (metrics::Counter), the
+ * admin endpoint and stats dump read them from elsewhere.
+ */
+struct SessionStats {
+    metrics::Counter messages_in;    ///< chat lines / frames received
+    metrics::Counter bytes_in;       ///< raw bytes read from sockets
+    metrics::Counter write_calls;    ///< gathered writes issued (≈ writev syscalls)
+    metrics::Counter messages;       ///< messages fully written
+    metrics::Counter bytes;          ///< bytes written
+
+    // slow‑consumer policy activity
+    metrics::Counter slow_disconnects; ///< sessions closed for backlog
+    metrics::Counter dropped;          ///< messages dropped (incl. collapsed)
+    metrics::Counter gap_markers;      ///< gap markers queued
+    metrics::Counter collapses;        ///< backlogs collapsed
+    metrics::Counter heartbeats;       ///< pings sent to quiet clients
+
+    // inbound rate limiting
+    metrics::Counter rate_limited_session; ///< messages over a session bucket
+    metrics::Counter rate_limited_address; ///< … over their address's bucket
+    metrics::Counter throttles;            ///< times reading was paused
+    metrics::Counter rate_dropped;         ///< messages discarded
+
+    metrics::Counter bulk_dropped;         ///< bulk messages over OutboxLimits::bulk_bytes
+    metrics::Counter bulk_waits;           ///< writes held back for the socket to drain
+
+    std::array<metrics::Counter, static_cast<int>(DisconnectReason::count_)> disconnects;
+    metrics::Log2Histogram<16>       outbox_depth;   ///< entries queued, sampled per deliver
+};
+
+/**
+ * @brief  A shard's session deadlines, in ticks of its TimerWheel; 0 = off.
+ */
+struct SessionTimeouts {
+    TimerWheel*      wheel     = nullptr;  ///< null = no deadlines at all (benchmarks)
+    TimerWheel::Tick handshake = 0;        ///< connect → name
+    TimerWheel::Tick heartbeat = 0;        ///< inbound silence before a ping
+    TimerWheel::Tick idle      = 0;        ///< inbound silence before reaping
+    std::chrono::milliseconds tick{100};   ///< length of one wheel tick
+};
+
+/**
+ * @brief  Limits and counters shared by every session of one shard.
+ */
+struct SessionContext {
+    OutboxLimits              limits;
+    SessionTimeouts           timeouts;
+    RateLimitConfig           rate_limits;  ///< throttling needs timeouts.wheel; without it, drop
+    std::size_t               max_message = wire::kDefaultMaxBody; ///< inbound line/frame cap
+    std::atomic<std::size_t>* global_queued = nullptr; ///< process‑wide queued bytes
+    SessionStats              stats;
+};
+
+/// Server‑assigned client id (see SlotTable.hpp); 0 is never a valid id.
+using SessionId = std::uint64_t;
+
 /**
  * @brief  One per connected client; created by Server.
  *
  * Lifetime is managed with `std::shared_ptr` + `enable_shared_from_this` so the
  * object stays alive while any asynchronous operation is outstanding.
  */
-class Session : public std::enable_shared_from_this<Session>
+class Session : public std::enable_shared_from_this<Session>, public Transport::Owner
 {
 public:
     /// Callbacks the Session uses to talk back to Server
-    using NameCallback = std::function<void(int, const std::string&)>; ///< id, name
-    using MsgCallback  = std::function<void(int, const std::string&)>; ///< id, text
-    using DiconnectCallBack = std::function<void(int)>;
+    using NameCallback = std::function<void(SessionId, const std::string&)>; ///< id, name
+    using MsgCallback  = std::function<void(SessionId, std::string_view)>;   ///< id, text (view into the receive buffer)
+    using DiconnectCallBack = std::function<void(SessionId, DisconnectReason)>;
     /**
-     * @param socket   freshly‑accepted (already connected) socket
+     * @param transport  the client's (already connected) byte stream
      * @param id       unique client identifier assigned by Server
      * @param name_cb  invoked once when the user’s name arrives
      * @param msg_cb   invoked for every subsequent chat message
      * @param dis_cp   invoked one when the users quits
+     * @param ctx      shard‑wide limits and counters (default: built‑in limits)
      */
+    Session(std::unique_ptr<Transport> transport,
+            SessionId     id,
+            NameCallback  name_cb,
+            MsgCallback   msg_cb,
+            DiconnectCallBack dis_cb,
+            SessionContext* ctx = nullptr);
+    /// Over a freshly‑accepted (already connected) socket.
     Session(tcp::socket   socket,
-            int           id,
+            SessionId     id,
             NameCallback  name_cb,
             MsgCallback   msg_cb,
-            DiconnectCallBack dis_cb);
+            DiconnectCallBack dis_cb,
+            SessionContext* ctx = nullptr);
+    ~Session();
+
+    /// Upper bounds for one gathered write.
+    static constexpr std::size_t kMaxWriteBuffers = 64;
+    static constexpr std::size_t kMaxWriteBytes   = 64 * 1024;
+    /// Bytes requested from the transport per read.
+    static constexpr std::size_t kReadChunk       = 16 * 1024;
+    /// Bulk bytes added to one write, at most …
+    static constexpr std::size_t kBulkQuantum     = 32 * 1024;
+    /// … and only while the transport holds fewer unsent bytes than this.
+    static constexpr std::size_t kBulkLowat       = 64 * 1024;
 
     /// Begin the read‑name phase; called immediately after construction.
     void start();
 
-    /// Enqueue a message to be delivered to this client.
-    void deliver(const std::string& msg);
+    /// Enqueue shared records; the outbox keeps a reference, not a copy.
+    void deliver(Payload msg, Priority prio = Priority::interactive);
+
+    /// Convenience for one‑off messages: encodes @p body as one record.
+    void deliver(std::string_view body);
+
+    /// Share the buckets of the client's address; call before start().
+    void set_address_limit(std::shared_ptr<AddressLimit> limit);
+
+    /// Wire protocol this client negotiated (text until it says otherwise).
+    wire::Protocol protocol() const { return proto_; }
 
     void stop();
 
+    /// Drop the callbacks: whatever completes from now on never reaches
+    /// the Server (used when the Server shuts down before its sessions).
+    void detach();
+
+    //── hot upgrade (Handoff.hpp) ─────────────────────────────────────────
+    /// Stop at the next message boundary: nothing more is parsed, written
+    /// or timed, and pending operations are cancelled (what they already
+    /// did still counts); deliver() only queues from now on. False, and
+    /// nothing changes, if the connection can't go to another process.
+    bool freeze();
+
+    /// Frozen and no operation pending any more: ready for hand_off().
+    bool quiescent() const { return !reading_ && !writing_ && !bulk_waiting_; }
+
+    /// Move the descriptor, unparsed input and unsent queues into @p out;
+    /// fd is -1 if the connection closed meanwhile.
+    void hand_off(handoff::SessionState& out);
+
+    /// Carry on from a predecessor's hand_off(); call before start().
+    void restore(handoff::SessionState& in);
+
 private:
-    //── phase 1: read client name ─────────────────────────────────────────
-    void read_name();
+    //── inbound ───────────────────────────────────────────────────────────
+    void do_read();                        ///< async_read into rbuf_
+    void on_read(const boost::system::error_code& ec, std::size_t n) override;
+    bool parse_input();                    ///< dispatch complete messages; false = stopped
+    bool on_message(std::string_view msg); ///< phase 1 (name) / phase 2 (chat)
+    void notify_disconnect(DisconnectReason why); ///< count it, tell Server
+
+    //── deadlines ─────────────────────────────────────────────────────────
+    void arm_timer();                      ///< schedule the earliest deadline
+    void on_timer();                       ///< ping, reap, or re‑arm
+    void reap(DisconnectReason why);       ///< close for a missed deadline
+
+    //── inbound rate limits ───────────────────────────────────────────────
+    /// Charge one message of @p bytes to every bucket, or return how long
+    /// until all of them could pay (nothing charged then).
+    TokenBucket::Clock::duration charge(std::size_t bytes, TokenBucket::Clock::time_point now,
+                                        bool& by_address);
+    void pause_reading(TokenBucket::Clock::duration wait);
+    void resume_reading();                 ///< throttle over: parse what's buffered, read on
+
+    //── outbound ──────────────────────────────────────────────────────────
+    void do_write();  ///< gather queued messages into one async_write
+    void on_write(const boost::system::error_code& ec, std::size_t n) override;
+    void on_written(std::size_t bytes);  ///< pop completed messages
+    /// Append q[first, last) to gather_, skipping @p skip wire bytes, until
+    /// @p bytes reaches @p cap; @return entries touched.
+    std::size_t gather(const RingQueue<Payload>& q, std::size_t first, std::size_t last,
+                       std::size_t skip, std::size_t& bytes, std::size_t cap);
+    /// Pop what @p n written bytes completed of one queue; @return records.
+    std::size_t advance(bool bulk, std::size_t n);
+    void wait_writable();                ///< only bulk queued and no room: wait for some
+    void on_writable(const boost::system::error_code& ec) override;
 
-    //── phase 2: chat mode ────────────────────────────────────────────────
-    void do_read();   ///< async_read_until('\n') loop
-    void do_write();  ///< write front of outbox_ then pop
+    //── outbox bounds ─────────────────────────────────────────────────────
+    bool admit(std::size_t incoming);    ///< apply policy; false = don't queue
+    bool over_limit(std::size_t incoming) const;
+    void drop_backlog(std::size_t incoming, bool all);
+    void push_queued(Payload msg, std::size_t at);
+    void pop_queued(std::size_t at);
 
     void print_incoming(const std::string& msg); ///< server console helper
 
     
 
     //── data members ──────────────────────────────────────────────────────
-    tcp::socket            socket_;
-    net::streambuf         streambuf_;
-    int                    client_id_;
+    std::unique_ptr<Transport> transport_;
+    wire::RecvBuffer       rbuf_;          ///< flat receive buffer
+    bool                   reading_ = false; ///< an async_read is in flight
+    bool                   frozen_  = false; ///< handing off: no parsing or writing
+    wire::Protocol         proto_ = wire::Protocol::text;
+    bool                   named_ = false; ///< phase 1 done
+    std::optional<DisconnectReason> closing_; ///< set when we close the socket ourselves
+    SessionId              client_id_;
     NameCallback           name_callback_;
     MsgCallback            msg_callback_;
     DiconnectCallBack      dis_callback_;
-    std::string            client_name_;   ///< cached after read_name()
-    std::deque<std::string> outbox_;       ///< pending outbound messages
+    std::string            client_name_;   ///< cached after phase 1
+    RingQueue<Payload>     outbox_;        ///< pending outbound messages
+    std::size_t            front_offset_ = 0;    ///< wire bytes of front() already sent
+    RingQueue<Payload>     bulk_;                ///< pending bulk messages, one record each
+    std::size_t            bulk_offset_  = 0;    ///< wire bytes of bulk_.front() already sent
+    std::size_t            bulk_queued_  = 0;    ///< sum of bulk_ sizes
+    bool                   bulk_waiting_ = false;///< wait_writable() pending
+    std::size_t            plan_lead_    = 0;    ///< write in flight: bulk remainder bytes first,
+    std::size_t            plan_live_    = 0;    ///< … then interactive bytes, then bulk
+    bool                   writing_      = false;///< an async_write is in flight
+    std::size_t            in_flight_    = 0;    ///< outbox_ entries (partly) in that write
+    std::array<net::const_buffer, kMaxWriteBuffers> gather_; ///< scatter/gather list
+    std::size_t            gather_n_     = 0;    ///< entries of gather_ in use
+    std::size_t            queued_bytes_ = 0;    ///< sum of outbox_ sizes
+    Payload                gap_marker_;          ///< unsent gap marker, if any
+    std::size_t            gap_count_    = 0;    ///< messages that marker accounts for
+    TimerWheel::Entry      timer_;               ///< on ctx_->timeouts.wheel
+    TimerWheel::Tick       opened_    = 0;       ///< tick the session started
+    TimerWheel::Tick       last_in_   = 0;       ///< tick of the latest read
+    TimerWheel::Tick       last_ping_ = 0;       ///< tick of the latest heartbeat sent
+    TokenBucket            in_messages_;         ///< per‑session limits
+    TokenBucket            in_bytes_;
+    std::shared_ptr<AddressLimit> address_limit_; ///< shared with same‑address sessions
+    bool                   rate_limited_ = false; ///< any bucket applies
+    TimerWheel::Entry      resume_timer_;        ///< ends a throttle pause
+    SessionContext*        ctx_;
 };